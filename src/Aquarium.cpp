@@ -2,25 +2,6 @@
 #include <cstdlib>
 
 
-string AquariumCreatureTypeToString(AquariumCreatureType t){
-    switch(t){
-        case AquariumCreatureType::BiggerFish:
-            return "BiggerFish";
-        case AquariumCreatureType::NPCreature:
-            return "BaseFish";
-        case AquariumCreatureType::FastFish:
-            return "FastFish";
-        case AquariumCreatureType::VerticalFish:
-            return "VerticalFish";
-        case AquariumCreatureType::PlayerFish:
-            return "PlayerFish";
-        case AquariumCreatureType::PowerUp:
-            return "PowerUp";
-        default:
-            return "UknownFish";
-    }
-}
-
 // PlayerCreature Implementation
 PlayerCreature::PlayerCreature(float x, float y, int speed, std::shared_ptr<GameSprite> sprite)
 : Creature(x, y, speed, 10.0f, 1, sprite) {}
@@ -30,6 +11,7 @@ void PlayerCreature::setDirection(float dx, float dy) {
     m_dx = dx;
     m_dy = dy;
     normalize();
+    this->rehash();
 }
 
 void PlayerCreature::move() {
@@ -38,22 +20,38 @@ void PlayerCreature::move() {
     this->bounce();
 }
 
-void PlayerCreature::reduceDamageDebounce() {
-    if (m_damage_debounce > 0) {
-        --m_damage_debounce;
-    }
+PlayerCreature::~PlayerCreature() {
+    TimingWheel::Frames().Cancel(m_damageTimer);
 }
 
 void PlayerCreature::update() {
-    this->reduceDamageDebounce();
     this->move();
+    this->rehash();
+}
+
+void PlayerCreature::restoreState(const PlayerSnapshot& state) {
+    m_score = state.score;
+    m_lives = state.lives;
+    m_power = state.power;
+    TimingWheel::Frames().Cancel(m_damageTimer);
+    if (state.debounce > 0) {
+        m_damageTimer = TimingWheel::Frames().Schedule(state.debounce);
+    }
+    this->setState(state.x, state.y, state.dx, state.dy, m_speed);
+}
+
+uint64_t PlayerCreature::stateHash() const {
+    uint64_t h = HashCombine(Creature::stateHash(), uint64_t(m_score));
+    h = HashCombine(h, uint64_t(m_lives));
+    h = HashCombine(h, uint64_t(m_power));
+    return HashCombine(h, uint64_t(this->getDamageDebounce()));
 }
 
 
 void PlayerCreature::draw() const {
     
     ofLogVerbose() << "PlayerCreature at (" << m_x << ", " << m_y << ") with speed " << m_speed << std::endl;
-    if (this->m_damage_debounce > 0) {
+    if (this->isInDamageDebounce()) {
         ofSetColor(ofColor::red); // Flash red if in damage debounce
     }
     if (m_sprite) {
@@ -65,40 +63,56 @@ void PlayerCreature::draw() const {
 
 void PlayerCreature::changeSpeed(int speed) {
     m_speed = speed;
+    this->rehash();
 }
 
 void PlayerCreature::loseLife(int debounce) {
-    if (m_damage_debounce <= 0) {
+    if (!this->isInDamageDebounce()) {
         if (m_lives > 0) this->m_lives -= 1;
-        m_damage_debounce = debounce; // Set debounce frames
+        if (debounce > 0) {
+            m_damageTimer = TimingWheel::Frames().Schedule(debounce); // nothing to run, it only has to be pending
+        }
+        this->rehash();
+        EventLog::Get().Record(GameplayEventKind::LifeLost, m_slot, int(AquariumCreatureType::PlayerFish), m_lives);
         ofLogNotice() << "Player lost a life! Lives remaining: " << m_lives << std::endl;
     }
     // If in debounce period, do nothing
-    if (m_damage_debounce > 0) {
-        ofLogVerbose() << "Player is in damage debounce period. Frames left: " << m_damage_debounce << std::endl;
+    if (this->isInDamageDebounce()) {
+        ofLogVerbose() << "Player is in damage debounce period. Frames left: " << this->getDamageDebounce() << std::endl;
     }
 }
 
+void PlayerCreature::increasePower(int value) {
+    m_power += value;
+    this->rehash();
+    EventLog::Get().Record(GameplayEventKind::PowerUp, m_slot, int(AquariumCreatureType::PlayerFish), m_power);
+}
+
 // NPCreature Implementation
-NPCreature::NPCreature(float x, float y, int speed, std::shared_ptr<GameSprite> sprite)
-: Creature(x, y, speed, 30, 1, sprite) {
-    m_dx = (rand() % 3 - 1); // -1, 0, or 1
-    m_dy = (rand() % 3 - 1); // -1, 0, or 1
+NPCreature::NPCreature(float x, float y, float dx, float dy, int speed, AquariumCreatureType type, const CreatureTypeInfo& info, std::shared_ptr<GameSprite> sprite)
+: Creature(x, y, speed, info.radius, info.value, sprite), m_creatureType(type), m_schools(info.schools), m_hunts(info.hunts) {
+    m_dx = dx;
+    m_dy = dy;
     normalize();
-
-    m_creatureType = AquariumCreatureType::NPCreature;
 }
 
-void NPCreature::move() {
-    // Simple AI movement logic (random direction)
-    m_x += m_dx * m_speed;
-    m_y += m_dy * m_speed;
-    if(m_dx < 0 ){
-        this->m_sprite->setFlipped(true);
-    }else {
-        this->m_sprite->setFlipped(false);
-    }
+void NPCreature::applyBehavior(float x, float y, float dx, float dy) {
+    m_x = x;
+    m_y = y;
+    m_dx = dx;
+    m_dy = dy;
+    this->m_sprite->setFlipped(m_dx < 0);
     bounce();
+    this->rehash();
+}
+
+// fish only school with their own type
+int NPCreature::getSchoolGroup() const {
+    return m_schools ? int(m_creatureType) : -1;
+}
+
+bool NPCreature::isPredator() const {
+    return m_hunts;
 }
 
 void NPCreature::draw() const {
@@ -110,196 +124,408 @@ void NPCreature::draw() const {
 }
 
 
-BiggerFish::BiggerFish(float x, float y, int speed, std::shared_ptr<GameSprite> sprite)
-: NPCreature(x, y, speed, sprite) {
-    m_dx = (rand() % 3 - 1);
-    m_dy = (rand() % 3 - 1);
-    normalize();
+// AquariumSpriteManager
+AquariumSpriteManager::AquariumSpriteManager(std::shared_ptr<const CreatureTypeTable> types){
+    for(int t = 0; t < types->size(); ++t){
+        const CreatureTypeInfo& type = types->at(AquariumCreatureType(t));
+        this->m_sprites.push_back(std::make_shared<GameSprite>(type.sprite, type.width, type.height));
+    }
+}
 
-    setCollisionRadius(60); // Bigger fish have a larger collision radius
-    m_value = 5; // Bigger fish have a higher value
-    m_creatureType = AquariumCreatureType::BiggerFish;
+std::shared_ptr<GameSprite> AquariumSpriteManager::GetSprite(AquariumCreatureType t){
+    if(int(t) >= int(this->m_sprites.size())){
+        return nullptr;
+    }
+    return std::make_shared<GameSprite>(*this->m_sprites[int(t)]);
 }
 
-void BiggerFish::move() {
-    // Bigger fish might move slower or have different logic
-    m_x += m_dx * (m_speed * 0.5); // Moves at half speed
-    m_y += m_dy * (m_speed * 0.5);
-    if(m_dx < 0 ){
-        this->m_sprite->setFlipped(true);
-    }else {
-        this->m_sprite->setFlipped(false);
+
+// Aquarium Implementation
+Aquarium::Aquarium(int width, int height, std::shared_ptr<AquariumSpriteManager> spriteManager)
+    : m_width(width), m_height(height), m_pursuit(width, height, AquariumRules::kPursuitCellSize), m_chunks(width, height, 512, 384) {
+        m_sprite_manager =  spriteManager;
+        m_scripts.Start(this->LevelTurnover());
     }
 
-    bounce();
-}
 
-void BiggerFish::draw() const {
-    ofLogVerbose() << "BiggerFish at (" << m_x << ", " << m_y << ") with speed " << m_speed << std::endl;
-    this->m_sprite->draw(this->m_x, this->m_y);
+
+void Aquarium::addCreature(std::shared_ptr<Creature> creature) {
+    creature->setBounds(m_width - AquariumRules::kWallMargin, m_height - AquariumRules::kWallMargin);
+    if (creature->getId() == 0) {
+        creature->setId(m_nextCreatureId++);
+    }
+    creature->attachHash(&m_worldHash);
+    m_creatures.push_back(creature);
+    this->MarkMoved();
 }
 
-//FastFish implementation
-FastFish::FastFish(float x, float y, int speed, std::shared_ptr<GameSprite> sprite)
-: NPCreature(x, y, speed, sprite) {
-    m_dx = (rand() % 3 - 1); // -1, 0, or 1
-    m_dy = (rand() % 3 - 1); // -1, 0, or 1
-    normalize();
+void Aquarium::addAquariumLevel(std::shared_ptr<AquariumLevel> level){
+    if(level == nullptr){return;} // guard to not add noise
+    this->m_aquariumlevels.push_back(level);
+}
 
-    m_value = 3; //Player has to avoid at the start but later can eat
-    m_creatureType = AquariumCreatureType::FastFish;
+void Aquarium::update() {
+    this->School();
+    this->Hunt();
+    m_scheduler.Plan(m_creatures, m_moves);
+    this->Behave();
+    this->MarkMoved();
+    this->Repopulate();
 }
 
-void FastFish::move(){
-	m_x += m_dx * (m_speed * 2);//FastFish moves at double the normal speed
-    m_y += m_dy * (m_speed * 2);//FastFish moves at double the normal speed
-    if(m_dx < 0){
-        this->m_sprite->setFlipped(true);
+// sorts the movers into one set of lanes per type, then each type's program runs once over all of them
+void Aquarium::Behave() {
+    TraceScope trace("Aquarium::Behave");
+    for (BehaviorLanes& lanes : m_behaviorLanes) {
+        lanes.clear();
     }
-    else{
-        this->m_sprite->setFlipped(false);
+    for (const UpdateScheduler::Move& move : m_moves) {
+        Creature& c = *m_creatures[move.index];
+        int type = int(static_cast<NPCreature&>(c).GetType());
+        m_behaviorLanes[type].push(move.index, c.getId(), c.getX(), c.getY(), c.getDirectionX(), c.getDirectionY(), c.getSpeed(), move.ticks);
     }
+    BehaviorContext context;
+    context.targetX = m_focusX;
+    context.targetY = m_focusY;
+    context.tick = m_scheduler.GetTick();
+    for (int t = 0; t < m_types->size(); ++t) {
+        BehaviorLanes& lanes = m_behaviorLanes[t];
+        if (lanes.size() == 0) continue;
+        m_behaviorVM.Run(m_types->at(AquariumCreatureType(t)).program, lanes, context);
+        for (int i = 0; i < lanes.size(); ++i) {
+            static_cast<NPCreature&>(*m_creatures[lanes.index[i]]).applyBehavior(lanes.x[i], lanes.y[i], lanes.dx[i], lanes.dy[i]);
+        }
+    }
+}
 
-    bounce();
+void Aquarium::draw() const {
+    for (const auto& creature : m_creatures) {
+        creature->draw();
+    }
+    m_lastDrawn = m_creatures.size();
+    m_lastCulled = 0;
 }
 
-void FastFish::draw() const {
-    ofLogVerbose() << "FastFish at (" << m_x << ", " << m_y << ") with speed " << m_speed << std::endl;
-    this->m_sprite->draw(this->m_x, this->m_y);
+void Aquarium::draw(const ofRectangle& view) const {
+    TraceScope trace("Aquarium::draw");
+    // creatures are anchored at their top left corner, so the margin mostly matters up and left
+    ofRectangle padded(view.x - kCullMargin, view.y - kCullMargin, view.width + 2 * kCullMargin, view.height + 2 * kCullMargin);
+    this->queryRect(padded, m_visible);
+    for (int index : m_visible) {
+        m_creatures[index]->draw();
+    }
+    m_lastDrawn = m_visible.size();
+    m_lastCulled = m_creatures.size() - m_visible.size();
 }
 
-//VerticalFish implementation
-VerticalFish::VerticalFish(float x, float y, int speed, std::shared_ptr<GameSprite> sprite)
-: NPCreature(x, y, speed, sprite) {
-    m_dx = (rand() % 3 - 1);
-    m_dy = (rand() % 3 - 1);
-    normalize();
+void Aquarium::queryRect(const ofRectangle& rect, std::vector<int>& out) const {
+    out.clear();
+    this->SpatialIndex().ForEachInRect(rect.x, rect.y, rect.x + rect.width, rect.y + rect.height, [&out](int index) {
+        out.push_back(index);
+    });
+}
 
-    setCollisionRadius(60); // Bigger fish have a larger collision radius
-    m_value = 4; // Bigger fish have a higher value
-    m_creatureType = AquariumCreatureType::VerticalFish;
+void Aquarium::collidePlayers(const std::vector<std::shared_ptr<PlayerCreature>>& players, std::vector<PlayerContact>& out) {
+    out.clear();
+    if (players.empty()) return;
+    TraceScope trace("Aquarium::collidePlayers");
+    int creatures = m_creatures.size();
+    int total = creatures + players.size();
+    m_contactX.resize(total);
+    m_contactY.resize(total);
+    m_contactRadius.resize(total);
+    float maxRadius = 0.0f;
+    for (int i = 0; i < total; ++i) {
+        const Creature& c = i < creatures ? *m_creatures[i] : *players[i - creatures];
+        m_contactX[i] = c.getX();
+        m_contactY[i] = c.getY();
+        m_contactRadius[i] = c.getCollisionRadius();
+        maxRadius = std::max(maxRadius, m_contactRadius[i]);
+    }
+    // players can be anywhere in the world, not only in the active chunks
+    m_contactGrid.Build(m_contactX, m_contactY, 0, 0, m_width, m_height, kCullMargin);
+    m_claimed.assign(creatures, 0);
+
+    for (int p = 0; p < int(players.size()); ++p) {
+        int self = creatures + p;
+        float x = m_contactX[self];
+        float y = m_contactY[self];
+        float radius = m_contactRadius[self];
+        int touched = -1; // lowest index wins, same creature the single player scan found first
+        m_contactGrid.ForEachNear(x, y, radius + maxRadius, [&](int index) {
+            float dx = m_contactX[index] - x, dy = m_contactY[index] - y;
+            float reach = radius + m_contactRadius[index];
+            if (dx * dx + dy * dy >= reach * reach) return;
+            if (index < creatures) {
+                if (!m_claimed[index] && (touched < 0 || index < touched)) touched = index;
+            } else if (index > self) { // every pair once
+                PlayerContact contact{p};
+                contact.otherPlayer = index - creatures;
+                out.push_back(contact);
+            }
+        });
+        if (touched >= 0) {
+            m_claimed[touched] = 1;
+            PlayerContact contact{p};
+            contact.creature = touched;
+            out.push_back(contact);
+        }
+    }
 }
-void VerticalFish::move() {
-    // Vertical fish only moves up and down
-    m_y += m_dy * (m_speed * 5);
-    if(m_dx < 0 ){
-        this->m_sprite->setFlipped(true);
-    }else {
-        this->m_sprite->setFlipped(false);
+
+void Aquarium::School() {
+    TraceScope trace("Aquarium::School");
+    m_schooling.Clear();
+    m_schoolMembers.clear();
+    for (const auto& creature : m_creatures) {
+        int group = creature->getSchoolGroup();
+        if (group < 0) continue;
+        m_schooling.Add(creature->getX(), creature->getY(), creature->getDirectionX(), creature->getDirectionY(), group);
+        m_schoolMembers.push_back(creature.get());
+    }
+    // fish only live in the active chunks
+    ofRectangle area = m_chunks.RangeRect(m_chunks.GetActiveRange());
+    m_schooling.Step(area.x, area.y, area.width, area.height);
+    for (size_t i = 0; i < m_schoolMembers.size(); ++i) {
+        m_schoolMembers[i]->steer(m_schooling.GetVx(i), m_schooling.GetVy(i));
     }
+}
 
-    bounce();
+// the field costs the same for one predator or a thousand, each one only samples its cell
+void Aquarium::Hunt() {
+    TraceScope trace("Aquarium::Hunt");
+    m_pursuit.Update(m_focusX, m_focusY);
+    for (const auto& creature : m_creatures) {
+        if (!creature->isPredator()) continue;
+        float dx, dy;
+        if (AquariumRules::Pursue(m_pursuit, creature->getX(), creature->getY(), creature->getDirectionX(), creature->getDirectionY(),
+                                  m_focusX, m_focusY, AquariumRules::kHuntRange, dx, dy)) {
+            creature->steer(dx, dy);
+        }
+    }
 }
-void VerticalFish::draw() const {
-    ofLogVerbose() << "VerticalFish at (" << m_x << ", " << m_y << ") with speed " << m_speed << std::endl;
-    this->m_sprite->draw(this->m_x, this->m_y);
+
+uint64_t Aquarium::getStateHash() const {
+    uint64_t h = HashCombine(m_worldHash.Get(), uint64_t(currentLevel));
+    if (!m_aquariumlevels.empty()) {
+        h = HashCombine(h, uint64_t(m_aquariumlevels[currentLevel % m_aquariumlevels.size()]->GetLevelScore()));
+    }
+    h = HashCombine(h, uint64_t(m_chunks.GetDormantTotal()));
+    h = HashCombine(h, uint64_t(m_spawnQueue.size()));
+    return HashCombine(h, m_spawnRng.GetPosition());
 }
 
-//PowerUp Implementation
-PowerUp::PowerUp(float x, float y, int speed, std::shared_ptr<GameSprite> sprite)
-: NPCreature(x, y, speed, sprite) {
-    m_dx = (rand() % 3 - 1);
-    m_dy = (rand() % 3 - 1);
-    normalize();
+const std::array<int, kMaxCreatureTypes>& Aquarium::getPopulation() const {
+    static const std::array<int, kMaxCreatureTypes> none{};
+    if (m_aquariumlevels.empty()) return none;
+    return m_aquariumlevels[currentLevel % m_aquariumlevels.size()]->GetPopulation();
+}
 
-    m_value = 1;
-    m_creatureType = AquariumCreatureType::PowerUp;
+void Aquarium::captureSnapshot(WorldSnapshot& out) const {
+    out.level = currentLevel;
+    out.levelScore = 0;
+    out.population.clear();
+    if (!m_aquariumlevels.empty()) {
+        const AquariumLevel& level = *m_aquariumlevels[currentLevel % m_aquariumlevels.size()];
+        out.levelScore = level.GetLevelScore();
+        out.population.assign(level.GetPopulation().begin(), level.GetPopulation().begin() + m_types->size());
+    }
+    out.creatures.resize(m_creatures.size());
+    for (size_t i = 0; i < m_creatures.size(); ++i) {
+        Creature& c = *m_creatures[i];
+        AquariumCreatureType type = static_cast<NPCreature&>(c).GetType();
+        out.creatures[i] = CreatureSnapshot{c.getId(), uint8_t(type), c.getX(), c.getY(), c.getDirectionX(), c.getDirectionY(), c.getSpeed()};
+    }
 }
 
-void PowerUp::move() {
-    m_x += m_dx * m_speed;
-    m_y += m_dy * m_speed;
-    if(m_dx < 0 ){
-        this->m_sprite->setFlipped(true);
-    }else {
-        this->m_sprite->setFlipped(false);
+void Aquarium::restoreSnapshot(const WorldSnapshot& snapshot) {
+    TraceScope trace("Aquarium::restoreSnapshot");
+    // both are sorted by id, one merge walk pairs them up
+    m_next_creatures.clear();
+    m_next_creatures.swap(m_creatures);
+    std::vector<std::shared_ptr<Creature>> restored;
+    restored.reserve(snapshot.creatures.size());
+    size_t i = 0;
+    for (const CreatureSnapshot& state : snapshot.creatures) {
+        while (i < m_next_creatures.size() && m_next_creatures[i]->getId() < state.id) {
+            m_next_creatures[i++]->detachHash();
+        }
+        std::shared_ptr<Creature> creature;
+        if (i < m_next_creatures.size() && m_next_creatures[i]->getId() == state.id) {
+            creature = m_next_creatures[i++];
+        } else {
+            // eaten or asleep since then, it comes back under its old id
+            this->CreateCreature(SpawnRequest{AquariumCreatureType(state.type), int(state.x), int(state.y), state.speed, state.dx, state.dy});
+            if (m_creatures.empty()) continue;
+            creature = m_creatures.back();
+            m_creatures.pop_back();
+            creature->setId(state.id);
+        }
+        creature->setState(state.x, state.y, state.dx, state.dy, state.speed);
+        restored.push_back(std::move(creature));
     }
-    bounce();
+    while (i < m_next_creatures.size()) {
+        m_next_creatures[i++]->detachHash();
+    }
+    m_next_creatures.clear();
+    m_creatures.swap(restored);
+
+    if (!m_aquariumlevels.empty()) {
+        currentLevel = snapshot.level;
+        m_aquariumlevels[currentLevel % m_aquariumlevels.size()]->RestoreState(snapshot.levelScore, snapshot.population);
+    }
+    m_spawnQueue.clear(); // the level hands out whatever is still missing on the next tick
+    m_scripts.Emit(GameEventType::CREATURE_REMOVED); // the turnover looks at the restored level
+    this->MarkMoved();
 }
 
-void PowerUp::draw() const {
-    ofLogVerbose() << "PowerUp at (" << m_x << ", " << m_y << ") with speed " << m_speed << std::endl;
-    this->m_sprite->draw(this->m_x, this->m_y);
+const SpatialGrid& Aquarium::SpatialIndex() const {
+    if (m_indexDirty) {
+        TraceScope trace("Aquarium::BuildSpatialIndex");
+        m_indexX.resize(m_creatures.size());
+        m_indexY.resize(m_creatures.size());
+        for (size_t i = 0; i < m_creatures.size(); ++i) {
+            m_indexX[i] = m_creatures[i]->getX();
+            m_indexY[i] = m_creatures[i]->getY();
+        }
+        // creatures only live in the active chunks, so that is all the grid has to cover
+        ofRectangle area = m_chunks.RangeRect(m_chunks.GetActiveRange());
+        m_index.Build(m_indexX, m_indexY, area.x, area.y, area.width, area.height, kCullMargin);
+        m_indexDirty = false;
+    }
+    return m_index;
 }
 
 
-// AquariumSpriteManager
-AquariumSpriteManager::AquariumSpriteManager(){
-    this->m_npc_fish = std::make_shared<GameSprite>("base-fish.png", 70,70);
-    this->m_big_fish = std::make_shared<GameSprite>("bigger-fish.png", 120, 120);
-    this->m_fast_fish = std::make_shared<GameSprite>("Fast Fish.png", 70,70);
-    this->m_vertical_fish = std::make_shared<GameSprite>("Vertical Fish.png", 120, 120);
-    this->m_player_fish = std::make_shared<GameSprite>("Player Fish.png", 70, 70);
-    this->m_powerup = std::make_shared<GameSprite>("Power Up Sprite.png", 50, 50);
+void Aquarium::removeCreature(std::shared_ptr<Creature> creature) {
+    auto it = std::find(m_creatures.begin(), m_creatures.end(), creature);
+    if (it != m_creatures.end()) {
+        ofLogVerbose() << "removing creature " << endl;
+        int selectLvl = this->currentLevel % this->m_aquariumlevels.size();
+        auto npcCreature = std::static_pointer_cast<NPCreature>(creature);
+        AquariumLevel& level = *this->m_aquariumlevels.at(selectLvl);
+        if (level.ConsumePopulation(npcCreature->GetType(), npcCreature->getValue())) {
+            EventLog::Get().Record(GameplayEventKind::Eat, EventLog::kNoPlayer, int(npcCreature->GetType()), level.GetLevelScore());
+            this->m_scripts.Emit(GameEventType::CREATURE_REMOVED);
+        }
+        creature->detachHash();
+        m_creatures.erase(it);
+        this->MarkMoved();
+    }
 }
 
-std::shared_ptr<GameSprite> AquariumSpriteManager::GetSprite(AquariumCreatureType t){
-    switch(t){
-        case AquariumCreatureType::BiggerFish:
-            return std::make_shared<GameSprite>(*this->m_big_fish);
-        case AquariumCreatureType::NPCreature:
-            return std::make_shared<GameSprite>(*this->m_npc_fish);
-        case AquariumCreatureType::FastFish:
-            return std::make_shared<GameSprite>(*this->m_fast_fish);
-        case AquariumCreatureType::VerticalFish:
-            return std::make_shared<GameSprite>(*this->m_vertical_fish);
-        case AquariumCreatureType::PlayerFish:
-            return std::make_shared<GameSprite>(*this->m_player_fish);
-        case AquariumCreatureType::PowerUp:
-            return std::make_shared<GameSprite>(*this->m_powerup);       
-        default:
-            return nullptr;
+void Aquarium::clearCreatures() {
+    TraceScope trace("Aquarium::clearCreatures");
+    for (const auto& creature : m_creatures) {
+        creature->detachHash();
     }
+    m_creatures.clear();
+    m_chunks.Clear();
+    this->MarkMoved();
 }
 
+// wakes the chunks that came close to the camera and puts the ones left behind to sleep
+void Aquarium::UpdateChunks() {
+    TraceScope trace("Aquarium::UpdateChunks");
+    ChunkRange range = this->m_chunks.RangeFor(this->m_view, this->m_activeMargin);
+    ChunkRange previous = this->m_chunks.GetActiveRange();
+    if (range != previous) {
+        this->m_chunks.SetActiveRange(range);
+        for (int cy = range.minY; cy <= range.maxY; ++cy) {
+            for (int cx = range.minX; cx <= range.maxX; ++cx) {
+                if (!previous.contains(cx, cy)) {
+                    this->Hydrate(cx, cy);
+                }
+            }
+        }
+    }
 
-// Aquarium Implementation
-Aquarium::Aquarium(int width, int height, std::shared_ptr<AquariumSpriteManager> spriteManager)
-    : m_width(width), m_height(height) {
-        m_sprite_manager =  spriteManager;
+    // anything that is (or swam) outside the active chunks turns back into a count
+    auto sleeping = std::remove_if(m_creatures.begin(), m_creatures.end(), [this](const std::shared_ptr<Creature>& creature) {
+        if (this->m_chunks.IsActive(creature->getX(), creature->getY())) {
+            return false;
+        }
+        auto npcCreature = std::static_pointer_cast<NPCreature>(creature);
+        this->m_chunks.AddDormant(creature->getX(), creature->getY(), npcCreature->GetType());
+        creature->detachHash();
+        return true;
+    });
+    if (sleeping != m_creatures.end()) {
+        m_creatures.erase(sleeping, m_creatures.end());
+        this->MarkMoved();
     }
+}
 
+void Aquarium::Hydrate(int cx, int cy) {
+    ChunkSummary summary = this->m_chunks.TakeSummary(cx, cy);
+    if (summary.total == 0) { return; }
+    std::vector<SpawnRequest> requests;
+    requests.reserve(summary.total);
+    for (int t = 0; t < m_types->size(); ++t) {
+        requests.insert(requests.end(), summary.dormant[t], SpawnRequest{AquariumCreatureType(t), 0, 0, 0});
+    }
+    this->PlaceSpawns(requests, this->m_chunks.ChunkRect(cx, cy));
+    this->m_spawnQueue.insert(this->m_spawnQueue.end(), requests.begin(), requests.end());
+}
 
 
-void Aquarium::addCreature(std::shared_ptr<Creature> creature) {
-    creature->setBounds(m_width - 20, m_height - 20);
-    m_creatures.push_back(creature);
+// WorldChunkMap
+WorldChunkMap::WorldChunkMap(float worldWidth, float worldHeight, float chunkWidth, float chunkHeight)
+: m_chunkWidth(std::max(1.0f, chunkWidth)), m_chunkHeight(std::max(1.0f, chunkHeight)) {
+    m_columns = std::max(1, int(std::ceil(worldWidth / m_chunkWidth)));
+    m_rows = std::max(1, int(std::ceil(worldHeight / m_chunkHeight)));
 }
 
-void Aquarium::addAquariumLevel(std::shared_ptr<AquariumLevel> level){
-    if(level == nullptr){return;} // guard to not add noise
-    this->m_aquariumlevels.push_back(level);
+ofRectangle WorldChunkMap::ChunkRect(int cx, int cy) const {
+    return ofRectangle(cx * m_chunkWidth, cy * m_chunkHeight, m_chunkWidth, m_chunkHeight);
 }
 
-void Aquarium::update() {
-    for (auto& creature : m_creatures) {
-        creature->move();
+ChunkRange WorldChunkMap::RangeFor(const ofRectangle& view, int margin) const {
+    ChunkRange range;
+    if (view.width <= 0 || view.height <= 0) {
+        // nobody told us where the camera is, keep the whole world awake
+        range.maxX = m_columns - 1;
+        range.maxY = m_rows - 1;
+        return range;
     }
-    this->Repopulate();
+    range.minX = std::max(0, this->ChunkX(view.x) - margin);
+    range.minY = std::max(0, this->ChunkY(view.y) - margin);
+    range.maxX = std::min(m_columns - 1, this->ChunkX(view.x + view.width - 1) + margin);
+    range.maxY = std::min(m_rows - 1, this->ChunkY(view.y + view.height - 1) + margin);
+    return range;
 }
 
-void Aquarium::draw() const {
-    for (const auto& creature : m_creatures) {
-        creature->draw();
-    }
+ofRectangle WorldChunkMap::RangeRect(const ChunkRange& range) const {
+    return ofRectangle(range.minX * m_chunkWidth, range.minY * m_chunkHeight,
+                       (range.maxX - range.minX + 1) * m_chunkWidth, (range.maxY - range.minY + 1) * m_chunkHeight);
 }
 
+void WorldChunkMap::AddDormant(float x, float y, AquariumCreatureType type, int count) {
+    ChunkSummary& summary = m_summaries[this->KeyOf(this->ChunkX(x), this->ChunkY(y))];
+    summary.dormant[int(type)] += count;
+    summary.total += count;
+    m_dormantTotal += count;
+}
 
-void Aquarium::removeCreature(std::shared_ptr<Creature> creature) {
-    auto it = std::find(m_creatures.begin(), m_creatures.end(), creature);
-    if (it != m_creatures.end()) {
-        ofLogVerbose() << "removing creature " << endl;
-        int selectLvl = this->currentLevel % this->m_aquariumlevels.size();
-        auto npcCreature = std::static_pointer_cast<NPCreature>(creature);
-        this->m_aquariumlevels.at(selectLvl)->ConsumePopulation(npcCreature->GetType(), npcCreature->getValue());
-        m_creatures.erase(it);
+ChunkSummary WorldChunkMap::TakeSummary(int cx, int cy) {
+    auto it = m_summaries.find(this->KeyOf(cx, cy));
+    if (it == m_summaries.end()) {
+        return ChunkSummary();
     }
+    ChunkSummary summary = it->second;
+    m_dormantTotal -= summary.total;
+    m_summaries.erase(it);
+    return summary;
 }
 
-void Aquarium::clearCreatures() {
-    m_creatures.clear();
+
+// AquariumCamera
+void AquariumCamera::Follow(float targetX, float targetY, float worldWidth, float worldHeight) {
+    m_x = std::clamp(targetX - m_viewWidth / 2, 0.0f, std::max(0.0f, worldWidth - m_viewWidth));
+    m_y = std::clamp(targetY - m_viewHeight / 2, 0.0f, std::max(0.0f, worldHeight - m_viewHeight));
 }
 
+
 std::shared_ptr<Creature> Aquarium::getCreatureAt(int index) {
     if (index < 0 || size_t(index) >= m_creatures.size()) {
         return nullptr;
@@ -310,33 +536,143 @@ std::shared_ptr<Creature> Aquarium::getCreatureAt(int index) {
 
 
 void Aquarium::SpawnCreature(AquariumCreatureType type) {
-    int x = rand() % this->getWidth();
-    int y = rand() % this->getHeight();
-    int speed = 1 + rand() % 25; // Speed between 1 and 25
-
-    switch (type) {
-        case AquariumCreatureType::NPCreature:
-            this->addCreature(std::make_shared<NPCreature>(x, y, speed, this->m_sprite_manager->GetSprite(AquariumCreatureType::NPCreature)));
-            break;
-        case AquariumCreatureType::BiggerFish:
-            this->addCreature(std::make_shared<BiggerFish>(x, y, speed, this->m_sprite_manager->GetSprite(AquariumCreatureType::BiggerFish)));
-            break;
-        case AquariumCreatureType::FastFish:
-            this->addCreature(std::make_shared<FastFish>(x, y, speed, this->m_sprite_manager->GetSprite(AquariumCreatureType::FastFish)));
-            break;
-        case AquariumCreatureType::VerticalFish:
-            this->addCreature(std::make_shared<VerticalFish>(x, y, speed, this->m_sprite_manager->GetSprite(AquariumCreatureType::VerticalFish)));
-            break;
-        case AquariumCreatureType::PlayerFish:
-            this->addCreature(std::make_shared<PlayerCreature>(x, y, speed, this->m_sprite_manager->GetSprite(AquariumCreatureType::PlayerFish)));
-        case AquariumCreatureType::PowerUp:
-            this->addCreature(std::make_shared<PowerUp>(x, y, speed, this->m_sprite_manager->GetSprite(AquariumCreatureType::PowerUp)));
-            default:
-            ofLogError() << "Unknown creature type to spawn!";
-            break;
+    std::vector<SpawnRequest> request(1);
+    request[0].type = type;
+    this->PlaceSpawns(request, this->m_chunks.RangeRect(this->m_chunks.GetActiveRange()));
+    this->CreateCreature(request[0]);
+}
+
+void Aquarium::SpawnCreatures(AquariumCreatureType type, int count) {
+    PopulationDeficit deficit{type, count};
+    this->SpawnCreatures(DeficitSpan(&deficit, &deficit + 1));
+}
+
+// prebuilt spots are used first. The rest land anywhere in the world: the ones falling in a
+// sleeping chunk only bump its summary, the active ones are placed in one Poisson-disk pass
+void Aquarium::SpawnCreatures(DeficitSpan deficits) {
+    std::vector<SpawnRequest> toPlace;
+    for (const PopulationDeficit& deficit : deficits) {
+        std::vector<SpawnRequest>& prebuilt = this->m_prebuilt[int(deficit.type)];
+        for (int i = 0; i < deficit.count; ++i) {
+            if (!prebuilt.empty() && !this->IsExcluded(prebuilt.back())) {
+                this->m_spawnQueue.push_back(prebuilt.back());
+                prebuilt.pop_back();
+                continue;
+            }
+            if (!prebuilt.empty()) prebuilt.pop_back();
+            float x = this->m_spawnRng.NextFloat() * this->m_width;
+            float y = this->m_spawnRng.NextFloat() * this->m_height;
+            if (this->m_chunks.IsActive(x, y)) {
+                toPlace.push_back(SpawnRequest{deficit.type, 0, 0, 0});
+            } else {
+                this->m_chunks.AddDormant(x, y, deficit.type);
+            }
+        }
     }
+    if (toPlace.empty()) { return; }
+    this->PlaceSpawns(toPlace, this->m_chunks.RangeRect(this->m_chunks.GetActiveRange()));
+    this->m_spawnQueue.insert(this->m_spawnQueue.end(), toPlace.begin(), toPlace.end());
+}
 
-};
+bool Aquarium::IsExcluded(const SpawnRequest& request) const {
+    float dx = request.x - this->m_exclusionX;
+    float dy = request.y - this->m_exclusionY;
+    return dx * dx + dy * dy < this->m_exclusionRadius * this->m_exclusionRadius;
+}
+
+// fills in position and speed inside area, keeping clear of the creatures already there or on their way
+void Aquarium::PlaceSpawns(std::vector<SpawnRequest>& requests, const ofRectangle& area) {
+    std::shared_ptr<AquariumLevel> level = this->m_aquariumlevels.at(this->currentLevel % this->m_aquariumlevels.size());
+    auto inside = [&area](float x, float y) {
+        return x >= area.x && y >= area.y && x < area.x + area.width && y < area.y + area.height;
+    };
+    int total = this->m_creatures.size() + this->m_spawnQueue.size() + requests.size();
+    float spacing = PoissonDiskSampler::FitSpacing(area.width, area.height, total, this->m_spawnSpacing);
+    PoissonDiskSampler sampler(area.width, area.height, spacing);
+    for (const auto& creature : this->m_creatures) {
+        if (inside(creature->getX(), creature->getY())) {
+            sampler.AddExisting(creature->getX() - area.x, creature->getY() - area.y);
+        }
+    }
+    for (const SpawnRequest& pending : this->m_spawnQueue) {
+        if (inside(pending.x, pending.y)) {
+            sampler.AddExisting(pending.x - area.x, pending.y - area.y);
+        }
+    }
+    if (this->m_exclusionRadius > 0) {
+        sampler.AddExclusion(this->m_exclusionX - area.x, this->m_exclusionY - area.y, this->m_exclusionRadius);
+    }
+
+    std::vector<SpawnPoint> points;
+    sampler.Sample(requests.size(), this->m_spawnRng, points);
+    for (size_t i = 0; i < requests.size(); ++i) {
+        requests[i].x = int(area.x + points[i].x);
+        requests[i].y = int(area.y + points[i].y);
+        requests[i].speed = this->m_spawnRng.NextInt(level->GetMinSpeed(), level->GetMaxSpeed());
+        requests[i].dx = this->m_spawnRng.NextInt(-1, 1);
+        requests[i].dy = this->m_spawnRng.NextInt(-1, 1);
+    }
+}
+
+void Aquarium::CreateCreature(const SpawnRequest& request) {
+    // players are the scene's, the tank only holds fish
+    if (request.type == AquariumCreatureType::PlayerFish || int(request.type) >= m_types->size()) {
+        ofLogError() << "Unknown creature type to spawn!";
+        return;
+    }
+    this->addCreature(std::make_shared<NPCreature>(request.x, request.y, request.dx, request.dy, request.speed, request.type, m_types->at(request.type),
+                                                   this->m_sprite_manager->GetSprite(request.type)));
+}
+
+
+// lays out the starting population of a level on a worker thread while the current level plays,
+// sprites are GL resources so the creatures themselves are still created on the game thread
+void Aquarium::PrebuildLevel(int levelIdx) {
+    std::shared_ptr<AquariumLevel> level = this->m_aquariumlevels.at(levelIdx);
+    std::vector<AquariumCreatureType> population = level->FullPopulation();
+    int minSpeed = level->GetMinSpeed();
+    int maxSpeed = level->GetMaxSpeed();
+    int width = this->m_width;
+    int height = this->m_height;
+    float spacing = this->m_spawnSpacing;
+    // its own Philox stream, so the layout does not depend on when the worker runs
+    Philox4x32 rng(this->m_spawnSeed, ++this->m_prebuildCount);
+    this->m_prebuiltLevel = levelIdx;
+    this->m_prebuildJob = std::async(std::launch::async, [population, minSpeed, maxSpeed, width, height, spacing, rng]() mutable {
+        TraceScope trace("Aquarium::PrebuildLevel");
+        PoissonDiskSampler sampler(width, height, PoissonDiskSampler::FitSpacing(width, height, population.size(), spacing));
+        std::vector<SpawnPoint> points;
+        sampler.Sample(population.size(), rng, points);
+        SpawnLayout layout;
+        for (size_t i = 0; i < population.size(); ++i) {
+            SpawnRequest request;
+            request.type = population[i];
+            request.x = int(points[i].x);
+            request.y = int(points[i].y);
+            request.speed = rng.NextInt(minSpeed, maxSpeed);
+            request.dx = rng.NextInt(-1, 1);
+            request.dy = rng.NextInt(-1, 1);
+            layout[int(request.type)].push_back(request);
+        }
+        return layout;
+    });
+}
+
+void Aquarium::CommitSpawns() {
+    if (this->m_spawnQueue.empty()) { return; }
+    TraceScope spawn("Aquarium::SpawnCreatures");
+    this->m_creatures.reserve(this->m_creatures.size() + this->m_spawnQueue.size()); // one growth for the whole batch
+    for (int i = 0; i < this->m_spawnBudget && !this->m_spawnQueue.empty(); ) {
+        const SpawnRequest& request = this->m_spawnQueue.front();
+        if (this->m_chunks.IsActive(request.x, request.y)) {
+            this->CreateCreature(request);
+            ++i;
+        } else {
+            this->m_chunks.AddDormant(request.x, request.y, request.type); // its chunk went to sleep meanwhile
+        }
+        this->m_spawnQueue.pop_front();
+    }
+}
 
 
 // repopulation will be called from the levl class
@@ -344,29 +680,67 @@ void Aquarium::SpawnCreature(AquariumCreatureType type) {
 // once lvl criteria met, we move to new lvl through inner signal asking for new lvl
 // which will mean incrementing the buffer and pointing to a new lvl index
 void Aquarium::Repopulate() {
-    ofLogVerbose("entering phase repopulation");
+    TraceScope trace("Aquarium::Repopulate");
+    FramePhaseScope phase(FramePhase::Repopulate);
+    this->UpdateChunks();
     // lets make the levels circular
     int selectedLevelIdx = this->currentLevel % this->m_aquariumlevels.size();
-    ofLogVerbose() << "the current index: " << selectedLevelIdx << endl;
     std::shared_ptr<AquariumLevel> level = this->m_aquariumlevels.at(selectedLevelIdx);
 
 
     if(level->isCompleted()){
-        level->levelReset();
-        this->currentLevel += 1;
-        selectedLevelIdx = this->currentLevel % this->m_aquariumlevels.size();
-        ofLogNotice()<<"new level reached : " << selectedLevelIdx << std::endl;
-        level = this->m_aquariumlevels.at(selectedLevelIdx);
-        this->clearCreatures();
+        return; // LevelTurnover starts the next level before the next tick
     }
 
-    
-    // now lets find how many to respawn if needed 
-    std::vector<AquariumCreatureType> toRespawn = level->Repopulate();
-    ofLogVerbose() << "amount to repopulate : " << toRespawn.size() << endl;
-    if(toRespawn.size() <= 0 ){return;} // there is nothing for me to do here
-    for(AquariumCreatureType newCreatureType : toRespawn){
-        this->SpawnCreature(newCreatureType);
+    // get the level after this one ready while this one plays
+    int nextLevelIdx = (this->currentLevel + 1) % this->m_aquariumlevels.size();
+    if(!this->m_prebuildJob.valid() && this->m_prebuiltLevel != nextLevelIdx){
+        this->PrebuildLevel(nextLevelIdx);
+    }
+
+    // now lets find how many to respawn if needed, a full tank reports nothing
+    DeficitSpan deficits = level->Repopulate();
+    if(!deficits.empty()){
+        this->SpawnCreatures(deficits);
+    }
+    for(std::vector<SpawnRequest>& unused : this->m_prebuilt){
+        unused.clear();
+    }
+    // the queue is drained by CommitSpawns on every frame, not only the frames the tank ticks on
+}
+
+// sleeps until a creature of the level is eaten and reads the level from scratch every time it
+// wakes, so a restored snapshot is picked up like any other state: a rewind to before the
+// target was reached just keeps playing that level, one to after it turns over once
+Script Aquarium::LevelTurnover(){
+    for(;;){
+        co_await event(GameEventType::CREATURE_REMOVED);
+        if(this->m_aquariumlevels.empty()){ continue; }
+        int level = this->currentLevel;
+        if(!this->m_aquariumlevels.at(level % this->m_aquariumlevels.size())->isCompleted()){ continue; }
+
+        // the next layout is normally ready long before, if not the worker gets a few more frames
+        int nextLevelIdx = (level + 1) % this->m_aquariumlevels.size();
+        while(this->m_prebuildJob.valid() && this->m_prebuiltLevel == nextLevelIdx
+              && this->m_prebuildJob.wait_for(std::chrono::seconds(0)) != std::future_status::ready){
+            co_await frames(1);
+        }
+        std::shared_ptr<AquariumLevel> completed = this->m_aquariumlevels.at(level % this->m_aquariumlevels.size());
+        if(this->currentLevel != level || !completed->isCompleted()){ continue; } // restored meanwhile
+
+        TraceScope transition("Aquarium::LevelTransition");
+        FramePhaseScope transitionPhase(FramePhase::LevelTransition);
+        completed->levelReset();
+        this->currentLevel += 1;
+        ofLogNotice()<<"new level reached : " << nextLevelIdx << std::endl;
+        EventLog::Get().Record(GameplayEventKind::LevelChange, EventLog::kNoPlayer, 0, this->currentLevel);
+        this->clearCreatures();
+        this->m_spawnQueue.clear(); // leftovers belong to the old level
+        if(this->m_prebuildJob.valid() && this->m_prebuiltLevel == nextLevelIdx){
+            this->m_prebuilt = this->m_prebuildJob.get();
+            this->m_prebuiltLevel = -1;
+        }
+        this->m_scripts.Emit(GameEventType::NEW_LEVEL); // the next Repopulate spawns its population
     }
 }
 
@@ -374,165 +748,391 @@ void Aquarium::Repopulate() {
 // Aquarium collision detection
 std::shared_ptr<GameEvent> DetectAquariumCollisions(std::shared_ptr<Aquarium> aquarium, std::shared_ptr<PlayerCreature> player) {
     if (!aquarium || !player) return nullptr;
-    
-    for (int i = 0; i < aquarium->getCreatureCount(); ++i) {
-        std::shared_ptr<Creature> npc = aquarium->getCreatureAt(i);
-        
-        if (npc && checkCollision(player, npc)) {
-            return std::make_shared<GameEvent>(GameEventType::COLLISION, player, npc);
-        }
-    }
-    return nullptr;
+    std::vector<std::shared_ptr<GameEvent>> events;
+    DetectAquariumCollisions(aquarium, {player}, events);
+    return events.empty() ? nullptr : events.front();
 };
 
+void DetectAquariumCollisions(std::shared_ptr<Aquarium> aquarium, const std::vector<std::shared_ptr<PlayerCreature>>& players,
+                              std::vector<std::shared_ptr<GameEvent>>& events) {
+    events.clear();
+    if (!aquarium) return;
+    TraceScope trace("DetectAquariumCollisions");
+    FramePhaseScope phase(FramePhase::Collisions);
+
+    static std::vector<PlayerContact> contacts; // reused, collisions only run on the game thread
+    aquarium->collidePlayers(players, contacts);
+    for (const PlayerContact& contact : contacts) {
+        std::shared_ptr<Creature> other = contact.creature >= 0
+            ? aquarium->getCreatureAt(contact.creature)
+            : std::static_pointer_cast<Creature>(players[contact.otherPlayer]);
+        events.push_back(std::make_shared<GameEvent>(GameEventType::COLLISION, players[contact.player], other));
+    }
+}
+
 //  Imlementation of the AquariumScene
 
 void AquariumGameScene::Update(){
-    std::shared_ptr<GameEvent> event;
-
-    this->m_player->update();
+    this->m_aquarium->getScripts().Run(); // only the scripts whose wait is over
+    this->SteerBots();
+    for(const auto& player : this->m_players){
+        player->update();
+    }
+    this->m_camera.Follow(this->m_player->getX(), this->m_player->getY(), this->m_aquarium->getWidth(), this->m_aquarium->getHeight());
+    this->m_aquarium->setActiveView(this->m_camera.View());
+    this->m_aquarium->setExclusionZone(this->m_player->getX(), this->m_player->getY(), AquariumRules::kPlayerSpawnClearance);
+    this->m_aquarium->setUpdateFocus(this->m_player->getX(), this->m_player->getY());
+    this->m_aquarium->CommitSpawns(); // a few per frame so a level change never lands on one frame
 
+    this->m_ticked = false;
     if (this->updateControl.tick()) {
-        event = DetectAquariumCollisions(this->m_aquarium, this->m_player);
-
-        if (event != nullptr && event->isCollisionEvent()) {
-            ofLogVerbose() << "Collision detected between player and NPC!" << std::endl;
-
-            if(event->creatureB != nullptr){
-                event->print();
-                if(this->m_player->getPower() < event->creatureB->getValue()){
-                    ofLogNotice() << "Player is too weak to eat the creature!" << std::endl;
-                    this->m_player->loseLife(3*60); // 3 frames debounce, 3 seconds at 60fps
+        uint64_t tickStart = ofGetElapsedTimeMicros();
+        DetectAquariumCollisions(this->m_aquarium, this->m_players, this->m_playerEvents);
+        this->m_collisionCount += this->m_playerEvents.size();
+        for(const auto& event : this->m_playerEvents){
+            this->ResolveCollision(*event);
+        }
 
-                    if(this->m_player->getLives() <= 0){
-                        this->m_lastEvent = std::make_shared<GameEvent>(GameEventType::GAME_OVER, this->m_player, nullptr);
-                        return;
-                    }
-                }
-                else{
-                    this->m_aquarium->removeCreature(event->creatureB);
-                    this->m_player->addToScore(1, event->creatureB->getValue());
-
-                    if (this->m_player->getScore() % 25 == 0){
-                        this->m_player->increasePower(1);
-                        ofLogNotice() << "Player power increased to " << this->m_player->getPower() << "!" << std::endl;
-                    }
-                    
-                }
-            } else {
-                ofLogError() << "Error: creatureB is null in collision event." << std::endl;
+        if(this->m_player->getLives() <= 0){
+            this->m_lastEvent = std::make_shared<GameEvent>(GameEventType::GAME_OVER, this->m_player, nullptr);
+            return;
+        }
+        // bots out of lives leave the tank, the player at the keyboard is always index 0
+        for(size_t i = this->m_players.size(); i-- > 1; ){
+            if(this->m_players[i]->getLives() <= 0){
+                ofLogNotice() << "Player " << i << " is out of lives" << std::endl;
+                this->m_players[i]->detachHash();
+                this->m_players.erase(this->m_players.begin() + i);
+                this->m_bots.erase(this->m_bots.begin() + i);
+                this->m_botTurnIn.erase(this->m_botTurnIn.begin() + i);
             }
         }
         this->m_aquarium->update();
+        this->m_tickMicros = ofGetElapsedTimeMicros() - tickStart;
+        this->m_ticked = true;
+    }
+}
+
+void AquariumGameScene::ResolveCollision(const GameEvent& event){
+    ofLogVerbose() << "Collision detected between player and NPC!" << std::endl;
+    auto player = std::static_pointer_cast<PlayerCreature>(event.creatureA);
+    if(event.creatureB == nullptr){
+        ofLogError() << "Error: creatureB is null in collision event." << std::endl;
+        return;
+    }
+
+    // two players, the stronger one bites and the weaker one loses a life
+    if(auto other = std::dynamic_pointer_cast<PlayerCreature>(event.creatureB)){
+        EventLog::Get().Record(GameplayEventKind::Collision, player->getSlot(), int(AquariumCreatureType::PlayerFish), other->getSlot());
+        int fight = AquariumRules::Fight(player->getPower(), other->getPower());
+        if(fight == 0){return;}
+        bool playerWins = fight > 0;
+        PlayerCreature& stronger = playerWins ? *player : *other;
+        PlayerCreature& weaker = playerWins ? *other : *player;
+        int lives = weaker.getLives();
+        weaker.loseLife(AquariumRules::kDamageDebounce);
+        if(weaker.getLives() < lives){
+            this->AwardScore(stronger, weaker.getPower());
+            if(this->m_onCollision){this->m_onCollision(CollisionOutcome::Hurt, event);}
+        }
+        return;
+    }
+
+    event.print();
+    auto creature = std::static_pointer_cast<NPCreature>(event.creatureB);
+    EventLog::Get().Record(GameplayEventKind::Collision, player->getSlot(), int(creature->GetType()), creature->getValue(), creature->getId());
+    if(!AquariumRules::CanEat(player->getPower(), event.creatureB->getValue())){
+        ofLogNotice() << "Player is too weak to eat the creature!" << std::endl;
+        player->loseLife(AquariumRules::kDamageDebounce);
+        if(this->m_onCollision){this->m_onCollision(CollisionOutcome::Hurt, event);}
+    }
+    else{
+        this->m_aquarium->removeCreature(event.creatureB);
+        bool poweredUp = this->AwardScore(*player, event.creatureB->getValue());
+        if(this->m_onCollision){this->m_onCollision(poweredUp ? CollisionOutcome::PoweredUp : CollisionOutcome::Eaten, event);}
+    }
+}
+
+// true when the score landed on a multiple of AquariumRules::kPowerEvery and the player got stronger
+bool AquariumGameScene::AwardScore(PlayerCreature& player, int value){
+    player.addToScore(1, value);
+    bool poweredUp = AquariumRules::EarnsPower(player.getScore());
+    if (poweredUp){
+        player.increasePower(1);
+        ofLogNotice() << "Player power increased to " << player.getPower() << "!" << std::endl;
+    }
+    return poweredUp;
+}
+
+// bots wander, a new random heading every one to two seconds
+void AquariumGameScene::SteerBots(){
+    for(size_t i = 0; i < this->m_players.size(); ++i){
+        if(!this->m_bots[i] || --this->m_botTurnIn[i] > 0){continue;}
+        this->m_botTurnIn[i] = this->m_botRng.NextInt(60, 119);
+        float dx = this->m_botRng.NextFloat() * 2 - 1;
+        float dy = this->m_botRng.NextFloat() * 2 - 1;
+        this->m_players[i]->setDirection(dx, dy);
+        this->m_players[i]->setFlipped(dx < 0);
+    }
+}
+
+void AquariumGameScene::CaptureState(WorldSnapshot& out) const {
+    this->m_aquarium->captureSnapshot(out);
+    out.players.resize(this->m_players.size());
+    for(size_t i = 0; i < this->m_players.size(); ++i){
+        const PlayerCreature& p = *this->m_players[i];
+        out.players[i] = PlayerSnapshot{p.getX(), p.getY(), p.getDirectionX(), p.getDirectionY(),
+                                        p.getScore(), p.getLives(), p.getPower(), p.getDamageDebounce()};
+    }
+}
+
+// bots that dropped out since then stay out
+void AquariumGameScene::RestoreState(const WorldSnapshot& snapshot){
+    this->m_aquarium->restoreSnapshot(snapshot);
+    for(size_t i = 0; i < this->m_players.size() && i < snapshot.players.size(); ++i){
+        this->m_players[i]->restoreState(snapshot.players[i]);
+    }
+    this->m_lastEvent = nullptr;
+    this->m_camera.Follow(this->m_player->getX(), this->m_player->getY(), this->m_aquarium->getWidth(), this->m_aquarium->getHeight());
+    this->m_aquarium->setActiveView(this->m_camera.View());
+}
+
+// announces every level for two seconds
+Script AquariumGameScene::LevelBanners(){
+    for(;;){
+        co_await event(GameEventType::NEW_LEVEL);
+        this->m_banner = "Level " + std::to_string(this->m_aquarium->getCurrentLevel() + 1);
+        co_await frames(kBannerFrames);
+        this->m_banner.clear();
+    }
+}
+
+// bots start wherever the bot stream puts them
+int AquariumGameScene::AddPlayer(std::shared_ptr<PlayerCreature> player, bool bot){
+    if(bot){
+        float x = this->m_botRng.NextFloat() * (this->m_aquarium->getWidth() - 100);
+        float y = this->m_botRng.NextFloat() * (this->m_aquarium->getHeight() - 100);
+        player->setState(x, y, player->getDirectionX(), player->getDirectionY(), player->getSpeed());
     }
+    player->attachHash(&this->m_aquarium->getWorldHash());
+    player->setSlot(this->m_players.size());
+    this->m_players.push_back(std::move(player));
+    this->m_bots.push_back(bot);
+    this->m_botTurnIn.push_back(0);
+    return this->m_players.size() - 1;
+}
 
+AquariumGameScene::AquariumGameScene(std::shared_ptr<PlayerCreature> player, std::shared_ptr<Aquarium> aquarium, string name)
+: m_player(std::move(player)) , m_aquarium(std::move(aquarium)), m_name(name){
+    this->m_botRng = Philox4x32(this->m_aquarium->getSpawnSeed(), kBotStream);
+    this->AddPlayer(this->m_player, false);
+    this->m_aquarium->getScripts().Start(this->LevelBanners());
+    m_camera.setViewSize(ofGetWindowWidth(), ofGetWindowHeight());
+    this->m_layers.AddDynamicLayer("world", [this](){ this->paintWorld(); });
+    this->m_layers.AddDynamicLayer("hud", [this](){
+        this->paintAquariumHUD();
+        if(this->m_players.size() > 1){
+            this->paintScoreboard();
+        }
+        if(this->m_showMinimap){
+            this->paintMinimap();
+        }
+        if(this->m_showCulling){
+            this->paintCullingStats();
+        }
+        if(!this->m_banner.empty()){
+            ofDrawBitmapString(this->m_banner, ofGetWindowWidth() / 2 - 4 * this->m_banner.size(), ofGetWindowHeight() / 3);
+        }
+    });
 }
 
 void AquariumGameScene::Draw() {
-    this->m_player->draw();
-    this->m_aquarium->draw();
-    this->paintAquariumHUD();
+    this->m_layers.Draw();
+}
 
+void AquariumGameScene::paintWorld(){
+    ofPushMatrix();
+    ofTranslate(-this->m_camera.getX(), -this->m_camera.getY()); // world space from here on
+    for(const auto& player : this->m_players){
+        player->draw();
+    }
+    this->m_aquarium->draw(this->m_camera.View());
+    ofPopMatrix();
 }
 
 
+// same layout the bitmap string HUD had, relative to the panel; runs once, a missing font
+// leaves the HUD on the bitmap font instead of being retried every frame
+void AquariumGameScene::SetupHUD(){
+    this->m_hud.Setup("Verdana.ttf", 8, kHudWidth, 60);
+    this->m_hudScore = this->m_hud.AddCounter("Score", 0, 20);
+    this->m_hudPower = this->m_hud.AddCounter("Power", 0, 32);
+    this->m_hudLives = this->m_hud.AddCounter("Lives", 0, 44);
+    this->m_hudLivesPips = this->m_hud.AddPips(5, 53, 20, 5, ofColor::red);
+}
+
+// the values are only compared here, the HUD is repainted when one of them changed
 void AquariumGameScene::paintAquariumHUD(){
-    float panelWidth = ofGetWindowWidth() - 150;
-    ofDrawBitmapString("Score: " + std::to_string(this->m_player->getScore()), panelWidth, 20);
-    ofDrawBitmapString("Power: " + std::to_string(this->m_player->getPower()), panelWidth, 30);
-    ofDrawBitmapString("Lives: " + std::to_string(this->m_player->getLives()), panelWidth, 40);
-    for (int i = 0; i < this->m_player->getLives(); ++i) {
-        ofSetColor(ofColor::red);
-        ofDrawCircle(panelWidth + i * 20, 50, 5);
+    if(!this->m_hud.IsReady()){
+        this->SetupHUD();
     }
+    this->m_hud.SetValue(this->m_hudScore, this->m_player->getScore());
+    this->m_hud.SetValue(this->m_hudPower, this->m_player->getPower());
+    this->m_hud.SetValue(this->m_hudLives, this->m_player->getLives());
+    this->m_hud.SetValue(this->m_hudLivesPips, this->m_player->getLives());
+    this->m_hud.Draw(ofGetWindowWidth() - kHudWidth, 0);
     ofSetColor(ofColor::white); // Reset color to white for other drawings
 }
 
-void AquariumLevel::populationReset(){
-    for(auto node: this->m_levelPopulation){
-        node->currentPopulation = 0; // need to reset the population to ensure they are made a new in the next level
+// second view of the same world, it reuses the spatial index the main view built this frame
+void AquariumGameScene::paintMinimap(){
+    float worldWidth = this->m_aquarium->getWidth();
+    float worldHeight = this->m_aquarium->getHeight();
+    if(worldWidth <= 0 || worldHeight <= 0){return;}
+    float scale = kMinimapWidth / worldWidth;
+    float left = 10;
+    float top = ofGetWindowHeight() - worldHeight * scale - 10;
+
+    ofPushStyle();
+    ofPushMatrix();
+    ofTranslate(left, top);
+    ofScale(scale, scale);
+    ofSetColor(0, 0, 0, 120);
+    ofDrawRectangle(0, 0, worldWidth, worldHeight);
+
+    // dormant chunks only have a count, shade them instead of drawing fish that do not exist
+    const WorldChunkMap& chunks = this->m_aquarium->getChunks();
+    chunks.ForEachSummary([&chunks](int cx, int cy, const ChunkSummary& summary){
+        ofSetColor(255, 255, 255, std::min(40 + 10 * summary.total, 160));
+        ofDrawRectangle(chunks.ChunkRect(cx, cy));
+    });
+
+    this->m_aquarium->queryRect(ofRectangle(0, 0, worldWidth, worldHeight), this->m_minimapItems);
+    ofSetColor(ofColor::orange);
+    for(int index : this->m_minimapItems){
+        auto creature = this->m_aquarium->getCreatureAt(index);
+        ofDrawRectangle(creature->getX(), creature->getY(), 2 / scale, 2 / scale);
+    }
+    ofSetColor(ofColor::yellow);
+    for(size_t i = 1; i < this->m_players.size(); ++i){
+        ofDrawCircle(this->m_players[i]->getX(), this->m_players[i]->getY(), 3 / scale);
     }
+    ofSetColor(ofColor::green);
+    ofDrawCircle(this->m_player->getX(), this->m_player->getY(), 4 / scale);
+
+    ofNoFill();
+    ofSetColor(ofColor::white);
+    ofDrawRectangle(this->m_camera.View());
+    ofPopMatrix();
+    ofPopStyle();
 }
 
-void AquariumLevel::ConsumePopulation(AquariumCreatureType creatureType, int power){
-    for(std::shared_ptr<AquariumLevelPopulationNode> node: this->m_levelPopulation){
-        ofLogVerbose() << "consuming from this level creatures" << endl;
-        if(node->creatureType == creatureType){
-            ofLogVerbose() << "-cosuming from type: " << AquariumCreatureTypeToString(node->creatureType) <<" , currPop: " << node->currentPopulation << endl;
-            if(node->currentPopulation == 0){
-                return;
-            } 
-            node->currentPopulation -= 1;
-            ofLogVerbose() << "+cosuming from type: " << AquariumCreatureTypeToString(node->creatureType) <<" , currPop: " << node->currentPopulation << endl;
-            this->m_level_score += power;
-            return;
-        }
+// one line per player under the HUD, P1 is the one at the keyboard
+void AquariumGameScene::paintScoreboard(){
+    float left = ofGetWindowWidth() - kHudWidth;
+    for(size_t i = 0; i < this->m_players.size(); ++i){
+        const PlayerCreature& player = *this->m_players[i];
+        ofDrawBitmapString("P" + std::to_string(i + 1) + " " + std::to_string(player.getScore())
+            + " pw " + std::to_string(player.getPower()) + " x" + std::to_string(player.getLives()), left, 75 + 12 * i);
     }
 }
 
-bool AquariumLevel::isCompleted(){
-    return this->m_level_score >= this->m_targetScore;
+void AquariumGameScene::paintCullingStats(){
+    ofDrawBitmapString("Drawn: " + std::to_string(this->m_aquarium->getLastDrawn())
+        + " Culled: " + std::to_string(this->m_aquarium->getLastCulled())
+        + " Dormant: " + std::to_string(this->m_aquarium->getDormantCount()), 10, 20);
+}
+
+
+// AquariumLevelTable
+std::shared_ptr<AquariumLevelTable> LoadAquariumLevels(const string& path, const CreatureTypeTable& types, int defaultNpcPopulation){
+    ofXml xml;
+    if(!xml.load(path)){
+        ofLogWarning() << "Could not load " << path << ", using the built in levels" << std::endl;
+        return AquariumLevelTable::BuiltIn();
+    }
+
+    auto table = std::make_shared<AquariumLevelTable>();
+    for(auto node : xml.getChild("levels").getChildren("level")){
+        AquariumLevelDefinition definition;
+        definition.targetScore = node.getAttribute("target").getIntValue();
+        if(auto minSpeed = node.getAttribute("min_speed")){ definition.minSpeed = minSpeed.getIntValue(); }
+        if(auto maxSpeed = node.getAttribute("max_speed")){ definition.maxSpeed = maxSpeed.getIntValue(); }
+        definition.minSpeed = std::max(1, definition.minSpeed);
+        definition.maxSpeed = std::max(definition.minSpeed, definition.maxSpeed);
+
+        bool hasPopulation = false;
+        for(auto creature : node.getChildren()){
+            AquariumCreatureType type;
+            if(!types.Find(creature.getName(), type) || type == AquariumCreatureType::PlayerFish){
+                ofLogWarning() << "Ignoring unknown creature <" << creature.getName() << "> in " << path << std::endl;
+                continue;
+            }
+            definition.population[int(type)] += std::max(0, creature.getIntValue());
+            hasPopulation = true;
+        }
+        if(!hasPopulation){
+            definition.population[int(AquariumCreatureType::NPCreature)] = defaultNpcPopulation;
+        }
+        table->add(definition);
+    }
+
+    if(table->size() == 0){
+        ofLogWarning() << path << " defines no levels, using the built in levels" << std::endl;
+        return AquariumLevelTable::BuiltIn();
+    }
+    ofLogNotice() << "Loaded " << table->size() << " levels from " << path << std::endl;
+    return table;
 }
 
-std::vector<AquariumCreatureType> AquariumLevel::Repopulate() {
-    std::vector<AquariumCreatureType> toRepopulate;
-    for(std::shared_ptr<AquariumLevelPopulationNode> node : this->m_levelPopulation){
-        int delta = node->population - node->currentPopulation;
-        ofLogVerbose() << "to Repopulate :  " << delta << endl;
-        if(delta >0){
-            for(int i = 0; i<delta; i++){
-                toRepopulate.push_back(node->creatureType);
+
+// CreatureTypeTable
+// a <fish> naming a built in type retunes it, any other name declares a new type that starts
+// as a copy of the base fish; the text is the behavior program
+std::shared_ptr<CreatureTypeTable> LoadCreatureTypes(const string& path){
+    auto table = CreatureTypeTable::BuiltIn();
+    ofXml xml;
+    if(!xml.load(path)){
+        ofLogWarning() << "Could not load " << path << ", using the built in creature types" << std::endl;
+        return table;
+    }
+
+    for(auto node : xml.getChild("behaviors").getChildren("fish")){
+        string name = node.getAttribute("type").getValue();
+        AquariumCreatureType type;
+        bool known = table->Find(name, type);
+        if(known && type == AquariumCreatureType::PlayerFish){
+            ofLogWarning() << "Ignoring the player fish in " << path << ", players are not steered by behaviors" << std::endl;
+            continue;
+        }
+        if(!known && (name.empty() || !node.getAttribute("sprite"))){
+            ofLogError() << "New creature type \"" << name << "\" in " << path << " needs a name and a sprite, ignoring it" << std::endl;
+            continue;
+        }
+        CreatureTypeInfo info = table->at(known ? type : AquariumCreatureType::NPCreature);
+        info.name = known ? info.name : name;
+        if(auto sprite = node.getAttribute("sprite")){ info.sprite = sprite.getValue(); }
+        if(auto width = node.getAttribute("width")){ info.width = std::max(1, width.getIntValue()); }
+        if(auto height = node.getAttribute("height")){ info.height = std::max(1, height.getIntValue()); }
+        if(auto value = node.getAttribute("value")){ info.value = std::max(1, value.getIntValue()); }
+        if(auto radius = node.getAttribute("radius")){ info.radius = std::max(1.0f, radius.getFloatValue()); }
+        if(auto schools = node.getAttribute("school")){ info.schools = schools.getIntValue() != 0; }
+        if(auto hunts = node.getAttribute("hunt")){ info.hunts = hunts.getIntValue() != 0; }
+        string error;
+        if(!BehaviorProgram::Compile(node.getValue(), info.program, error)){
+            if(!known){
+                ofLogError() << "Behavior of " << name << " in " << path << ", " << error << ", ignoring the type" << std::endl;
+                continue;
             }
-            node->currentPopulation += delta;
+            ofLogError() << "Behavior of " << name << " in " << path << ", " << error << ", keeping the built in one" << std::endl;
+            info.program = table->at(type).program;
+        }
+        if(known){
+            table->at(type) = info;
+        } else if(!table->add(info, type)){
+            ofLogError() << "No room for creature type " << name << " in " << path << ", there can be " << kMaxCreatureTypes << std::endl;
         }
     }
-    return toRepopulate;
-
-}
-
-
-
-
-// std::vector<AquariumCreatureType> Level_0::Repopulate() {
-//     std::vector<AquariumCreatureType> toRepopulate;
-//     for(std::shared_ptr<AquariumLevelPopulationNode> node : this->m_levelPopulation){
-//         int delta = node->population - node->currentPopulation;
-//         ofLogVerbose() << "to Repopulate :  " << delta << endl;
-//         if(delta >0){
-//             for(int i = 0; i<delta; i++){
-//                 toRepopulate.push_back(node->creatureType);
-//             }
-//             node->currentPopulation += delta;
-//         }
-//     }
-//     return toRepopulate;
-
-// }
-
-// std::vector<AquariumCreatureType> Level_1::Repopulate() {
-//     std::vector<AquariumCreatureType> toRepopulate;
-//     for(std::shared_ptr<AquariumLevelPopulationNode> node : this->m_levelPopulation){
-//         int delta = node->population - node->currentPopulation;
-//         if(delta >0){
-//             for(int i=0; i<delta; i++){
-//                 toRepopulate.push_back(node->creatureType);
-//             }
-//             node->currentPopulation += delta;
-//         }
-//     }
-//     return toRepopulate;
-// }
-
-// std::vector<AquariumCreatureType> Level_2::Repopulate() {
-//     std::vector<AquariumCreatureType> toRepopulate;
-//     for(std::shared_ptr<AquariumLevelPopulationNode> node : this->m_levelPopulation){
-//         int delta = node->population - node->currentPopulation;
-//         if(delta >0){
-//             for(int i=0; i<delta; i++){
-//                 toRepopulate.push_back(node->creatureType);
-//             }
-//             node->currentPopulation += delta;
-//         }
-//     }
-//     return toRepopulate;
-// }
+    ofLogNotice() << "Loaded " << table->size() << " creature types from " << path << std::endl;
+    return table;
+}
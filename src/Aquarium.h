@@ -1,50 +1,41 @@
+#pragma once
 #define NOMINMAX // To avoid min/max macro conflict on Windows
 
 #include <vector>
 #include <memory>
 #include <iostream>
 #include <algorithm>
+#include <array>
+#include <deque>
+#include <functional>
+#include <future>
+#include <unordered_map>
 #include "Core.h"
-
-
-enum class AquariumCreatureType {
-    PlayerFish,
-    NPCreature,
-    BiggerFish,
-    VerticalFish,
-    FastFish,
-    PowerUp
-};
-
-string AquariumCreatureTypeToString(AquariumCreatureType t);
-
-class AquariumLevelPopulationNode{
-    public:
-        AquariumLevelPopulationNode() = default;
-        AquariumLevelPopulationNode(AquariumCreatureType creature_type, int population) {
-            this->creatureType = creature_type;
-            this->population = population;
-            this->currentPopulation = 0;
-        };
-        AquariumCreatureType creatureType;
-        int population;
-        int currentPopulation;
-};
-
-class AquariumLevel : public GameLevel {
+#include "SpawnPlacement.h"
+#include "UpdateScheduler.h"
+#include "SpatialGrid.h"
+#include "Schooling.h"
+#include "FlowField.h"
+#include "HudLayer.h"
+#include "RewindBuffer.h"
+#include "Script.h"
+#include "Behavior.h"
+#include "EventLog.h"
+#include "AquariumRules.h"
+
+
+// Creature types from bin/data/behaviors.xml: the built in rows can be retuned and new types
+// added after them, see that file for the format
+std::shared_ptr<CreatureTypeTable> LoadCreatureTypes(const string& path);
+// Level definitions compiled from bin/data/levels.xml, creatures are named as in types
+std::shared_ptr<AquariumLevelTable> LoadAquariumLevels(const string& path, const CreatureTypeTable& types, int defaultNpcPopulation);
+
+// the level bookkeeping is LevelProgress (AquariumRules.h), shared with the BatchedAquarium
+class AquariumLevel : public GameLevel, public LevelProgress {
     public:
-        AquariumLevel(int levelNumber, int targetScore)
-        : GameLevel(levelNumber), m_level_score(0), m_targetScore(targetScore){};
-        void ConsumePopulation(AquariumCreatureType creature, int power);
-        bool isCompleted() override;
-        void populationReset();
-        void levelReset(){m_level_score=0;this->populationReset();}
-        virtual std::vector<AquariumCreatureType> Repopulate();
-    protected:
-        std::vector<std::shared_ptr<AquariumLevelPopulationNode>> m_levelPopulation;
-        int m_level_score;
-        int m_targetScore;
-
+        AquariumLevel(int levelNumber, std::shared_ptr<const AquariumLevelTable> table)
+        : GameLevel(levelNumber), LevelProgress(levelNumber, std::move(table)) {}
+        bool isCompleted() override { return this->IsCompleted(); }
 };
 
 
@@ -52,11 +43,12 @@ class PlayerCreature : public Creature {
 public:
 
     PlayerCreature(float x, float y, int speed, std::shared_ptr<GameSprite> sprite);
+    ~PlayerCreature() override;
     void move();
     void draw() const;
     void update();
     void changeSpeed(int speed);
-    void setLives(int lives) { m_lives = lives; }
+    void setLives(int lives) { m_lives = lives; this->rehash(); }
     void setDirection(float dx, float dy);
     float isXDirectionActive() { return m_dx != 0; }
     float isYDirectionActive() {return m_dy != 0; }
@@ -67,70 +59,148 @@ public:
     int getLives() const { return m_lives; }
     int getPower() const { return m_power; }
     
-    void addToScore(int amount, int weight=1) { m_score += amount * weight; }
+    void addToScore(int amount, int weight=1) { m_score += amount * weight; this->rehash(); }
     void loseLife(int debounce);
-    void increasePower(int value) { m_power += value; }
-    void reduceDamageDebounce();
+    void increasePower(int value);
+    // index of this player in its scene, what the event log calls it
+    void setSlot(int slot) { m_slot = slot; }
+    int getSlot() const { return m_slot; }
+    bool isInDamageDebounce() const { return TimingWheel::Frames().IsPending(m_damageTimer); }
+    uint64_t stateHash() const override;
+    void restoreState(const PlayerSnapshot& state);
+    int getDamageDebounce() const { return int(TimingWheel::Frames().Remaining(m_damageTimer)); }
 private:
     int m_score = 0;
     int m_lives = 3;
     int m_power = 1; // mark current power lvl
-    int m_damage_debounce = 0; // frames to wait after eating
+    int m_slot = -1;
+    TimingWheel::TimerId m_damageTimer; // pending while the player can't be hurt again
 protected:
     AquariumCreatureType m_creatureType;
 };
 
 
+// every fish of the tank, what kind it is comes from its row of the CreatureTypeTable
 class NPCreature : public Creature {
 public:
-    NPCreature(float x, float y, int speed, std::shared_ptr<GameSprite> sprite);
-    AquariumCreatureType GetType() {return this->m_creatureType;}
-    void move() override;
+    NPCreature(float x, float y, float dx, float dy, int speed, AquariumCreatureType type, const CreatureTypeInfo& info, std::shared_ptr<GameSprite> sprite);
+    AquariumCreatureType GetType() const {return this->m_creatureType;}
     void draw() const override;
+    int getSchoolGroup() const override;
+    bool isPredator() const override;
+    // takes what the behavior program computed for this tick
+    void applyBehavior(float x, float y, float dx, float dy);
 protected:
     AquariumCreatureType m_creatureType;
+    bool m_schools;
+    bool m_hunts;
 
 };
 
-class BiggerFish : public NPCreature {
-public:
-    BiggerFish(float x, float y, int speed, std::shared_ptr<GameSprite> sprite);
-    void move() override;
-    void draw() const override;
+// one loaded sprite per creature type, every creature gets its own copy to flip
+class AquariumSpriteManager {
+    public:
+        explicit AquariumSpriteManager(std::shared_ptr<const CreatureTypeTable> types);
+        ~AquariumSpriteManager() = default;
+        std::shared_ptr<GameSprite>GetSprite(AquariumCreatureType t);
+    private:
+        std::vector<std::shared_ptr<GameSprite>> m_sprites; // by type
 };
-//Fast Fish Class
-class FastFish : public NPCreature{
-public:
-    FastFish(float x, float y, int speed, std::shared_ptr<GameSprite> sprite);
-    void move() override;
-    void draw() const override;
+
+
+// everything needed to create a creature except its sprite, cheap to build off the game thread
+struct SpawnRequest {
+    AquariumCreatureType type;
+    int x;
+    int y;
+    int speed;
+    float dx = 0; // heading, drawn from the spawn stream like the rest
+    float dy = 0;
 };
-//Vertical Fish Class
-class VerticalFish : public NPCreature{
-public:
-    VerticalFish(float x, float y, int speed, std::shared_ptr<GameSprite> sprite);
-    void move() override;
-    void draw() const override;
+
+
+// creatures of a chunk nobody is near, kept as counts until the player comes back
+struct ChunkSummary {
+    std::array<int, kMaxCreatureTypes> dormant{};
+    int total = 0;
 };
-//Power Up Class
-class PowerUp : public NPCreature{
-    public:PowerUp(float x, float y, int sped, std::shared_ptr<GameSprite> sprite);
-    void move() override;
-    void draw() const override;
+
+// inclusive range of chunk coordinates
+struct ChunkRange {
+    int minX = 0;
+    int minY = 0;
+    int maxX = -1;
+    int maxY = -1;
+    bool contains(int cx, int cy) const { return cx >= minX && cx <= maxX && cy >= minY && cy <= maxY; }
+    bool operator==(const ChunkRange& o) const { return minX == o.minX && minY == o.minY && maxX == o.maxX && maxY == o.maxY; }
+    bool operator!=(const ChunkRange& o) const { return !(*this == o); }
 };
 
-class AquariumSpriteManager {
+// The world split into fixed size chunks. Chunks in the active range hold real creatures,
+// every other chunk only keeps a ChunkSummary, and only chunks that have one use memory.
+class WorldChunkMap {
     public:
-        AquariumSpriteManager();
-        ~AquariumSpriteManager() = default;
-        std::shared_ptr<GameSprite>GetSprite(AquariumCreatureType t);
+        WorldChunkMap(float worldWidth, float worldHeight, float chunkWidth, float chunkHeight);
+        int64_t KeyOf(int cx, int cy) const { return int64_t(cy) * m_columns + cx; }
+        int ChunkX(float x) const { return std::clamp(int(x / m_chunkWidth), 0, m_columns - 1); }
+        int ChunkY(float y) const { return std::clamp(int(y / m_chunkHeight), 0, m_rows - 1); }
+        ofRectangle ChunkRect(int cx, int cy) const;
+        // chunks touched by the view plus margin chunks around it
+        ChunkRange RangeFor(const ofRectangle& view, int margin) const;
+        ofRectangle RangeRect(const ChunkRange& range) const;
+
+        const ChunkRange& GetActiveRange() const { return m_active; }
+        void SetActiveRange(const ChunkRange& range) { m_active = range; }
+        bool IsActive(float x, float y) const { return m_active.contains(this->ChunkX(x), this->ChunkY(y)); }
+
+        void AddDormant(float x, float y, AquariumCreatureType type, int count = 1);
+        // hands back the summary of a chunk and forgets it
+        ChunkSummary TakeSummary(int cx, int cy);
+        void Clear() { m_summaries.clear(); m_dormantTotal = 0; }
+        // calls visit(cx, cy, summary) for every chunk that holds dormant creatures
+        template<class Visit>
+        void ForEachSummary(Visit&& visit) const {
+            for (const auto& entry : m_summaries) {
+                visit(int(entry.first % m_columns), int(entry.first / m_columns), entry.second);
+            }
+        }
+        int GetDormantTotal() const { return m_dormantTotal; }
+        int GetSummaryCount() const { return m_summaries.size(); }
+        int GetChunkCount() const { return m_columns * m_rows; }
+        float GetChunkWidth() const { return m_chunkWidth; }
+        float GetChunkHeight() const { return m_chunkHeight; }
     private:
-        std::shared_ptr<GameSprite> m_npc_fish;
-        std::shared_ptr<GameSprite> m_big_fish;
-        std::shared_ptr<GameSprite> m_fast_fish;
-        std::shared_ptr<GameSprite> m_vertical_fish;
-        std::shared_ptr<GameSprite> m_player_fish;
-        std::shared_ptr<GameSprite> m_powerup;
+        float m_chunkWidth;
+        float m_chunkHeight;
+        int m_columns;
+        int m_rows;
+        ChunkRange m_active;
+        std::unordered_map<int64_t, ChunkSummary> m_summaries;
+        int m_dormantTotal = 0;
+};
+
+// follows the player around a world bigger than the window
+class AquariumCamera {
+    public:
+        void setViewSize(float w, float h) { m_viewWidth = w; m_viewHeight = h; }
+        // centers on the target without showing anything outside the world
+        void Follow(float targetX, float targetY, float worldWidth, float worldHeight);
+        ofRectangle View() const { return ofRectangle(m_x, m_y, m_viewWidth, m_viewHeight); }
+        float getX() const { return m_x; }
+        float getY() const { return m_y; }
+    private:
+        float m_x = 0.0f;
+        float m_y = 0.0f;
+        float m_viewWidth = 0.0f;
+        float m_viewHeight = 0.0f;
+};
+
+
+// something a player touched this tick: a creature of the tank or another player
+struct PlayerContact {
+    int player; // index into the players passed to collidePlayers
+    int creature = -1; // index of the creature, or -1
+    int otherPlayer = -1; // index of the other player (always greater than player), or -1
 };
 
 
@@ -143,15 +213,66 @@ public:
     void clearCreatures();
     void update();
     void draw() const;
-    void setBounds(int w, int h) { m_width = w; m_height = h; }
+    // draws only what the view (plus a sprite sized margin) can show
+    void draw(const ofRectangle& view) const;
+    // every creature index within the rectangle, the index is shared by all views of a frame
+    void queryRect(const ofRectangle& rect, std::vector<int>& out) const;
+    int getLastDrawn() const { return m_lastDrawn; }
+    int getLastCulled() const { return m_lastCulled; }
+    void setBounds(int w, int h) {
+        m_width = w;
+        m_height = h;
+        m_chunks = WorldChunkMap(w, h, m_chunks.GetChunkWidth(), m_chunks.GetChunkHeight());
+        m_pursuit = FlowField(w, h, AquariumRules::kPursuitCellSize);
+    }
+    void setChunkSize(float w, float h) { m_chunks = WorldChunkMap(m_width, m_height, w, h); }
+    // what the camera sees, chunks around it are simulated and everything else sleeps
+    void setActiveView(const ofRectangle& view) { m_view = view; }
+    int getDormantCount() const { return m_chunks.GetDormantTotal(); }
+    const WorldChunkMap& getChunks() const { return m_chunks; }
     void setMaxPopulation(int n) { m_maxPopulation = n; }
     void Repopulate();
     void SpawnCreature(AquariumCreatureType type);
+    void SpawnCreatures(AquariumCreatureType type, int count); // queued, created spawn budget at a time
+    // creates up to the spawn budget of the queued creatures, the scene calls it every frame
+    void CommitSpawns();
+    void SpawnCreatures(DeficitSpan deficits);
+    void setSpawnBudget(int n) { m_spawnBudget = std::max(1, n); }
+    void setSpawnSeed(uint64_t seed) { m_spawnSeed = seed; m_spawnRng = Philox4x32(seed); }
+    uint64_t getSpawnSeed() const { return m_spawnSeed; }
+    void setSpawnSpacing(float spacing) { m_spawnSpacing = spacing; }
+    // the player, fish run from it and the scheduler keeps everything around it exact
+    void setUpdateFocus(float x, float y) { m_scheduler.setFocus(x, y); m_schooling.SetThreat(x, y); m_focusX = x; m_focusY = y; }
+    void setSchoolingThreads(int threads) { m_schooling.setThreadCount(threads); }
+    // what every creature type looks like and how it moves, levels name their creatures from it
+    void setCreatureTypes(std::shared_ptr<const CreatureTypeTable> types) { m_types = std::move(types); }
+    const CreatureTypeTable& getCreatureTypes() const { return *m_types; }
+    // nothing spawns inside this circle, the game keeps it centered on the player
+    void setExclusionZone(float x, float y, float radius) { m_exclusionX = x; m_exclusionY = y; m_exclusionRadius = radius; }
+    int getPendingSpawns() const { return m_spawnQueue.size(); }
+    
+    // every player against the tank and against each other through one grid, a creature goes
+    // to the first player touching it and each player reports at most one creature
+    void collidePlayers(const std::vector<std::shared_ptr<PlayerCreature>>& players, std::vector<PlayerContact>& out);
     
     std::shared_ptr<Creature> getCreatureAt(int index);
     int getCreatureCount() const { return m_creatures.size(); }
     int getWidth() const { return m_width; }
     int getHeight() const { return m_height; }
+    int getCurrentLevel() const { return currentLevel; }
+    // creatures of every type the current level has alive, dormant ones included
+    const std::array<int, kMaxCreatureTypes>& getPopulation() const;
+    // checksum of the whole simulation: every creature attached to getWorldHash() plus the level,
+    // dormant and spawn bookkeeping, cheap enough to take every tick
+    uint64_t getStateHash() const;
+    WorldHash& getWorldHash() { return m_worldHash; }
+    // scripts living in this tank, they hear NEW_LEVEL when a level starts and CREATURE_REMOVED
+    // when a level's count goes down
+    ScriptScheduler& getScripts() { return m_scripts; }
+    // creatures and level bookkeeping, for the rewind buffer; players are the scene's
+    void captureSnapshot(WorldSnapshot& out) const;
+    // creatures that exist in both keep their object, the others are created or removed
+    void restoreSnapshot(const WorldSnapshot& snapshot);
 
 
 private:
@@ -159,91 +280,158 @@ private:
     int m_width;
     int m_height;
     int currentLevel = 0;
+    WorldHash m_worldHash; // kept up to date by the creatures themselves, see Creature::rehash
+    uint32_t m_nextCreatureId = 1; // m_creatures stays sorted by id, they only grow
     std::vector<std::shared_ptr<Creature>> m_creatures;
     std::vector<std::shared_ptr<Creature>> m_next_creatures;
     std::vector<std::shared_ptr<AquariumLevel>> m_aquariumlevels;
     std::shared_ptr<AquariumSpriteManager> m_sprite_manager;
+    UpdateScheduler m_scheduler;
+    std::vector<UpdateScheduler::Move> m_moves; // whose turn it is this tick
+    // moves them, one behavior program at a time over all fish of its type
+    void Behave();
+    std::shared_ptr<const CreatureTypeTable> m_types = CreatureTypeTable::BuiltIn();
+    BehaviorVM m_behaviorVM;
+    std::array<BehaviorLanes, kMaxCreatureTypes> m_behaviorLanes;
+    void School();
+    SchoolingSystem m_schooling;
+    std::vector<Creature*> m_schoolMembers; // creature of every fish in m_schooling
+    void Hunt();
+    FlowField m_pursuit;
+    float m_focusX = 0.0f;
+    float m_focusY = 0.0f;
+
+    // chunked world, see WorldChunkMap
+    void UpdateChunks();
+    void Hydrate(int cx, int cy);
+    WorldChunkMap m_chunks;
+    ofRectangle m_view;
+    int m_activeMargin = 1; // chunks kept alive around the view
+
+    // spatial index of the creatures, rebuilt lazily after they move
+    const SpatialGrid& SpatialIndex() const;
+    void MarkMoved() { m_indexDirty = true; }
+    mutable SpatialGrid m_index;
+    mutable std::vector<float> m_indexX;
+    mutable std::vector<float> m_indexY;
+    mutable std::vector<int> m_visible;
+    mutable bool m_indexDirty = true;
+    mutable int m_lastDrawn = 0;
+    mutable int m_lastCulled = 0;
+    static constexpr float kCullMargin = 128.0f; // biggest sprite is 120 px wide
+
+    // broadphase of collidePlayers, creatures first and the players after them
+    SpatialGrid m_contactGrid;
+    std::vector<float> m_contactX;
+    std::vector<float> m_contactY;
+    std::vector<float> m_contactRadius;
+    std::vector<char> m_claimed; // creature already went to a player this tick
+
+    // level turnover is spread over several ticks, the next level's layout is built on a worker
+    Script LevelTurnover();
+    void CreateCreature(const SpawnRequest& request);
+    void PrebuildLevel(int levelIdx);
+    void PlaceSpawns(std::vector<SpawnRequest>& requests, const ofRectangle& area);
+    bool IsExcluded(const SpawnRequest& request) const;
+    using SpawnLayout = std::array<std::vector<SpawnRequest>, kMaxCreatureTypes>;
+    int m_spawnBudget = 8; // creatures created per frame at most
+    std::deque<SpawnRequest> m_spawnQueue;
+    int m_prebuiltLevel = -1;
+    std::future<SpawnLayout> m_prebuildJob;
+    SpawnLayout m_prebuilt; // prebuilt layout of the level that just started, by creature type
+    uint64_t m_spawnSeed = 1;
+    uint64_t m_prebuildCount = 0;
+    Philox4x32 m_spawnRng{1};
+    float m_spawnSpacing = 80.0f; // preferred distance between spawned creatures
+    float m_exclusionX = 0.0f;
+    float m_exclusionY = 0.0f;
+    float m_exclusionRadius = 0.0f;
+
+    ScriptScheduler m_scripts; // last, so scripts are gone before anything they could look at
 };
 
 
 std::shared_ptr<GameEvent> DetectAquariumCollisions(std::shared_ptr<Aquarium> aquarium, std::shared_ptr<PlayerCreature> player);
+// one COLLISION event per contact, creatureA is always the player the contact belongs to
+void DetectAquariumCollisions(std::shared_ptr<Aquarium> aquarium, const std::vector<std::shared_ptr<PlayerCreature>>& players,
+                              std::vector<std::shared_ptr<GameEvent>>& events);
 
 
+// what a collision with the player came to, for feedback like sound effects
+enum class CollisionOutcome {
+    Eaten,
+    PoweredUp, // eaten, and the player got stronger from it
+    Hurt
+};
+
 class AquariumGameScene : public GameScene {
     public:
-        AquariumGameScene(std::shared_ptr<PlayerCreature> player, std::shared_ptr<Aquarium> aquarium, string name)
-        : m_player(std::move(player)) , m_aquarium(std::move(aquarium)), m_name(name){}
+        AquariumGameScene(std::shared_ptr<PlayerCreature> player, std::shared_ptr<Aquarium> aquarium, string name);
         std::shared_ptr<GameEvent> GetLastEvent(){return m_lastEvent;}
         void SetLastEvent(std::shared_ptr<GameEvent> event){this->m_lastEvent = event;}
+        // called on the game thread right after a collision was resolved
+        void SetCollisionListener(std::function<void(CollisionOutcome, const GameEvent&)> listener){this->m_onCollision = std::move(listener);}
         std::shared_ptr<PlayerCreature> GetPlayer(){return this->m_player;}
+        // more fish in the same tank, bots pick their own direction; returns the player index
+        int AddPlayer(std::shared_ptr<PlayerCreature> player, bool bot);
+        const std::vector<std::shared_ptr<PlayerCreature>>& GetPlayers() const { return this->m_players; }
+        // the COLLISION events of the last collision tick, creatureA is the player each one belongs to
+        const std::vector<std::shared_ptr<GameEvent>>& GetPlayerEvents() const { return this->m_playerEvents; }
+        uint64_t GetCollisionCount() const { return this->m_collisionCount; } // resolved since the scene started
+        // whether the last Update() ran a tank tick, and how long that tick took
+        bool TickedLastUpdate() const { return this->m_ticked; }
+        uint64_t GetTickMicros() const { return this->m_tickMicros; }
+        // the whole tank and every player, see RewindBuffer
+        void CaptureState(WorldSnapshot& out) const;
+        void RestoreState(const WorldSnapshot& snapshot);
         std::shared_ptr<Aquarium> GetAquarium(){return this->m_aquarium;}
         string GetName()override {return this->m_name;}
         void Update() override;
         void Draw() override;
+        void SetViewSize(int w, int h) { m_camera.setViewSize(w, h); }
+        void Resize(int w, int h) override { this->SetViewSize(w, h); GameScene::Resize(w, h); }
+        const AquariumCamera& GetCamera() const { return m_camera; }
+        void SetShowMinimap(bool show) { m_showMinimap = show; }
+        bool IsShowingMinimap() const { return m_showMinimap; }
+        void SetShowCulling(bool show) { m_showCulling = show; }
+        bool IsShowingCulling() const { return m_showCulling; }
+        static constexpr float kMinimapWidth = 200.0f;
     private:
+        Script LevelBanners();
+        void ResolveCollision(const GameEvent& event);
+        bool AwardScore(PlayerCreature& player, int value);
+        void SteerBots();
+        void paintWorld();
         void paintAquariumHUD();
-        std::shared_ptr<PlayerCreature> m_player;
+        void paintMinimap();
+        void paintCullingStats();
+        void paintScoreboard();
+        std::shared_ptr<PlayerCreature> m_player; // the one at the keyboard, the camera follows it
+        std::vector<std::shared_ptr<PlayerCreature>> m_players; // m_player first
+        std::vector<bool> m_bots;
+        std::vector<int> m_botTurnIn; // ticks until a bot picks a new direction
+        static constexpr uint64_t kBotStream = ~uint64_t(0); // prebuilt levels count their streams up from 1
+        Philox4x32 m_botRng{1, kBotStream}; // bot starts and turns, from the spawn seed so a seeded game replays
+        std::vector<std::shared_ptr<GameEvent>> m_playerEvents;
+        uint64_t m_collisionCount = 0;
+        bool m_ticked = false;
+        uint64_t m_tickMicros = 0;
         std::shared_ptr<Aquarium> m_aquarium;
         std::shared_ptr<GameEvent> m_lastEvent;
+        std::function<void(CollisionOutcome, const GameEvent&)> m_onCollision;
         string m_name;
-        AwaitFrames updateControl{5};
-};
-
-
-class Level_0 : public AquariumLevel  {
-    public:
-        Level_0(int levelNumber, int targetScore): AquariumLevel(levelNumber, targetScore){
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::NPCreature, 10));
-        };
-        //std::vector<AquariumCreatureType> Repopulate() override;
-
-};
-//Level Classes
-class Level_1 : public AquariumLevel  {
-    public:
-        Level_1(int levelNumber, int targetScore): AquariumLevel(levelNumber, targetScore){
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::NPCreature, 10));
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::FastFish, 10));
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::PowerUp, 1));
-        };
-        //std::vector<AquariumCreatureType> Repopulate() override;
-
-
-};
-class Level_2 : public AquariumLevel  {
-    public:
-        Level_2(int levelNumber, int targetScore): AquariumLevel(levelNumber, targetScore){
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::NPCreature, 20));
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::FastFish, 10));
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::BiggerFish, 2));
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::PowerUp, 1));
-        };
-        //std::vector<AquariumCreatureType> Repopulate() override;
-
+        AwaitFrames updateControl{AquariumRules::kFramesPerTick - 1}; // the tank ticks on every kFramesPerTick-th frame
+        AquariumCamera m_camera;
+        std::vector<int> m_minimapItems;
+        void SetupHUD();
+        HudLayer m_hud;
+        int m_hudScore = -1;
+        int m_hudPower = -1;
+        int m_hudLives = -1;
+        int m_hudLivesPips = -1;
+        static constexpr int kHudWidth = 150;
+        bool m_showMinimap = true;
+        bool m_showCulling = false;
+        string m_banner; // shown in the middle of the screen while not empty
+        static constexpr int kBannerFrames = 120;
 };
-//Added Levels 3 & 4 with new creatures
-class Level_3 : public AquariumLevel  {
-    public:
-        Level_3(int levelNumber, int targetScore): AquariumLevel(levelNumber, targetScore){
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::NPCreature, 10));
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::FastFish, 10));
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::BiggerFish, 5));
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::VerticalFish, 2));
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::PowerUp, 1));
-        };
-        //std::vector<AquariumCreatureType> Repopulate() override;
-
-};
-
-class Level_4 : public AquariumLevel  {
-    public:
-        Level_4(int levelNumber, int targetScore): AquariumLevel(levelNumber, targetScore){
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::NPCreature, 10));
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::FastFish, 10));
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::BiggerFish, 5));
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::VerticalFish, 5));
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::PowerUp, 1));
-        };
-        //std::vector<AquariumCreatureType> Repopulate() override;
-
-};
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include "AquariumRules.h"
+#include <algorithm>
+#include <cmath>
+
+
+// CreatureTypeTable Implementation
+std::shared_ptr<CreatureTypeTable> CreatureTypeTable::BuiltIn() {
+    auto table = std::make_shared<CreatureTypeTable>();
+    auto type = [](const char* name, const char* sprite, int size, int value, float radius, bool schools, bool hunts,
+                   std::initializer_list<BehaviorInstruction> code) {
+        CreatureTypeInfo info;
+        info.name = name;
+        info.sprite = sprite;
+        info.width = size;
+        info.height = size;
+        info.value = value;
+        info.radius = radius;
+        info.schools = schools;
+        info.hunts = hunts;
+        for (const BehaviorInstruction& instruction : code) {
+            info.program.add(instruction);
+        }
+        return info;
+    };
+    // same order as AquariumCreatureType
+    AquariumCreatureType row;
+    table->add(type("PlayerFish", "Player Fish.png", 70, 1, 10.0f, false, false, {}), row);
+    table->add(type("BaseFish", "base-fish.png", 70, 1, 30.0f, true, false, {}), row);
+    table->add(type("BiggerFish", "bigger-fish.png", 120, 5, 60.0f, false, true, {{BehaviorOp::Speed, 0.5f}}), row);
+    table->add(type("VerticalFish", "Vertical Fish.png", 120, 4, 60.0f, false, true, {{BehaviorOp::Axis, 0.0f, 1.0f}, {BehaviorOp::Speed, 5.0f}}), row);
+    table->add(type("FastFish", "Fast Fish.png", 70, 3, 30.0f, true, false, {{BehaviorOp::Speed, 2.0f}}), row);
+    table->add(type("PowerUp", "Power Up Sprite.png", 50, 1, 30.0f, false, false, {}), row);
+    return table;
+}
+
+bool CreatureTypeTable::Find(const std::string& name, AquariumCreatureType& out) const {
+    const std::string& wanted = name == "NPCreature" ? m_types.at(int(AquariumCreatureType::NPCreature)).name : name;
+    for (size_t row = 0; row < m_types.size(); ++row) {
+        if (m_types[row].name == wanted) {
+            out = AquariumCreatureType(row);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CreatureTypeTable::add(const CreatureTypeInfo& info, AquariumCreatureType& out) {
+    if (m_types.size() >= size_t(kMaxCreatureTypes)) return false;
+    out = AquariumCreatureType(m_types.size());
+    m_types.push_back(info);
+    return true;
+}
+
+
+// AquariumLevelTable Implementation
+std::shared_ptr<AquariumLevelTable> AquariumLevelTable::BuiltIn() {
+    auto table = std::make_shared<AquariumLevelTable>();
+    auto level = [](int target, std::initializer_list<std::pair<AquariumCreatureType, int>> population) {
+        AquariumLevelDefinition definition;
+        definition.targetScore = target;
+        for (auto& entry : population) {
+            definition.population[int(entry.first)] = entry.second;
+        }
+        return definition;
+    };
+    table->add(level(10, {{AquariumCreatureType::NPCreature, 10}}));
+    table->add(level(15, {{AquariumCreatureType::NPCreature, 10}, {AquariumCreatureType::FastFish, 10}, {AquariumCreatureType::PowerUp, 1}}));
+    table->add(level(20, {{AquariumCreatureType::NPCreature, 20}, {AquariumCreatureType::FastFish, 10}, {AquariumCreatureType::BiggerFish, 2}, {AquariumCreatureType::PowerUp, 1}}));
+    table->add(level(20, {{AquariumCreatureType::NPCreature, 10}, {AquariumCreatureType::FastFish, 10}, {AquariumCreatureType::BiggerFish, 5}, {AquariumCreatureType::VerticalFish, 2}, {AquariumCreatureType::PowerUp, 1}}));
+    table->add(level(20, {{AquariumCreatureType::NPCreature, 10}, {AquariumCreatureType::FastFish, 10}, {AquariumCreatureType::BiggerFish, 5}, {AquariumCreatureType::VerticalFish, 5}, {AquariumCreatureType::PowerUp, 1}}));
+    return table;
+}
+
+int AquariumLevelTable::GetMaxPopulation() const {
+    int most = 0;
+    for (const AquariumLevelDefinition& level : m_levels) {
+        int total = 0;
+        for (int count : level.population) {
+            total += count;
+        }
+        most = std::max(most, total);
+    }
+    return most;
+}
+
+
+// LevelProgress Implementation
+void LevelProgress::populationReset() {
+    this->m_currentPopulation.fill(0); // need to reset the population to ensure they are made a new in the next level
+    this->m_dirty = true;
+}
+
+bool LevelProgress::ConsumePopulation(AquariumCreatureType creatureType, int value) {
+    int& current = this->m_currentPopulation[int(creatureType)];
+    if (current == 0) {
+        return false;
+    }
+    current -= 1;
+    this->m_dirty = true;
+    this->m_level_score += value;
+    return true;
+}
+
+void LevelProgress::RestoreState(int levelScore, const std::vector<int>& population) {
+    this->m_level_score = levelScore;
+    for (int t = 0; t < kMaxCreatureTypes; ++t) {
+        this->m_currentPopulation[t] = t < int(population.size()) ? population[t] : 0;
+    }
+    this->m_dirty = true;
+}
+
+std::vector<AquariumCreatureType> LevelProgress::FullPopulation() const {
+    std::vector<AquariumCreatureType> population;
+    const AquariumLevelDefinition& definition = this->Definition();
+    for (int t = 0; t < kMaxCreatureTypes; ++t) {
+        population.insert(population.end(), definition.population[t], AquariumCreatureType(t));
+    }
+    return population;
+}
+
+DeficitSpan LevelProgress::Repopulate() {
+    if (!this->m_dirty) {
+        return DeficitSpan(this->m_deficits.data(), this->m_deficits.data());
+    }
+    int count = 0;
+    const AquariumLevelDefinition& definition = this->Definition();
+    for (int t = 0; t < kMaxCreatureTypes; ++t) {
+        int delta = definition.population[t] - this->m_currentPopulation[t];
+        if (delta > 0) {
+            this->m_deficits[count++] = PopulationDeficit{AquariumCreatureType(t), delta};
+            this->m_currentPopulation[t] += delta;
+        }
+    }
+    this->m_dirty = false;
+    return DeficitSpan(this->m_deficits.data(), this->m_deficits.data() + count);
+}
+
+
+// AquariumRules Implementation
+namespace AquariumRules {
+    void Bounce(float& x, float& y, float& dx, float& dy, float width, float height, float boundsWidth, float boundsHeight) {
+        if (boundsWidth <= 0 || boundsHeight <= 0) return;
+        if (x < 0) {
+            x = 0;
+            dx = std::abs(dx);
+        }
+        if (x + width > boundsWidth) {
+            x = boundsWidth - width;
+            dx = -std::abs(dx);
+        }
+        if (y < 0) {
+            y = 0;
+            dy = std::abs(dy);
+        }
+        if (y + height > boundsHeight) {
+            y = boundsHeight - height;
+            dy = -std::abs(dy);
+        }
+    }
+
+    bool Pursue(const FlowField& field, float x, float y, float dx, float dy, float targetX, float targetY,
+                float range, float& outX, float& outY) {
+        if (field.DistanceAt(x, y) > range) return false;
+        float fx, fy;
+        field.Sample(x, y, fx, fy);
+        if (fx == 0 && fy == 0) {
+            // same cell as the player, go straight for it
+            fx = targetX - x;
+            fy = targetY - y;
+        }
+        // turn gradually instead of snapping to the field
+        float nx = dx * (1 - kPursuitTurnRate) + fx * kPursuitTurnRate;
+        float ny = dy * (1 - kPursuitTurnRate) + fy * kPursuitTurnRate;
+        float length = std::sqrt(nx * nx + ny * ny);
+        if (length <= 1e-4f) return false;
+        outX = nx / length;
+        outY = ny / length;
+        return true;
+    }
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Behavior.h"
+#include "FlowField.h"
+
+// The aquarium without openFrameworks: creature types, levels and what happens when a player
+// touches something. The game (Aquarium, AquariumGameScene) and the headless BatchedAquarium
+// both play by these, so agents and load tests run the game people play.
+// The game loads the tables from bin/data (see LoadCreatureTypes and LoadAquariumLevels in Aquarium.h).
+
+// Rows of the CreatureTypeTable. The built in types are named here, the types declared in
+// bin/data/behaviors.xml take the rows after PowerUp.
+enum class AquariumCreatureType : uint8_t {
+    PlayerFish,
+    NPCreature,
+    BiggerFish,
+    VerticalFish,
+    FastFish,
+    PowerUp
+};
+constexpr int kBuiltInCreatureTypes = int(AquariumCreatureType::PowerUp) + 1;
+constexpr int kMaxCreatureTypes = 32; // per type counters are dense arrays of this size
+
+struct CreatureTypeInfo {
+    std::string name;
+    std::string sprite; // image in bin/data
+    int width = 70; // sprite size in px, creatures bounce off the walls with it
+    int height = 70;
+    int value = 1; // power a player needs to eat it, and what eating it is worth
+    float radius = 30.0f; // collision radius
+    bool schools = false; // swims in a school with the other fish of its type
+    bool hunts = false; // follows the pursuit field towards the player
+    BehaviorProgram program; // how it moves, see Behavior.h
+};
+
+class CreatureTypeTable {
+    public:
+        static std::shared_ptr<CreatureTypeTable> BuiltIn(); // the six types the game started with
+        int size() const { return int(m_types.size()); }
+        const CreatureTypeInfo& at(AquariumCreatureType type) const { return m_types.at(int(type)); }
+        CreatureTypeInfo& at(AquariumCreatureType type) { return m_types.at(int(type)); }
+        // by name, NPCreature is another name for BaseFish
+        bool Find(const std::string& name, AquariumCreatureType& out) const;
+        // false when the table already has kMaxCreatureTypes rows
+        bool add(const CreatureTypeInfo& info, AquariumCreatureType& out);
+    private:
+        std::vector<CreatureTypeInfo> m_types;
+};
+
+// One row per level. The rows sit in one flat vector and the population is a dense array
+// indexed by creature type, so level bookkeeping never chases pointers.
+struct AquariumLevelDefinition {
+    int targetScore = 0;
+    int minSpeed = 1;
+    int maxSpeed = 25;
+    std::array<int, kMaxCreatureTypes> population{};
+};
+
+class AquariumLevelTable {
+    public:
+        static std::shared_ptr<AquariumLevelTable> BuiltIn(); // the original five levels
+        int size() const { return m_levels.size(); }
+        const AquariumLevelDefinition& at(int row) const { return m_levels.at(row); }
+        void add(const AquariumLevelDefinition& level) { m_levels.push_back(level); }
+        int GetMaxPopulation() const; // creatures in the most crowded level
+    private:
+        std::vector<AquariumLevelDefinition> m_levels;
+};
+
+// how many creatures of one type a level is missing
+struct PopulationDeficit {
+    AquariumCreatureType type;
+    int count;
+};
+
+// view over the deficits a level reported, only valid until the level is asked again
+class DeficitSpan {
+    public:
+        DeficitSpan(const PopulationDeficit* first, const PopulationDeficit* last) : m_first(first), m_last(last) {}
+        const PopulationDeficit* begin() const { return m_first; }
+        const PopulationDeficit* end() const { return m_last; }
+        bool empty() const { return m_first == m_last; }
+        int size() const { return int(m_last - m_first); }
+    private:
+        const PopulationDeficit* m_first;
+        const PopulationDeficit* m_last;
+};
+
+// Score and live population of one level against its row of the table
+class LevelProgress {
+    public:
+        LevelProgress(int row, std::shared_ptr<const AquariumLevelTable> table) : m_row(row), m_table(std::move(table)) {}
+        virtual ~LevelProgress() = default;
+        // one creature eaten, false when the level had none of that type left to lose
+        bool ConsumePopulation(AquariumCreatureType creature, int value);
+        bool IsCompleted() const { return m_level_score >= this->Definition().targetScore; }
+        void populationReset();
+        void levelReset() { m_level_score = 0; this->populationReset(); }
+        // what is missing since the last call, the counters are marked as refilled;
+        // O(1) when nothing was eaten or reset in between
+        virtual DeficitSpan Repopulate();
+        std::vector<AquariumCreatureType> FullPopulation() const; // every creature the level starts with
+        const AquariumLevelDefinition& Definition() const { return m_table->at(m_row); }
+        int GetMinSpeed() const { return this->Definition().minSpeed; }
+        int GetMaxSpeed() const { return this->Definition().maxSpeed; }
+        int GetLevelScore() const { return m_level_score; }
+        const std::array<int, kMaxCreatureTypes>& GetPopulation() const { return m_currentPopulation; }
+        void RestoreState(int levelScore, const std::vector<int>& population);
+    protected:
+        int m_row;
+        std::shared_ptr<const AquariumLevelTable> m_table;
+        std::array<int, kMaxCreatureTypes> m_currentPopulation{};
+        std::array<PopulationDeficit, kMaxCreatureTypes> m_deficits{};
+        bool m_dirty = true; // counters changed since the last Repopulate
+        int m_level_score = 0;
+};
+
+namespace AquariumRules {
+    constexpr int kFramesPerTick = 6; // players move every frame, the tank (fish, collisions) every sixth
+    constexpr int kDamageDebounce = 3 * 60; // frames a hurt player can't be hurt again
+    constexpr int kPowerEvery = 25; // a player gets stronger whenever its score lands on a multiple of this
+    constexpr float kWallMargin = 20.0f; // creatures bounce this far inside the world
+    constexpr float kPlayerSpawnClearance = 150.0f; // no fish spawns closer than this to the player
+    constexpr float kPursuitCellSize = 128.0f;
+    constexpr float kPursuitTurnRate = 0.3f;
+    constexpr float kHuntRange = 1500.0f; // hunters further away (along the field) keep drifting
+
+    // a player eats what is worth at most its power, anything stronger hurts it
+    inline bool CanEat(int power, int value) { return power >= value; }
+    // true when a player whose score just became this one earned a power level
+    inline bool EarnsPower(int score) { return score % kPowerEvery == 0; }
+    // two players touching: 1 when the first is stronger, -1 when the second is, 0 for a tie
+    inline int Fight(int power, int otherPower) { return (power > otherPower) - (power < otherPower); }
+
+    // keeps a width x height sprite anchored at (x, y) inside the bounds, heading away from the wall it hit
+    void Bounce(float& x, float& y, float& dx, float& dy, float width, float height, float boundsWidth, float boundsHeight);
+    // heading of a hunter at (x, y) after turning along the pursuit field towards the target,
+    // false when it is out of range (along the field) or has nowhere to turn
+    bool Pursue(const FlowField& field, float x, float y, float dx, float dy, float targetX, float targetY,
+                float range, float& outX, float& outY);
+}
@@ -0,0 +1,251 @@
+#include "AudioEngine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+
+
+namespace {
+    uint64_t NowMicros() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    const float kTwoPi = 6.28318530718f;
+}
+
+
+// SfxCommandQueue Implementation
+bool SfxCommandQueue::Push(const SfxCommand& command) {
+    uint64_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) >= kCapacity) {
+        return false;
+    }
+    m_commands[head % kCapacity] = command;
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+bool SfxCommandQueue::Pop(SfxCommand& command) {
+    uint64_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail == m_head.load(std::memory_order_acquire)) {
+        return false;
+    }
+    command = m_commands[tail % kCapacity];
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+
+// AudioEngine Implementation
+SoundClip AudioEngine::Synthesize(const std::string& name, int sampleRate) {
+    SoundClip clip;
+    clip.name = name;
+    auto tone = [&](float seconds, auto sample) {
+        int count = int(seconds * sampleRate);
+        float phase = 0.0f;
+        for (int i = 0; i < count; ++i) {
+            float t = float(i) / count; // 0..1 over the clip
+            clip.samples.push_back(sample(t, phase));
+        }
+    };
+    if (name == "hit") {
+        // low thud with a bit of noise on the attack
+        uint32_t noise = 0x12345678;
+        tone(0.18f, [&](float t, float& phase) {
+            phase += kTwoPi * (140.0f - 80.0f * t) / sampleRate;
+            noise = noise * 1664525u + 1013904223u;
+            float hiss = (int32_t(noise) / 2147483648.0f) * std::max(0.0f, 1.0f - t * 6.0f);
+            return (std::sin(phase) * 0.8f + hiss * 0.3f) * (1.0f - t) * (1.0f - t);
+        });
+    } else if (name == "powerup") {
+        // three rising notes
+        tone(0.3f, [&](float t, float& phase) {
+            float notes[3] = {523.25f, 659.25f, 783.99f};
+            phase += kTwoPi * notes[std::min(2, int(t * 3))] / sampleRate;
+            return std::sin(phase) * 0.5f * (1.0f - t);
+        });
+    } else {
+        // "eat" and anything unknown: a short upward blip
+        tone(0.07f, [&](float t, float& phase) {
+            phase += kTwoPi * (600.0f + 900.0f * t) / sampleRate;
+            return std::sin(phase) * 0.6f * (1.0f - t);
+        });
+    }
+    return clip;
+}
+
+bool AudioEngine::LoadWav(const std::string& path, int sampleRate, SoundClip& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    auto read32 = [&in]() { uint8_t b[4] = {}; in.read(reinterpret_cast<char*>(b), 4); return uint32_t(b[0] | b[1] << 8 | b[2] << 16 | uint32_t(b[3]) << 24); };
+    auto read16 = [&in]() { uint8_t b[2] = {}; in.read(reinterpret_cast<char*>(b), 2); return uint16_t(b[0] | b[1] << 8); };
+
+    char tag[4];
+    in.read(tag, 4);
+    read32();
+    char format[4];
+    in.read(format, 4);
+    if (!in || std::string(tag, 4) != "RIFF" || std::string(format, 4) != "WAVE") return false;
+
+    int channels = 0, rate = 0, bits = 0;
+    while (in) {
+        char chunk[4];
+        in.read(chunk, 4);
+        uint32_t size = read32();
+        if (!in) break;
+        std::string id(chunk, 4);
+        if (id == "fmt ") {
+            uint16_t encoding = read16();
+            channels = read16();
+            rate = read32();
+            read32();
+            read16();
+            bits = read16();
+            in.seekg(size - 16, std::ios::cur);
+            if (encoding != 1 || bits != 16 || channels < 1) {
+                ofLogError() << "AudioEngine only reads 16 bit PCM wav files: " << path << std::endl;
+                return false;
+            }
+        } else if (id == "data" && channels > 0) {
+            std::vector<int16_t> pcm(size / 2);
+            in.read(reinterpret_cast<char*>(pcm.data()), pcm.size() * 2);
+            size_t frames = pcm.size() / channels;
+            // down to mono and to the mixer rate, nearest sample is plenty for short effects
+            size_t outFrames = size_t(double(frames) * sampleRate / rate);
+            out.samples.resize(outFrames);
+            for (size_t i = 0; i < outFrames; ++i) {
+                size_t frame = std::min(frames - 1, size_t(double(i) * rate / sampleRate));
+                float sum = 0.0f;
+                for (int c = 0; c < channels; ++c) sum += pcm[frame * channels + c];
+                out.samples[i] = sum / (channels * 32768.0f);
+            }
+            return true;
+        } else {
+            in.seekg(size + (size & 1), std::ios::cur);
+        }
+    }
+    return false;
+}
+
+int AudioEngine::LoadClip(const std::string& name, const std::string& path) {
+    SoundClip clip;
+    if (!LoadWav(ofToDataPath(path), m_sampleRate, clip)) {
+        clip = Synthesize(name, m_sampleRate);
+    }
+    clip.name = name;
+    return this->AddClip(std::move(clip));
+}
+
+int AudioEngine::AddClip(SoundClip clip) {
+    if (m_started) {
+        ofLogError() << "AudioEngine clips must be added before Start" << std::endl;
+        return -1;
+    }
+    m_clips.push_back(std::move(clip));
+    return int(m_clips.size()) - 1;
+}
+
+int AudioEngine::FindClip(const std::string& name) const {
+    for (size_t i = 0; i < m_clips.size(); ++i) {
+        if (m_clips[i].name == name) return int(i);
+    }
+    return -1;
+}
+
+bool AudioEngine::Start(int sampleRate, int bufferSize) {
+    m_sampleRate = sampleRate;
+    m_bufferSize = bufferSize;
+    ofSoundStreamSettings settings;
+    settings.setOutListener(this);
+    settings.sampleRate = sampleRate;
+    settings.numOutputChannels = 2;
+    settings.numInputChannels = 0;
+    settings.bufferSize = bufferSize;
+    settings.numBuffers = kBufferCount;
+    m_started = m_stream.setup(settings);
+    if (!m_started) {
+        ofLogError() << "AudioEngine could not open an output stream" << std::endl;
+    }
+    return m_started;
+}
+
+void AudioEngine::Stop() {
+    if (m_started) {
+        m_stream.close();
+        m_started = false;
+    }
+}
+
+bool AudioEngine::Trigger(int clip, float gain, float pan) {
+    if (!m_started || clip < 0 || clip >= int(m_clips.size())) return false;
+    SfxCommand command{clip, gain, std::clamp(pan, -1.0f, 1.0f), NowMicros()};
+    if (!m_commands.Push(command)) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void AudioEngine::StartVoice(const SfxCommand& command, uint64_t now, size_t frames) {
+    // a free voice, otherwise the one closest to its end
+    Voice* voice = &m_voices[0];
+    for (Voice& candidate : m_voices) {
+        if (candidate.clip == nullptr) {
+            voice = &candidate;
+            break;
+        }
+        if (candidate.position > voice->position) {
+            voice = &candidate;
+        }
+    }
+    if (voice->clip != nullptr) {
+        m_stolen.fetch_add(1, std::memory_order_relaxed);
+    }
+    voice->clip = &m_clips[command.clip];
+    voice->position = 0;
+    // equal power pan
+    float angle = (command.pan + 1.0f) * 0.25f * 3.14159265f;
+    voice->gainLeft = command.gain * std::cos(angle);
+    voice->gainRight = command.gain * std::sin(angle);
+
+    // the sound reaches the speaker once the buffers queued ahead of this one have played,
+    // counted with the size the device actually asks for, which can differ from the one requested
+    uint64_t latency = now - command.issuedMicros + uint64_t(kBufferCount - 1) * frames * 1000000 / m_sampleRate;
+    uint64_t worst = m_maxLatencyMicros.load(std::memory_order_relaxed);
+    if (latency > worst) {
+        m_maxLatencyMicros.store(latency, std::memory_order_relaxed);
+    }
+}
+
+void AudioEngine::audioOut(ofSoundBuffer& buffer) {
+    uint64_t now = NowMicros();
+    size_t frames = buffer.getNumFrames();
+    SfxCommand command;
+    while (m_commands.Pop(command)) {
+        this->StartVoice(command, now, frames);
+    }
+
+    size_t channels = buffer.getNumChannels();
+    for (size_t i = 0; i < frames * channels; ++i) {
+        buffer[i] = 0.0f;
+    }
+    for (Voice& voice : m_voices) {
+        if (voice.clip == nullptr) continue;
+        const std::vector<float>& samples = voice.clip->samples;
+        size_t count = std::min(frames, samples.size() - voice.position);
+        for (size_t f = 0; f < count; ++f) {
+            float sample = samples[voice.position + f];
+            buffer[f * channels] += sample * voice.gainLeft;
+            if (channels > 1) buffer[f * channels + 1] += sample * voice.gainRight;
+        }
+        voice.position += count;
+        if (voice.position >= samples.size()) {
+            voice.clip = nullptr;
+        }
+    }
+    for (size_t i = 0; i < frames * channels; ++i) {
+        buffer[i] = std::clamp(buffer[i], -1.0f, 1.0f);
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ofMain.h"
+
+// decoded mono PCM, mixed as is
+struct SoundClip {
+    std::string name;
+    std::vector<float> samples;
+};
+
+// what the game thread asks the audio thread to play
+struct SfxCommand {
+    int clip = -1;
+    float gain = 1.0f;
+    float pan = 0.0f; // -1 left, 1 right
+    uint64_t issuedMicros = 0;
+};
+
+// Single producer (game thread) / single consumer (audio thread) ring, no locks on either side
+class SfxCommandQueue {
+    public:
+        bool Push(const SfxCommand& command);
+        bool Pop(SfxCommand& command);
+        static constexpr size_t kCapacity = 64;
+    private:
+        std::array<SfxCommand, kCapacity> m_commands;
+        std::atomic<uint64_t> m_head{0};
+        std::atomic<uint64_t> m_tail{0};
+};
+
+// Short effects are decoded into PCM up front and mixed by the audio callback through a fixed
+// pool of voices, so playing one allocates nothing and only waits for the next audio buffer.
+// Clips have to be added before Start, the audio thread reads them without locking.
+class AudioEngine : public ofBaseSoundOutput {
+    public:
+        ~AudioEngine() override { this->Stop(); }
+
+        // 16 bit PCM .wav, or the built in synthesized effect with the same name when the file is missing
+        int LoadClip(const std::string& name, const std::string& path);
+        int AddClip(SoundClip clip);
+        int FindClip(const std::string& name) const;
+
+        bool Start(int sampleRate = kSampleRate, int bufferSize = kBufferSize);
+        void Stop();
+
+        // game thread, never blocks; false when the queue is full or the clip is unknown
+        bool Trigger(int clip, float gain = 1.0f, float pan = 0.0f);
+        bool Trigger(const std::string& name, float gain = 1.0f, float pan = 0.0f) { return this->Trigger(this->FindClip(name), gain, pan); }
+
+        void audioOut(ofSoundBuffer& buffer) override;
+
+        uint64_t GetMaxTriggerLatencyMicros() const { return m_maxLatencyMicros.load(std::memory_order_relaxed); }
+        bool IsWithinLatencyBudget() const { return this->GetMaxTriggerLatencyMicros() < kLatencyBudgetMicros; }
+        uint64_t GetStolenVoices() const { return m_stolen.load(std::memory_order_relaxed); }
+        uint64_t GetDroppedTriggers() const { return m_dropped.load(std::memory_order_relaxed); }
+
+        static SoundClip Synthesize(const std::string& name, int sampleRate = kSampleRate);
+        static bool LoadWav(const std::string& path, int sampleRate, SoundClip& out);
+
+        static constexpr int kVoiceCount = 16;
+        static constexpr int kSampleRate = 48000;
+        static constexpr int kBufferSize = 128; // 2.7 ms at 48 kHz
+        static constexpr int kBufferCount = 2;
+        static constexpr uint64_t kLatencyBudgetMicros = 10000; // from Trigger to the speaker
+        // a trigger waits at most one buffer for the callback, then plays after the ones already queued
+        static_assert(uint64_t(kBufferCount) * kBufferSize * 1000000 / kSampleRate < kLatencyBudgetMicros,
+                      "the buffers alone use up the latency budget");
+    private:
+        struct Voice {
+            const SoundClip* clip = nullptr;
+            size_t position = 0;
+            float gainLeft = 0.0f;
+            float gainRight = 0.0f;
+        };
+        void StartVoice(const SfxCommand& command, uint64_t now, size_t frames);
+
+        std::vector<SoundClip> m_clips;
+        std::array<Voice, kVoiceCount> m_voices;
+        SfxCommandQueue m_commands;
+        ofSoundStream m_stream;
+        bool m_started = false;
+        int m_sampleRate = kSampleRate;
+        int m_bufferSize = kBufferSize;
+        std::atomic<uint64_t> m_maxLatencyMicros{0};
+        std::atomic<uint64_t> m_stolen{0};
+        std::atomic<uint64_t> m_dropped{0};
+};
@@ -0,0 +1,510 @@
+#include "BatchedEnv.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <new>
+#include "Behavior.h"
+#include "FlowField.h"
+#include "Schooling.h"
+#include "SpawnPlacement.h"
+
+
+namespace {
+    const float kActionX[9] = {0, 0, 1, 1, 1, 0, -1, -1, -1};
+    const float kActionY[9] = {0, -1, -1, 0, 1, 1, 1, 0, -1};
+    const int kSpawnTries = 8; // uniform spots tried before one may land near the player anyway
+
+    size_t AlignUp(size_t value) { return (value + 63) & ~size_t(63); }
+
+    // same as PlayerCreature::loseLife, true when a life was lost
+    bool Hurt(int& lives, int& debounce) {
+        if (debounce > 0) return false;
+        if (lives > 0) lives -= 1;
+        debounce = AquariumRules::kDamageDebounce;
+        return true;
+    }
+
+    // same as AquariumGameScene::AwardScore
+    void Award(int& score, int& power, int value) {
+        score += value;
+        if (AquariumRules::EarnsPower(score)) power += 1;
+    }
+}
+
+// what a tank tick borrows, kept per worker so the steps allocate nothing once warm
+struct BatchedAquarium::Scratch {
+    struct Contact {
+        int player;
+        int creature; // -1 for a contact between two players
+        int otherPlayer;
+    };
+    Scratch(float width, float height) : pursuit(width, height, AquariumRules::kPursuitCellSize), lanes(kMaxCreatureTypes) {}
+
+    SchoolingSystem schooling;
+    FlowField pursuit;
+    BehaviorVM vm;
+    std::vector<BehaviorLanes> lanes; // one per creature type
+    std::vector<int> members;
+    std::vector<Contact> contacts;
+    std::vector<uint8_t> eaten;
+    std::vector<float> rewards;
+};
+
+
+BatchedAquarium::BatchedAquarium(const Config& config)
+: m_config(config) {
+    m_config.environments = std::max(1, m_config.environments);
+    m_config.players = std::max(1, m_config.players);
+    if (!m_config.types) m_config.types = CreatureTypeTable::BuiltIn();
+    if (!m_config.levels) m_config.levels = AquariumLevelTable::BuiltIn();
+    m_capacity = std::max(1, m_config.levels->GetMaxPopulation());
+    size_t envs = size_t(m_config.environments);
+    size_t slots = envs * size_t(m_capacity);
+
+    // offsets first, then a single allocation for everything
+    size_t tanks = 0;
+    size_t players = AlignUp(tanks + envs * sizeof(Tank));
+    size_t x = AlignUp(players + envs * size_t(m_config.players) * sizeof(Player));
+    size_t y = AlignUp(x + slots * sizeof(float));
+    size_t dx = AlignUp(y + slots * sizeof(float));
+    size_t dy = AlignUp(dx + slots * sizeof(float));
+    size_t speed = AlignUp(dy + slots * sizeof(float));
+    size_t id = AlignUp(speed + slots * sizeof(float));
+    size_t type = AlignUp(id + slots * sizeof(uint32_t));
+    m_bytes = AlignUp(type + slots * sizeof(uint8_t));
+    m_memory.reset(new unsigned char[m_bytes + 64]);
+    unsigned char* base = reinterpret_cast<unsigned char*>(AlignUp(reinterpret_cast<uintptr_t>(m_memory.get())));
+    m_tanks = new (base + tanks) Tank[envs];
+    m_players = new (base + players) Player[envs * size_t(m_config.players)];
+    m_x = reinterpret_cast<float*>(base + x);
+    m_y = reinterpret_cast<float*>(base + y);
+    m_dx = reinterpret_cast<float*>(base + dx);
+    m_dy = reinterpret_cast<float*>(base + dy);
+    m_speed = reinterpret_cast<float*>(base + speed);
+    m_id = reinterpret_cast<uint32_t*>(base + id);
+    m_type = base + type;
+    m_progress.assign(envs, LevelProgress(0, m_config.levels));
+
+    int threads = m_config.threads > 0 ? m_config.threads : int(std::max(1u, std::thread::hardware_concurrency()));
+    m_threadCount = std::min(threads, m_config.environments);
+    for (int worker = 0; worker < m_threadCount; ++worker) {
+        m_scratch.push_back(std::make_unique<Scratch>(m_config.width, m_config.height));
+    }
+    for (int worker = 1; worker < m_threadCount; ++worker) { // the caller is worker 0
+        m_workers.emplace_back(&BatchedAquarium::WorkerLoop, this, worker);
+    }
+    this->Reset();
+}
+
+BatchedAquarium::~BatchedAquarium() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void BatchedAquarium::Reset() {
+    this->RunParallel([this](int, int first, int last) {
+        for (int env = first; env < last; ++env) this->ResetTank(env);
+    });
+}
+
+void BatchedAquarium::ResetTank(int env) {
+    Tank& tank = m_tanks[env];
+    tank.level = 0;
+    tank.count = 0;
+    tank.nextId = 1;
+    tank.tick = 0;
+    tank.rngPosition = 0;
+
+    // every tank draws from its own Philox stream, so results don't depend on the thread count
+    Philox4x32 rng(m_config.seed, uint64_t(env));
+    Player* players = m_players + size_t(env) * m_config.players;
+    for (int i = 0; i < m_config.players; ++i) {
+        Player& p = players[i];
+        // where ofApp puts the player and its bots
+        p.x = i == 0 ? m_config.width / 2 - 50 : rng.NextFloat() * (m_config.width - 100);
+        p.y = i == 0 ? m_config.height / 2 - 50 : rng.NextFloat() * (m_config.height - 100);
+        p.dx = 0.0f;
+        p.dy = 0.0f;
+        p.lives = 3;
+        p.power = 1;
+        p.score = 0;
+        p.debounce = 0;
+        p.active = true;
+    }
+    tank.rngPosition = rng.GetPosition();
+
+    m_progress[env] = LevelProgress(0, m_config.levels);
+    this->Repopulate(env);
+}
+
+// the game places its spawns with a Poisson-disk pass, here a uniform spot clear of player 0 is enough
+void BatchedAquarium::Spawn(int env, const DeficitSpan& deficits) {
+    Tank& tank = m_tanks[env];
+    const Player& focus = m_players[size_t(env) * m_config.players];
+    const LevelProgress& level = m_progress[env];
+    Philox4x32 rng(m_config.seed, uint64_t(env));
+    rng.Seek(tank.rngPosition);
+    float clearance = AquariumRules::kPlayerSpawnClearance;
+    size_t base = size_t(env) * m_capacity;
+    for (const PopulationDeficit& deficit : deficits) {
+        // players are the scene's, the tank only holds fish
+        if (deficit.type == AquariumCreatureType::PlayerFish || int(deficit.type) >= m_config.types->size()) continue;
+        for (int n = 0; n < deficit.count && tank.count < m_capacity; ++n) {
+            size_t i = base + tank.count++;
+            for (int attempt = 0; attempt < kSpawnTries; ++attempt) {
+                m_x[i] = rng.NextFloat() * m_config.width;
+                m_y[i] = rng.NextFloat() * m_config.height;
+                float ex = m_x[i] - focus.x, ey = m_y[i] - focus.y;
+                if (ex * ex + ey * ey >= clearance * clearance) break;
+            }
+            // same as the NPCreature constructor
+            float dx = float(rng.NextInt(-1, 1));
+            float dy = float(rng.NextInt(-1, 1));
+            float length = std::sqrt(dx * dx + dy * dy);
+            m_dx[i] = length > 0 ? dx / length : 0.0f;
+            m_dy[i] = length > 0 ? dy / length : 0.0f;
+            m_speed[i] = float(rng.NextInt(level.GetMinSpeed(), level.GetMaxSpeed()));
+            m_id[i] = tank.nextId++;
+            m_type[i] = uint8_t(deficit.type);
+        }
+    }
+    tank.rngPosition = rng.GetPosition();
+}
+
+void BatchedAquarium::Step(const int* actions, float* observations, float* rewards, uint8_t* dones) {
+    int players = m_config.players;
+    this->RunParallel([&](int worker, int first, int last) {
+        Scratch& scratch = *m_scratch[worker];
+        for (int env = first; env < last; ++env) {
+            size_t slot = size_t(env) * players;
+            this->StepTank(env, scratch, actions + slot, observations + slot * ObservationSize(),
+                           rewards ? rewards + slot : nullptr, dones ? dones + env : nullptr);
+        }
+    });
+    m_steps += uint64_t(m_config.environments);
+}
+
+// one tank tick in the order of AquariumGameScene::Update
+void BatchedAquarium::StepTank(int env, Scratch& scratch, const int* actions, float* observations, float* rewards, uint8_t* done) {
+    int count = m_config.players;
+    scratch.rewards.assign(count, 0.0f);
+    this->MovePlayers(env, actions);
+    this->Collide(env, scratch, scratch.rewards.data());
+
+    Player* players = m_players + size_t(env) * count;
+    bool over = players[0].lives <= 0;
+    if (!over) {
+        // the other players out of lives leave the tank
+        for (int i = 1; i < count; ++i) {
+            if (players[i].lives <= 0) players[i].active = false;
+        }
+        this->Swim(env, scratch);
+        this->Repopulate(env);
+        m_tanks[env].tick += 1;
+    }
+
+    if (rewards) std::copy(scratch.rewards.begin(), scratch.rewards.end(), rewards);
+    if (done) *done = over ? 1 : 0;
+    if (over) this->ResetTank(env);
+    for (int i = 0; i < count; ++i) {
+        this->Observe(env, i, observations + size_t(i) * ObservationSize());
+    }
+}
+
+// the frames between two tank ticks, same as PlayerCreature::update on each of them
+void BatchedAquarium::MovePlayers(int env, const int* actions) {
+    const CreatureTypeInfo& sprite = m_config.types->at(AquariumCreatureType::PlayerFish);
+    float boundsWidth = m_config.width - AquariumRules::kWallMargin;
+    float boundsHeight = m_config.height - AquariumRules::kWallMargin;
+    Player* players = m_players + size_t(env) * m_config.players;
+    for (int i = 0; i < m_config.players; ++i) {
+        Player& p = players[i];
+        if (!p.active) continue;
+        int action = std::clamp(actions[i], 0, 8);
+        float length = std::sqrt(kActionX[action] * kActionX[action] + kActionY[action] * kActionY[action]);
+        p.dx = length > 0 ? kActionX[action] / length : 0.0f;
+        p.dy = length > 0 ? kActionY[action] / length : 0.0f;
+        for (int frame = 0; frame < AquariumRules::kFramesPerTick; ++frame) {
+            p.x += p.dx * m_config.playerSpeed;
+            p.y += p.dy * m_config.playerSpeed;
+            AquariumRules::Bounce(p.x, p.y, p.dx, p.dy, float(sprite.width), float(sprite.height), boundsWidth, boundsHeight);
+        }
+        p.debounce = std::max(0, p.debounce - AquariumRules::kFramesPerTick);
+    }
+}
+
+// contacts in the order of Aquarium::collidePlayers, then resolved like AquariumGameScene::ResolveCollision
+void BatchedAquarium::Collide(int env, Scratch& scratch, float* rewards) {
+    Tank& tank = m_tanks[env];
+    Player* players = m_players + size_t(env) * m_config.players;
+    size_t base = size_t(env) * m_capacity;
+    const CreatureTypeTable& types = *m_config.types;
+    float playerRadius = types.at(AquariumCreatureType::PlayerFish).radius;
+
+    scratch.contacts.clear();
+    scratch.eaten.assign(tank.count, 0);
+    for (int p = 0; p < m_config.players; ++p) {
+        if (!players[p].active) continue;
+        float x = players[p].x, y = players[p].y;
+        for (int q = p + 1; q < m_config.players; ++q) { // every pair once
+            if (!players[q].active) continue;
+            float ex = players[q].x - x, ey = players[q].y - y;
+            float reach = 2 * playerRadius;
+            if (ex * ex + ey * ey < reach * reach) scratch.contacts.push_back(Scratch::Contact{p, -1, q});
+        }
+        for (int i = 0; i < tank.count; ++i) { // lowest unclaimed index wins
+            if (scratch.eaten[i]) continue;
+            float ex = m_x[base + i] - x, ey = m_y[base + i] - y;
+            float reach = playerRadius + types.at(AquariumCreatureType(m_type[base + i])).radius;
+            if (ex * ex + ey * ey >= reach * reach) continue;
+            scratch.eaten[i] = 1;
+            scratch.contacts.push_back(Scratch::Contact{p, i, -1});
+            break;
+        }
+    }
+
+    std::fill(scratch.eaten.begin(), scratch.eaten.end(), 0);
+    LevelProgress& level = m_progress[env];
+    for (const Scratch::Contact& contact : scratch.contacts) {
+        Player& player = players[contact.player];
+        if (contact.creature < 0) {
+            Player& other = players[contact.otherPlayer];
+            int fight = AquariumRules::Fight(player.power, other.power);
+            if (fight == 0) continue;
+            Player& stronger = fight > 0 ? player : other;
+            Player& weaker = fight > 0 ? other : player;
+            int lives = weaker.lives;
+            Hurt(weaker.lives, weaker.debounce);
+            if (weaker.lives < lives) {
+                Award(stronger.score, stronger.power, weaker.power);
+                rewards[&stronger - players] += float(weaker.power);
+                rewards[&weaker - players] -= 1.0f;
+            }
+            continue;
+        }
+        size_t i = base + contact.creature;
+        AquariumCreatureType type = AquariumCreatureType(m_type[i]);
+        int value = types.at(type).value;
+        if (!AquariumRules::CanEat(player.power, value)) {
+            int lives = player.lives;
+            Hurt(player.lives, player.debounce);
+            if (player.lives < lives) rewards[contact.player] -= 1.0f;
+        } else {
+            scratch.eaten[contact.creature] = 1;
+            level.ConsumePopulation(type, value);
+            Award(player.score, player.power, value);
+            rewards[contact.player] += float(value);
+        }
+    }
+
+    // close the gaps, keeping the order like erasing from the aquarium's vector does
+    int kept = 0;
+    for (int i = 0; i < tank.count; ++i) {
+        if (scratch.eaten[i]) continue;
+        size_t from = base + i, to = base + kept++;
+        m_x[to] = m_x[from];
+        m_y[to] = m_y[from];
+        m_dx[to] = m_dx[from];
+        m_dy[to] = m_dy[from];
+        m_speed[to] = m_speed[from];
+        m_id[to] = m_id[from];
+        m_type[to] = m_type[from];
+    }
+    tank.count = kept;
+}
+
+// Aquarium::School, Hunt and Behave for one tank, all around player 0
+void BatchedAquarium::Swim(int env, Scratch& scratch) {
+    Tank& tank = m_tanks[env];
+    const Player& focus = m_players[size_t(env) * m_config.players];
+    const CreatureTypeTable& types = *m_config.types;
+    size_t base = size_t(env) * m_capacity;
+    float* x = m_x + base;
+    float* y = m_y + base;
+    float* dx = m_dx + base;
+    float* dy = m_dy + base;
+
+    scratch.schooling.Clear();
+    scratch.schooling.SetThreat(focus.x, focus.y);
+    scratch.members.clear();
+    for (int i = 0; i < tank.count; ++i) {
+        if (!types.at(AquariumCreatureType(m_type[base + i])).schools) continue;
+        scratch.schooling.Add(x[i], y[i], dx[i], dy[i], m_type[base + i]);
+        scratch.members.push_back(i);
+    }
+    if (!scratch.members.empty()) {
+        scratch.schooling.Step(0, 0, m_config.width, m_config.height);
+        for (size_t k = 0; k < scratch.members.size(); ++k) {
+            dx[scratch.members[k]] = scratch.schooling.GetVx(int(k));
+            dy[scratch.members[k]] = scratch.schooling.GetVy(int(k));
+        }
+    }
+
+    bool hunted = false;
+    for (int i = 0; i < tank.count; ++i) {
+        if (!types.at(AquariumCreatureType(m_type[base + i])).hunts) continue;
+        if (!hunted) {
+            scratch.pursuit.Update(focus.x, focus.y); // the worker's field, only integrated again when the target cell changes
+            hunted = true;
+        }
+        AquariumRules::Pursue(scratch.pursuit, x[i], y[i], dx[i], dy[i], focus.x, focus.y, AquariumRules::kHuntRange, dx[i], dy[i]);
+    }
+
+    for (BehaviorLanes& lanes : scratch.lanes) {
+        lanes.clear();
+    }
+    for (int i = 0; i < tank.count; ++i) {
+        if (dx[i] == 0 && dy[i] == 0) continue; // the scheduler leaves resting fish alone too
+        scratch.lanes[m_type[base + i]].push(i, m_id[base + i], x[i], y[i], dx[i], dy[i], m_speed[base + i], 1);
+    }
+    BehaviorContext context;
+    context.targetX = focus.x;
+    context.targetY = focus.y;
+    context.tick = tank.tick + 1;
+    float boundsWidth = m_config.width - AquariumRules::kWallMargin;
+    float boundsHeight = m_config.height - AquariumRules::kWallMargin;
+    for (int t = 0; t < types.size(); ++t) {
+        BehaviorLanes& lanes = scratch.lanes[t];
+        if (lanes.size() == 0) continue;
+        const CreatureTypeInfo& info = types.at(AquariumCreatureType(t));
+        scratch.vm.Run(info.program, lanes, context);
+        for (int k = 0; k < lanes.size(); ++k) {
+            int i = lanes.index[k];
+            x[i] = lanes.x[k];
+            y[i] = lanes.y[k];
+            dx[i] = lanes.dx[k];
+            dy[i] = lanes.dy[k];
+            AquariumRules::Bounce(x[i], y[i], dx[i], dy[i], float(info.width), float(info.height), boundsWidth, boundsHeight);
+        }
+    }
+}
+
+// Aquarium::Repopulate: the next level once this one is complete, then whatever is missing
+void BatchedAquarium::Repopulate(int env) {
+    Tank& tank = m_tanks[env];
+    if (m_progress[env].IsCompleted()) {
+        tank.level += 1;
+        tank.count = 0;
+        m_progress[env] = LevelProgress(tank.level % m_config.levels->size(), m_config.levels);
+    }
+    DeficitSpan deficits = m_progress[env].Repopulate();
+    if (!deficits.empty()) {
+        this->Spawn(env, deficits);
+    }
+}
+
+void BatchedAquarium::Observe(int env, int player, float* observation) const {
+    const Player* players = m_players + size_t(env) * m_config.players;
+    const Player& p = players[player];
+    float width = m_config.width;
+    float height = m_config.height;
+    observation[0] = p.x / width;
+    observation[1] = p.y / height;
+    observation[2] = float(p.power);
+    observation[3] = float(p.lives);
+    observation[4] = float(p.score);
+    observation[5] = float(m_tanks[env].level);
+
+    // insertion into a sorted list of kNearest, the tanks are too small for anything smarter;
+    // indices past the creatures are the other players
+    std::array<float, kNearest> bestDistance;
+    std::array<int, kNearest> bestIndex;
+    int kept = 0;
+    size_t base = size_t(env) * m_capacity;
+    int creatures = m_tanks[env].count;
+    for (int i = 0; i < creatures + m_config.players; ++i) {
+        float ox, oy;
+        if (i < creatures) {
+            ox = m_x[base + i];
+            oy = m_y[base + i];
+        } else {
+            const Player& other = players[i - creatures];
+            if (i - creatures == player || !other.active) continue;
+            ox = other.x;
+            oy = other.y;
+        }
+        float ex = ox - p.x, ey = oy - p.y;
+        float d2 = ex * ex + ey * ey;
+        if (kept == kNearest && d2 >= bestDistance[kNearest - 1]) continue;
+        int at = kept < kNearest ? kept++ : kNearest - 1;
+        while (at > 0 && bestDistance[at - 1] > d2) {
+            bestDistance[at] = bestDistance[at - 1];
+            bestIndex[at] = bestIndex[at - 1];
+            --at;
+        }
+        bestDistance[at] = d2;
+        bestIndex[at] = i;
+    }
+    float* out = observation + kPlayerFeatures;
+    for (int k = 0; k < kNearest; ++k, out += kCreatureFeatures) {
+        if (k >= kept) {
+            out[0] = out[1] = out[2] = out[3] = 0.0f;
+            continue;
+        }
+        int i = bestIndex[k];
+        if (i < creatures) {
+            AquariumCreatureType type = AquariumCreatureType(m_type[base + i]);
+            out[0] = (m_x[base + i] - p.x) / width;
+            out[1] = (m_y[base + i] - p.y) / height;
+            out[2] = float(m_config.types->at(type).value);
+            out[3] = float(int(type));
+        } else {
+            const Player& other = players[i - creatures];
+            out[0] = (other.x - p.x) / width;
+            out[1] = (other.y - p.y) / height;
+            out[2] = float(other.power);
+            out[3] = float(int(AquariumCreatureType::PlayerFish));
+        }
+    }
+}
+
+void BatchedAquarium::RunParallel(const std::function<void(int, int, int)>& job) {
+    int workers = m_threadCount;
+    if (workers == 1) {
+        job(0, 0, m_config.environments);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &job;
+        m_pending = workers - 1;
+        m_generation += 1;
+    }
+    m_wake.notify_all();
+    int slice = (m_config.environments + workers - 1) / workers;
+    job(0, 0, std::min(slice, m_config.environments));
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_finished.wait(lock, [this]() { return m_pending == 0; });
+    m_job = nullptr;
+}
+
+void BatchedAquarium::WorkerLoop(int worker) {
+    uint64_t seen = 0;
+    int workers = m_threadCount;
+    for (;;) {
+        const std::function<void(int, int, int)>* job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&]() { return m_stopping || m_generation != seen; });
+            if (m_stopping) return;
+            seen = m_generation;
+            job = m_job;
+        }
+        int slice = (m_config.environments + workers - 1) / workers;
+        int first = std::min(m_config.environments, worker * slice);
+        int last = std::min(m_config.environments, first + slice);
+        (*job)(worker, first, last);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending -= 1;
+        }
+        m_finished.notify_one();
+    }
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "AquariumRules.h"
+
+// Headless aquarium for agents and load generation: N independent tanks stepped together.
+// The tanks play by the game's own rules and tables (AquariumRules.h): the creature types and
+// programs of behaviors.xml, the levels of levels.xml, schooling, hunting, collisions between
+// players and the level turnover. It includes nothing from openFrameworks, so it needs no
+// window, GL context or images.
+//
+// One Step is one tank tick of the game: the players move for AquariumRules::kFramesPerTick
+// frames, then collisions are resolved and the fish school, hunt and run their programs.
+// Every fish moves on every tick, the game's UpdateScheduler only thins out fish far off screen.
+//
+// All per-tank state lives in one allocation laid out as structure of arrays, tank after tank,
+// and a step is split over a fixed pool of worker threads.
+//
+// Actions, one per player: 0 stay, 1..8 the eight directions starting at up and going clockwise.
+// Observation of one player (ObservationSize() floats):
+//   x / width, y / height, power, lives, score, level
+//   then for the kNearest nearest creatures and other players (zero padded):
+//   dx / width, dy / height, value (power for a player), type (0 for a player)
+class BatchedAquarium {
+    public:
+        struct Config {
+            int environments = 1024;
+            int players = 1; // per tank, player 0 is the one whose game over ends the tank
+            int threads = 0; // 0 means one per core
+            float width = 1024.0f;
+            float height = 768.0f;
+            float playerSpeed = 5.0f;
+            uint64_t seed = 1;
+            // what the game loaded from behaviors.xml and levels.xml, null means the built in tables
+            std::shared_ptr<const CreatureTypeTable> types;
+            std::shared_ptr<const AquariumLevelTable> levels;
+        };
+
+        explicit BatchedAquarium(const Config& config);
+        ~BatchedAquarium();
+        BatchedAquarium(const BatchedAquarium&) = delete;
+        BatchedAquarium& operator=(const BatchedAquarium&) = delete;
+
+        void Reset(); // every tank back to level 0
+        // actions[environments * players]; observations[environments * players * ObservationSize()];
+        // rewards[environments * players] and dones[environments] are optional,
+        // a tank that is done is reset before the next step
+        void Step(const int* actions, float* observations, float* rewards = nullptr, uint8_t* dones = nullptr);
+
+        int GetEnvironmentCount() const { return m_config.environments; }
+        int GetPlayerCount() const { return m_config.players; }
+        static constexpr int kNearest = 8;
+        static constexpr int kPlayerFeatures = 6;
+        static constexpr int kCreatureFeatures = 4;
+        static constexpr int ObservationSize() { return kPlayerFeatures + kNearest * kCreatureFeatures; }
+        int GetCapacity() const { return m_capacity; } // creatures per tank, the most crowded level
+        int GetLevel(int env) const { return m_tanks[env].level; }
+        int GetCreatureCount(int env) const { return m_tanks[env].count; }
+        size_t GetAllocationBytes() const { return m_bytes; }
+        uint64_t GetStepCount() const { return m_steps; }
+    private:
+        struct Tank {
+            int level;
+            int count; // creatures in the tank
+            uint32_t nextId; // seeds the wander and oscillate instructions, like the aquarium's creature ids
+            uint64_t tick;
+            uint64_t rngPosition;
+        };
+        struct Player {
+            float x;
+            float y;
+            float dx;
+            float dy;
+            int lives;
+            int power;
+            int score;
+            int debounce; // frames left
+            bool active; // players other than 0 leave the tank when out of lives
+        };
+        struct Scratch; // per worker, the systems a tank tick borrows
+
+        void ResetTank(int env);
+        void Spawn(int env, const DeficitSpan& deficits);
+        void StepTank(int env, Scratch& scratch, const int* actions, float* observations, float* rewards, uint8_t* done);
+        void MovePlayers(int env, const int* actions);
+        void Collide(int env, Scratch& scratch, float* rewards);
+        void Swim(int env, Scratch& scratch);
+        void Repopulate(int env);
+        void Observe(int env, int player, float* observation) const;
+        void RunParallel(const std::function<void(int, int, int)>& job);
+        void WorkerLoop(int worker);
+
+        Config m_config;
+        int m_capacity = 1;
+        size_t m_bytes = 0;
+        uint64_t m_steps = 0;
+
+        // one block, carved into the arrays below
+        std::unique_ptr<unsigned char[]> m_memory;
+        Tank* m_tanks = nullptr;
+        Player* m_players = nullptr; // [environments * players]
+        float* m_x = nullptr; // [environments * m_capacity], same for the others
+        float* m_y = nullptr;
+        float* m_dx = nullptr;
+        float* m_dy = nullptr;
+        float* m_speed = nullptr;
+        uint32_t* m_id = nullptr;
+        uint8_t* m_type = nullptr;
+        std::vector<LevelProgress> m_progress; // one per tank
+
+        // worker pool, every step hands each worker one contiguous range of tanks
+        int m_threadCount = 1; // including the caller
+        std::vector<std::unique_ptr<Scratch>> m_scratch; // one per worker
+        std::vector<std::thread> m_workers;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_finished;
+        const std::function<void(int, int, int)>* m_job = nullptr;
+        uint64_t m_generation = 0;
+        int m_pending = 0;
+        bool m_stopping = false;
+};
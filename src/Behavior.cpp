@@ -0,0 +1,232 @@
+#include "Behavior.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include "WorldHash.h"
+
+
+namespace {
+    constexpr float kTwoPi = 6.28318530718f;
+
+    constexpr float kMaxWander = 1.0f; // radians per tick, the rotation below is exact enough up to here
+    constexpr int kPhases = 16;
+
+    // [0, 1) from the top 24 bits, same resolution Philox4x32::NextFloat gives
+    float UnitFloat(uint64_t bits) {
+        return float(bits >> 40) * (1.0f / 16777216.0f);
+    }
+
+    // oscillation phases are picked from a table so no fish needs its own cos and sin
+    struct PhaseTable {
+        float cosine[kPhases];
+        float sine[kPhases];
+        PhaseTable() {
+            for (int i = 0; i < kPhases; ++i) {
+                cosine[i] = std::cos(kTwoPi * i / kPhases);
+                sine[i] = std::sin(kTwoPi * i / kPhases);
+            }
+        }
+    };
+    const PhaseTable kPhaseTable;
+}
+
+
+// BehaviorProgram Implementation
+bool BehaviorProgram::Compile(const std::string& source, BehaviorProgram& out, std::string& error) {
+    out.m_code.clear();
+    std::istringstream lines(source);
+    std::string line;
+    for (int lineNumber = 1; std::getline(lines, line); ++lineNumber) {
+        line = line.substr(0, line.find('#'));
+        std::replace(line.begin(), line.end(), ';', '\n');
+        std::istringstream statements(line);
+        std::string statement;
+        while (std::getline(statements, statement)) {
+            std::istringstream words(statement);
+            std::string name;
+            if (!(words >> name)) continue;
+            auto fail = [&](const std::string& why) {
+                error = "line " + std::to_string(lineNumber) + ": " + name + " " + why;
+                return false;
+            };
+
+            BehaviorInstruction instruction;
+            if (name == "axis") {
+                std::string axis;
+                words >> axis;
+                if (axis != "x" && axis != "y") return fail("takes x or y");
+                instruction.op = BehaviorOp::Axis;
+                instruction.a = axis == "x" ? 1.0f : 0.0f;
+                instruction.b = axis == "y" ? 1.0f : 0.0f;
+            } else if (name == "speed") {
+                instruction.op = BehaviorOp::Speed;
+                if (!(words >> instruction.a) || instruction.a < 0) return fail("takes a factor >= 0");
+            } else if (name == "flee" || name == "seek") {
+                instruction.op = name == "flee" ? BehaviorOp::Flee : BehaviorOp::Seek;
+                if (!(words >> instruction.a >> instruction.b) || instruction.a <= 0 || instruction.b < 0 || instruction.b > 1) {
+                    return fail("takes a range > 0 and a weight in [0, 1]");
+                }
+            } else if (name == "wander") {
+                instruction.op = BehaviorOp::Wander;
+                if (!(words >> instruction.a) || instruction.a < 0 || instruction.a > kMaxWander) {
+                    return fail("takes an angle in [0, 1] radians");
+                }
+            } else if (name == "oscillate") {
+                instruction.op = BehaviorOp::Oscillate;
+                if (!(words >> instruction.a >> instruction.b) || instruction.b <= 0) {
+                    return fail("takes an amplitude in px and a period > 0 in ticks");
+                }
+            } else {
+                return fail("is not an instruction");
+            }
+            std::string extra;
+            if (words >> extra) return fail("has too many arguments");
+            out.m_code.push_back(instruction);
+        }
+    }
+    return true;
+}
+
+
+// BehaviorLanes Implementation
+void BehaviorLanes::clear() {
+    index.clear();
+    id.clear();
+    x.clear();
+    y.clear();
+    dx.clear();
+    dy.clear();
+    speed.clear();
+    ticks.clear();
+}
+
+void BehaviorLanes::push(int slot, uint32_t fishId, float px, float py, float hx, float hy, float s, int elapsed) {
+    index.push_back(slot);
+    id.push_back(fishId);
+    x.push_back(px);
+    y.push_back(py);
+    dx.push_back(hx);
+    dy.push_back(hy);
+    speed.push_back(s);
+    ticks.push_back(float(elapsed));
+}
+
+
+// BehaviorVM Implementation
+void BehaviorVM::Run(const BehaviorProgram& program, BehaviorLanes& lanes, const BehaviorContext& context) {
+    int n = lanes.size();
+    m_scale.assign(n, 1.0f);
+    m_offsetX.assign(n, 0.0f);
+    m_offsetY.assign(n, 0.0f);
+    m_maskX = 1.0f;
+    m_maskY = 1.0f;
+
+    for (const BehaviorInstruction& instruction : program.GetCode()) {
+        switch (instruction.op) {
+            case BehaviorOp::Axis:
+                m_maskX = instruction.a;
+                m_maskY = instruction.b;
+                break;
+            case BehaviorOp::Speed: {
+                float* scale = m_scale.data();
+                for (int i = 0; i < n; ++i) scale[i] *= instruction.a;
+                break;
+            }
+            case BehaviorOp::Flee:
+                this->Steer(instruction, lanes, context, -1.0f);
+                break;
+            case BehaviorOp::Seek:
+                this->Steer(instruction, lanes, context, 1.0f);
+                break;
+            case BehaviorOp::Wander:
+                this->Wander(instruction, lanes, context);
+                break;
+            case BehaviorOp::Oscillate:
+                this->Oscillate(instruction, lanes, context);
+                break;
+        }
+    }
+
+    // integrate, far fish cover all the ticks they skipped in one go
+    float* x = lanes.x.data();
+    float* y = lanes.y.data();
+    const float* dx = lanes.dx.data();
+    const float* dy = lanes.dy.data();
+    const float* speed = lanes.speed.data();
+    const float* ticks = lanes.ticks.data();
+    const float* scale = m_scale.data();
+    const float* ox = m_offsetX.data();
+    const float* oy = m_offsetY.data();
+    float maskX = m_maskX; // locals, the stores below could alias the members
+    float maskY = m_maskY;
+    for (int i = 0; i < n; ++i) {
+        float step = speed[i] * scale[i];
+        x[i] += (dx[i] * step + ox[i]) * maskX * ticks[i];
+        y[i] += (dy[i] * step + oy[i]) * maskY * ticks[i];
+    }
+}
+
+// blends the heading with the direction to (sign 1) or away from (sign -1) the player
+void BehaviorVM::Steer(const BehaviorInstruction& instruction, BehaviorLanes& lanes, const BehaviorContext& context, float sign) {
+    int n = lanes.size();
+    const float* x = lanes.x.data();
+    const float* y = lanes.y.data();
+    float* dx = lanes.dx.data();
+    float* dy = lanes.dy.data();
+    float range2 = instruction.a * instruction.a;
+    for (int i = 0; i < n; ++i) {
+        float tx = context.targetX - x[i];
+        float ty = context.targetY - y[i];
+        float d2 = tx * tx + ty * ty;
+        float weight = (d2 < range2 && d2 > 1e-6f) ? instruction.b : 0.0f;
+        float inv = sign / std::sqrt(std::max(d2, 1e-6f));
+        float nx = dx[i] + (tx * inv - dx[i]) * weight;
+        float ny = dy[i] + (ty * inv - dy[i]) * weight;
+        float length = std::sqrt(nx * nx + ny * ny);
+        // straight at a fish heading the other way can cancel out, keep the old heading then
+        float keep = length > 1e-4f ? 1.0f / length : 0.0f;
+        dx[i] = keep > 0 ? nx * keep : dx[i];
+        dy[i] = keep > 0 ? ny * keep : dy[i];
+    }
+}
+
+void BehaviorVM::Wander(const BehaviorInstruction& instruction, BehaviorLanes& lanes, const BehaviorContext& context) {
+    int n = lanes.size();
+    const uint32_t* id = lanes.id.data();
+    float* dx = lanes.dx.data();
+    float* dy = lanes.dy.data();
+    uint64_t tick = context.tick << 32;
+    for (int i = 0; i < n; ++i) {
+        float angle = (UnitFloat(HashMix(tick | id[i])) * 2.0f - 1.0f) * instruction.a;
+        // Taylor terms instead of libm, within 3e-5 of cos and sin up to kMaxWander
+        float a2 = angle * angle;
+        float c = 1.0f - a2 * (0.5f - a2 * (1.0f / 24.0f - a2 * (1.0f / 720.0f)));
+        float s = angle * (1.0f - a2 * (1.0f / 6.0f - a2 * (1.0f / 120.0f - a2 * (1.0f / 5040.0f))));
+        float hx = dx[i];
+        float hy = dy[i];
+        dx[i] = hx * c - hy * s;
+        dy[i] = hx * s + hy * c;
+    }
+}
+
+// adds the derivative of amplitude * sin(wt + phase) across the heading, so the path is the sine
+void BehaviorVM::Oscillate(const BehaviorInstruction& instruction, BehaviorLanes& lanes, const BehaviorContext& context) {
+    int n = lanes.size();
+    const uint32_t* id = lanes.id.data();
+    const float* dx = lanes.dx.data();
+    const float* dy = lanes.dy.data();
+    float* ox = m_offsetX.data();
+    float* oy = m_offsetY.data();
+    float omega = kTwoPi / instruction.b;
+    float wt = omega * float(std::fmod(double(context.tick), double(instruction.b))); // small enough for float
+    // cos(wt + phase) = cos(wt) cos(phase) - sin(wt) sin(phase), only the table part is per fish
+    float cosWt = instruction.a * omega * std::cos(wt);
+    float sinWt = instruction.a * omega * std::sin(wt);
+    for (int i = 0; i < n; ++i) {
+        int phase = id[i] % kPhases; // fish of a school don't wiggle in step
+        float across = cosWt * kPhaseTable.cosine[phase] - sinWt * kPhaseTable.sine[phase];
+        ox[i] -= dy[i] * across;
+        oy[i] += dx[i] * across;
+    }
+}
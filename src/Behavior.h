@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Fish movement as a tiny bytecode so fish types can be tuned from bin/data/behaviors.xml.
+// A program runs over the heading (dx, dy) and the speed of a fish, one instruction per line:
+//   axis x|y                 only move along that axis, the heading is kept for the sprite
+//   speed <k>                multiply the speed by k
+//   flee <range> <weight>    turn away from the player when closer than range
+//   seek <range> <weight>    turn towards the player when closer than range
+//   wander <radians>         turn by a random angle of at most that much (up to 1) every tick
+//   oscillate <px> <ticks>   swim in a sine wave of that amplitude and period across the heading
+// Anything after '#' is a comment, ';' can separate instructions on one line.
+enum class BehaviorOp : uint8_t {
+    Axis,
+    Speed,
+    Flee,
+    Seek,
+    Wander,
+    Oscillate
+};
+
+struct BehaviorInstruction {
+    BehaviorOp op;
+    float a = 0.0f;
+    float b = 0.0f;
+};
+
+class BehaviorProgram {
+    public:
+        // false with a message naming the line when the source does not compile
+        static bool Compile(const std::string& source, BehaviorProgram& out, std::string& error);
+        const std::vector<BehaviorInstruction>& GetCode() const { return m_code; }
+        void add(const BehaviorInstruction& instruction) { m_code.push_back(instruction); }
+        bool empty() const { return m_code.empty(); }
+    private:
+        std::vector<BehaviorInstruction> m_code;
+};
+
+// the fish that run one program this tick, as structure of arrays
+struct BehaviorLanes {
+    std::vector<int> index; // whatever the caller needs to write the result back
+    std::vector<uint32_t> id; // seeds wander and the oscillation phase
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> dx;
+    std::vector<float> dy;
+    std::vector<float> speed;
+    std::vector<float> ticks; // ticks since the fish last moved, far fish move less often
+
+    void clear();
+    void push(int slot, uint32_t fishId, float px, float py, float hx, float hy, float s, int elapsed);
+    int size() const { return int(x.size()); }
+};
+
+// where the player is and when it is, the same for every lane
+struct BehaviorContext {
+    float targetX = 0.0f;
+    float targetY = 0.0f;
+    uint64_t tick = 0;
+};
+
+// Runs a program over all lanes at once: every instruction is one plain loop over the arrays,
+// so the decode happens once per program and tick instead of once per fish, and the loops
+// are simple enough for the compiler to vectorize. Wander is hashed from (id, tick), so the
+// same world always moves the same way.
+class BehaviorVM {
+    public:
+        void Run(const BehaviorProgram& program, BehaviorLanes& lanes, const BehaviorContext& context);
+    private:
+        void Steer(const BehaviorInstruction& instruction, BehaviorLanes& lanes, const BehaviorContext& context, float sign);
+        void Wander(const BehaviorInstruction& instruction, BehaviorLanes& lanes, const BehaviorContext& context);
+        void Oscillate(const BehaviorInstruction& instruction, BehaviorLanes& lanes, const BehaviorContext& context);
+
+        // registers, one slot per lane
+        std::vector<float> m_scale;
+        std::vector<float> m_offsetX; // px per tick on top of the heading
+        std::vector<float> m_offsetY;
+        float m_maskX = 1.0f;
+        float m_maskY = 1.0f;
+};
@@ -1,8 +1,32 @@
 #include "Core.h"
+#include "AquariumRules.h"
 
 
 // Creature Inherited Base Behavior
 void Creature::setBounds(int w, int h) { m_width = w; m_height = h; }
+
+void Creature::attachHash(WorldHash* hash) {
+    this->detachHash();
+    if (hash == nullptr) return;
+    m_worldHash = hash;
+    m_hashedState = this->stateHash();
+    m_worldHash->Add(m_hashedState);
+}
+
+void Creature::detachHash() {
+    if (m_worldHash == nullptr) return;
+    m_worldHash->Remove(m_hashedState);
+    m_worldHash = nullptr;
+}
+
+uint64_t Creature::stateHash() const {
+    uint64_t h = HashCombine(uint64_t(m_value), m_collisionRadius);
+    h = HashCombine(h, m_x);
+    h = HashCombine(h, m_y);
+    h = HashCombine(h, m_dx);
+    h = HashCombine(h, m_dy);
+    return HashCombine(h, uint64_t(m_speed));
+}
 void Creature::normalize() {
     float length = std::sqrt(m_dx * m_dx + m_dy * m_dy);
     if (length != 0) {
@@ -12,34 +36,8 @@ void Creature::normalize() {
 }
 
 void Creature::bounce() {
-    // should implement boundary controls here
-    if(m_width<=0 || m_height <= 0)
-        return;
-    bool bounced = false;
-    //Checks left boundary
-    if(m_x < 0){
-        m_x=0;
-        m_dx = std::abs(m_dx);
-        bounced = true;
-    }
-    //Checks right boundary
-    if (m_x + m_sprite->getWidth() > m_width){
-        m_x = m_width - m_sprite->getWidth();
-        m_dx = -std::abs(m_dx);
-    }
-    
-    //Checks ceiling boundary
-    if(m_y < 0){
-        m_y = 0;
-        m_dy = std::abs(m_dy);
-        bounced = true;
-    }
-    //Checks floor boundary
-    if (m_y + m_sprite->getHeight() > m_height){
-        m_y = m_height - m_sprite->getHeight();
-        m_dy = -std::abs(m_dy);
-        bounced = true;
-    }
+    // same walls as the headless tanks, see AquariumRules::Bounce
+    AquariumRules::Bounce(m_x, m_y, m_dx, m_dy, m_sprite->getWidth(), m_sprite->getHeight(), m_width, m_height);
 }
 
 
@@ -136,22 +134,43 @@ string GameSceneManager::GetActiveSceneName(){
 
 void GameSceneManager::UpdateActiveScene(){
     if(!this->HasScenes()){return;} // make sure we have a scene before we try to paint
+    TraceScope trace("GameScene::Update");
     this->m_active_scene->Update();
 
 }
 
 void GameSceneManager::DrawActiveScene(){
     if(!this->HasScenes()){return;} // make sure we have something before Drawing it
+    TraceScope trace("GameScene::Draw");
     this->m_active_scene->Draw();
 }
 
 
+void GameSceneManager::Resize(int w, int h){
+    for(std::shared_ptr<GameScene> scene : this->m_scenes){
+        scene->Resize(w, h);
+    }
+}
+
+
+// the title never changes, it is painted once and presented from the cache after that
+GameIntroScene::GameIntroScene(string name, std::shared_ptr<GameSprite> banner)
+: m_name(name), m_banner(std::move(banner)){
+    this->m_layers.AddStaticLayer("banner", [this](){ this->m_banner->draw(0, 0, ofGetWindowWidth(), ofGetWindowHeight()); });
+}
+
 void GameIntroScene::Update(){
 
 }
 
 void GameIntroScene::Draw(){
-    this->m_banner->draw(0,0);
+    this->m_layers.Draw();
+}
+
+GameOverScene::GameOverScene(string name, std::shared_ptr<GameSprite> banner)
+: m_name(name), m_banner(std::move(banner)){
+    this->m_layers.AddStaticLayer("gradient", [](){ ofBackgroundGradient(ofColor::red, ofColor::black); });
+    this->m_layers.AddStaticLayer("banner", [this](){ this->m_banner->draw(0, 0, ofGetWindowWidth(), ofGetWindowHeight()); });
 }
 
 void GameOverScene::Update(){
@@ -159,7 +178,5 @@ void GameOverScene::Update(){
 }
 
 void GameOverScene::Draw(){
-    ofBackgroundGradient(ofColor::red, ofColor::black);
-    this->m_banner->draw(0,0);
-
+    this->m_layers.Draw();
 }
\ No newline at end of file
@@ -1,36 +1,26 @@
+#pragma once
+
 #include <iostream>
 #include <memory>
 #include <utility>
 #include <cmath>
 #include <algorithm>
 #include "ofMain.h"
+#include "Tracer.h"
+#include "FrameStats.h"
+#include "LayerCompositor.h"
+#include "ImageResampler.h"
+#include "WorldHash.h"
+#include "TimingWheel.h"
 
 
-class AwaitFrames {
-public:
-	AwaitFrames(int frames) : m_frames(frames), m_counter(0) {}
-	bool tick() {
-		if (m_counter < m_frames) {
-			++m_counter;
-			return false;
-		}
-		m_counter = 0; // Reset counter after reaching the target
-		return true;
-	}
-private:
-	int m_frames;
-	int m_counter;
-};
-
 class GameSprite {
 public:
     GameSprite(const std::string& imagePath, int width, int height) {
         if (!m_image.load(imagePath)) {
             std::cerr << "Failed to load image: " << imagePath << std::endl;
         }
-        m_image.resize(width, height);
-        m_flippedImage = m_image;
-        m_flippedImage.mirror(false, true); // Mirror horizontally
+        this->resize(width, height);
     }
 
     void draw(float x, float y) const {
@@ -40,23 +30,47 @@ public:
             m_image.draw(x, y);
         }
     }
+    // stretched on the GPU, for full window images while their resampled copy is on its way
+    void draw(float x, float y, float w, float h) const {
+        if (m_flipped) {
+            m_flippedImage.draw(x, y, w, h);
+        } else {
+            m_image.draw(x, y, w, h);
+        }
+    }
 
     void setFlipped(bool flipped) { m_flipped = flipped; }
     int getWidth() const { return m_image.getWidth(); }
     int getHeight() const { return m_image.getHeight(); }
     void resize(int width, int height){
-        m_image.resize(width, height);
+        if (!m_image.isAllocated() || width <= 0 || height <= 0) return;
+        ofPixels scaled;
+        ImageResampler::Resample(m_image.getPixels(), scaled, width, height, ResampleFilter::CatmullRom);
+        this->setPixels(scaled);
+    }
+    void setPixels(const ofPixels& pixels){
+        m_image.setFromPixels(pixels);
+        m_flippedImage = m_image;
+        m_flippedImage.mirror(false, true); // Mirror horizontally
+        m_assetBytes.Set(2 * int64_t(pixels.size())); // the flipped copy is just as big
     }
 
 private:
     ofImage m_image;
     ofImage m_flippedImage;
     bool m_flipped = false;
+    AssetCharge m_assetBytes;
 };
 
 
 
 class Creature {
+public:
+    // bookkeeping of the UpdateScheduler
+    struct UpdateSlot {
+        uint64_t lastTick = 0;
+        uint64_t nextTick = 0;
+    };
 protected:
     Creature(float x, float y, int speed, float collisionRadius, int value,
              std::shared_ptr<GameSprite> sprite)
@@ -81,19 +95,64 @@ protected:
     float m_collisionRadius = 0.0f;
     int m_value = 0;
     std::shared_ptr<GameSprite> m_sprite;
+    UpdateSlot m_updateSlot;
+    uint32_t m_id = 0; // given by the aquarium, 0 until it is added
+    WorldHash* m_worldHash = nullptr; // the world this creature is counted in, if any
+    uint64_t m_hashedState = 0; // what it last added to m_worldHash
 
 public:
     virtual ~Creature() = default;
-    virtual void move() = 0;
     virtual void draw() const = 0;
 
+    UpdateSlot& getUpdateSlot() { return m_updateSlot; }
+    bool isStationary() const { return m_dx == 0 && m_dy == 0; }
+    // changing the direction wakes a sleeping creature up on the next tick
+    void setVelocity(float dx, float dy) { m_dx = dx; m_dy = dy; m_updateSlot.nextTick = 0; this->rehash(); }
+    // turns a moving creature without moving its next update, only a stationary one is woken up
+    void steer(float dx, float dy) {
+        if (this->isStationary()) m_updateSlot.nextTick = 0;
+        m_dx = dx;
+        m_dy = dy;
+        this->rehash();
+    }
+
+    // incremental world hash: whoever changes the state calls rehash, which swaps the old
+    // contribution for the new one in O(1)
+    void attachHash(WorldHash* hash);
+    void detachHash();
+    void rehash() {
+        if (m_worldHash == nullptr) return;
+        uint64_t state = this->stateHash();
+        m_worldHash->Replace(m_hashedState, state);
+        m_hashedState = state;
+    }
+    virtual uint64_t stateHash() const;
+    float getDirectionX() const { return m_dx; }
+    float getDirectionY() const { return m_dy; }
+    // creatures with the same group school together, -1 for creatures that don't school
+    virtual int getSchoolGroup() const { return -1; }
+    // predators follow the pursuit flow field towards the player
+    virtual bool isPredator() const { return false; }
+
     virtual float getCollisionRadius() const { return m_collisionRadius; }
     virtual void setCollisionRadius(float radius) { m_collisionRadius = radius; }
 
     float getX() const { return m_x; }
     float getY() const { return m_y; }
+    uint32_t getId() const { return m_id; }
+    void setId(uint32_t id) { m_id = id; }
+    // puts the creature back where a snapshot had it, it moves on the next tick
+    void setState(float x, float y, float dx, float dy, int speed) {
+        m_x = x;
+        m_y = y;
+        m_dx = dx;
+        m_dy = dy;
+        m_speed = speed;
+        m_updateSlot.nextTick = 0;
+        this->rehash();
+    }
     int getSpeed() const { return m_speed; }
-    void setSpeed(int speed) { m_speed = speed; }
+    void setSpeed(int speed) { m_speed = speed; this->rehash(); }
     void setFlipped(bool flipped) {
         if (m_sprite) {
             m_sprite->setFlipped(flipped);
@@ -169,6 +228,12 @@ class GameScene {
         virtual void Update() = 0;
         virtual void Draw() = 0;
         virtual ~GameScene() = default;
+        virtual void Resize(int w, int h) { m_layers.Resize(w, h); }
+        // what the scene is made of, the app adds its own layers (like the background) here too
+        LayerCompositor& Layers() { return m_layers; }
+        bool IsIdle() const { return m_layers.IsIdle(); }
+    protected:
+        LayerCompositor m_layers;
 
 };
 
@@ -182,8 +247,7 @@ string GameSceneKindToString(GameSceneKind t);
 
 class GameIntroScene : public GameScene {
     public:
-        GameIntroScene(string name, std::shared_ptr<GameSprite> banner)
-        : m_name(name), m_banner(std::move(banner)){};
+        GameIntroScene(string name, std::shared_ptr<GameSprite> banner);
         string GetName() override {return this->m_name;}
         void Update() override;
         void Draw() override;
@@ -194,8 +258,7 @@ class GameIntroScene : public GameScene {
 
 class GameOverScene : public GameScene {
     public:
-        GameOverScene(string name, std::shared_ptr<GameSprite> banner)
-        : m_name(name), m_banner(std::move(banner)){};
+        GameOverScene(string name, std::shared_ptr<GameSprite> banner);
         string GetName() override {return this->m_name;}
         void Update() override;
         void Draw() override;
@@ -212,6 +275,9 @@ class GameSceneManager {
         bool HasScenes(){return m_scenes.size() > 0; }
         std::shared_ptr<GameScene> GetScene(string name);
         std::shared_ptr<GameScene> GetActiveScene();
+        const std::vector<std::shared_ptr<GameScene>>& GetScenes() const { return m_scenes; }
+        void Resize(int w, int h);
+        bool IsActiveSceneIdle() const { return m_active_scene != nullptr && m_active_scene->IsIdle(); }
         
         // support the functionality
         string GetActiveSceneName();
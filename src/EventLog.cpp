@@ -0,0 +1,418 @@
+#include "EventLog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+
+std::string GameplayEventKindToString(GameplayEventKind kind) {
+    switch (kind) {
+        case GameplayEventKind::Collision: return "collision";
+        case GameplayEventKind::Eat: return "eat";
+        case GameplayEventKind::LifeLost: return "life_lost";
+        case GameplayEventKind::PowerUp: return "power_up";
+        case GameplayEventKind::LevelChange: return "level_change";
+        default: return "unknown";
+    }
+}
+
+
+// GameplayEventBuffer Implementation
+void GameplayEventBuffer::Push(const GameplayEvent& event) {
+    uint64_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) >= m_events.size()) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed); // the writer fell behind
+        return;
+    }
+    m_events[head % m_events.size()] = event;
+    m_head.store(head + 1, std::memory_order_release);
+}
+
+void GameplayEventBuffer::Drain(std::vector<GameplayEvent>& out) {
+    uint64_t tail = m_tail.load(std::memory_order_relaxed);
+    uint64_t head = m_head.load(std::memory_order_acquire);
+    for (; tail < head; ++tail) {
+        out.push_back(m_events[tail % m_events.size()]);
+    }
+    m_tail.store(tail, std::memory_order_release);
+}
+
+
+// EventLogFormat Implementation
+namespace {
+    void PutVarint(std::vector<uint8_t>& out, uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back(uint8_t(v) | 0x80);
+            v >>= 7;
+        }
+        out.push_back(uint8_t(v));
+    }
+
+    uint64_t Zigzag(int64_t v) { return (uint64_t(v) << 1) ^ uint64_t(v >> 63); }
+    int64_t Unzigzag(uint64_t v) { return int64_t(v >> 1) ^ -int64_t(v & 1); }
+
+    // byte columns barely change from one event to the next, so they are stored as runs
+    template<class Get>
+    void PutRuns(std::vector<uint8_t>& out, const GameplayEvent* events, size_t count, Get get) {
+        for (size_t i = 0; i < count; ) {
+            uint8_t value = get(events[i]);
+            size_t run = 1;
+            while (i + run < count && get(events[i + run]) == value) ++run;
+            out.push_back(value);
+            PutVarint(out, run);
+            i += run;
+        }
+    }
+
+    struct Cursor {
+        const uint8_t* data;
+        size_t size;
+        size_t at = 0;
+        bool ok = true;
+        uint64_t Varint() {
+            uint64_t v = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                if (at >= size) break;
+                uint8_t byte = data[at++];
+                v |= uint64_t(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) return v;
+            }
+            ok = false;
+            return 0;
+        }
+        uint8_t Byte() {
+            if (at >= size) { ok = false; return 0; }
+            return data[at++];
+        }
+    };
+
+    template<class Set>
+    void GetRuns(Cursor& in, std::vector<GameplayEvent>& events, size_t first, Set set) {
+        for (size_t i = first; i < events.size() && in.ok; ) {
+            uint8_t value = in.Byte();
+            uint64_t run = in.Varint();
+            if (run == 0 || run > events.size() - i) { in.ok = false; return; }
+            for (uint64_t r = 0; r < run; ++r) set(events[i++], value);
+        }
+    }
+}
+
+void EventLogFormat::EncodeBlock(const GameplayEvent* events, size_t count, std::vector<uint8_t>& out) {
+    std::vector<uint8_t> body;
+    body.reserve(count * 8);
+    PutVarint(body, count);
+    int64_t previous = 0;
+    for (size_t i = 0; i < count; ++i) {
+        PutVarint(body, Zigzag(int64_t(events[i].timestamp) - previous)); // threads can interleave a little
+        previous = int64_t(events[i].timestamp);
+    }
+    previous = 0;
+    for (size_t i = 0; i < count; ++i) {
+        PutVarint(body, Zigzag(int64_t(events[i].tick) - previous));
+        previous = events[i].tick;
+    }
+    PutRuns(body, events, count, [](const GameplayEvent& e) { return uint8_t(e.kind); });
+    PutRuns(body, events, count, [](const GameplayEvent& e) { return e.player; });
+    PutRuns(body, events, count, [](const GameplayEvent& e) { return e.creatureType; });
+    for (size_t i = 0; i < count; ++i) {
+        PutVarint(body, Zigzag(events[i].value));
+    }
+    previous = 0;
+    for (size_t i = 0; i < count; ++i) {
+        PutVarint(body, Zigzag(int64_t(events[i].creatureId) - previous));
+        previous = events[i].creatureId;
+    }
+    out.clear();
+    PutVarint(out, body.size());
+    out.insert(out.end(), body.begin(), body.end());
+}
+
+size_t EventLogFormat::DecodeBlock(const uint8_t* data, size_t size, std::vector<GameplayEvent>& out) {
+    Cursor header{data, size};
+    uint64_t length = header.Varint();
+    // a segment that was never closed ends in zeros
+    if (!header.ok || length == 0 || length > size - header.at) return 0;
+    Cursor in{data + header.at, size_t(length)};
+    uint64_t count = in.Varint();
+    if (!in.ok || count > length) return 0;
+
+    size_t first = out.size();
+    out.resize(first + count, GameplayEvent{});
+    int64_t previous = 0;
+    for (size_t i = first; i < out.size(); ++i) {
+        previous += Unzigzag(in.Varint());
+        out[i].timestamp = uint64_t(previous);
+    }
+    previous = 0;
+    for (size_t i = first; i < out.size(); ++i) {
+        previous += Unzigzag(in.Varint());
+        out[i].tick = uint32_t(previous);
+    }
+    GetRuns(in, out, first, [](GameplayEvent& e, uint8_t v) { e.kind = GameplayEventKind(v); });
+    GetRuns(in, out, first, [](GameplayEvent& e, uint8_t v) { e.player = v; });
+    GetRuns(in, out, first, [](GameplayEvent& e, uint8_t v) { e.creatureType = v; });
+    for (size_t i = first; i < out.size(); ++i) {
+        out[i].value = int32_t(Unzigzag(in.Varint()));
+    }
+    previous = 0;
+    for (size_t i = first; i < out.size(); ++i) {
+        previous += Unzigzag(in.Varint());
+        out[i].creatureId = uint32_t(previous);
+    }
+    if (!in.ok) {
+        out.resize(first);
+        return 0;
+    }
+    return header.at + length;
+}
+
+void EventLogFormat::EncodeTypeTable(const std::vector<std::string>& names, std::vector<uint8_t>& out) {
+    out.clear();
+    PutVarint(out, names.size());
+    for (const std::string& name : names) {
+        PutVarint(out, name.size());
+        out.insert(out.end(), name.begin(), name.end());
+    }
+}
+
+bool EventLogFormat::ReadSegment(const std::string& path, std::vector<GameplayEvent>& out, std::vector<std::string>& typeNames) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (data.size() < sizeof(kMagic) || std::memcmp(data.data(), kMagic, sizeof(kMagic)) != 0) return false;
+    Cursor table{data.data(), data.size(), sizeof(kMagic)};
+    uint64_t count = table.Varint();
+    typeNames.clear();
+    for (uint64_t t = 0; t < count && table.ok; ++t) {
+        uint64_t length = table.Varint();
+        if (length > table.size - table.at) return false;
+        typeNames.emplace_back(reinterpret_cast<const char*>(data.data() + table.at), size_t(length));
+        table.at += length;
+    }
+    if (!table.ok) return false;
+    size_t at = table.at;
+    while (at < data.size()) {
+        size_t used = DecodeBlock(data.data() + at, data.size() - at, out);
+        if (used == 0) break;
+        at += used;
+    }
+    return true;
+}
+
+
+// EventSegment Implementation
+// the file is sized up front and mapped, so a block is a memcpy and the kernel writes it back
+// on its own; whatever was appended is still on disk if the game dies before Close
+bool EventSegment::Open(const std::string& path, size_t capacity) {
+    this->Close();
+    m_path = path;
+    m_capacity = capacity;
+    m_used = 0;
+#ifdef _WIN32
+    m_fallback.reserve(capacity);
+    m_file = 0;
+#else
+    m_file = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_file < 0) return false;
+    if (::ftruncate(m_file, off_t(capacity)) != 0) {
+        this->Close();
+        return false;
+    }
+    void* map = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+    if (map == MAP_FAILED) {
+        this->Close();
+        return false;
+    }
+    m_map = static_cast<uint8_t*>(map);
+#endif
+    return this->Append(reinterpret_cast<const uint8_t*>(EventLogFormat::kMagic), sizeof(EventLogFormat::kMagic));
+}
+
+bool EventSegment::Append(const uint8_t* data, size_t size) {
+    if (!this->IsOpen() || m_used + size > m_capacity) return false;
+#ifdef _WIN32
+    m_fallback.insert(m_fallback.end(), data, data + size);
+#else
+    std::memcpy(m_map + m_used, data, size);
+#endif
+    m_used += size;
+    return true;
+}
+
+void EventSegment::Close() {
+    if (!this->IsOpen()) return;
+#ifdef _WIN32
+    std::ofstream out(m_path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(m_fallback.data()), m_fallback.size());
+    m_fallback.clear();
+#else
+    if (m_map != nullptr) {
+        ::munmap(m_map, m_capacity);
+        m_map = nullptr;
+        if (::ftruncate(m_file, off_t(m_used)) != 0) {
+            // the reader stops at the zeros, nothing is lost
+        }
+    }
+    ::close(m_file);
+#endif
+    m_file = -1;
+}
+
+
+// EventLog Implementation
+EventLog& EventLog::Get() {
+    static EventLog instance;
+    return instance;
+}
+
+EventLog::EventLog() {
+    m_epoch = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+GameplayEventBuffer* EventLog::LocalBuffer() {
+    // owned by the log so the ring outlives its thread and still gets written
+    thread_local GameplayEventBuffer* buffer = nullptr;
+    if (buffer == nullptr) {
+        std::lock_guard<std::mutex> lock(m_registryMutex);
+        m_buffers.push_back(std::make_unique<GameplayEventBuffer>(kEventsPerThread));
+        buffer = m_buffers.back().get();
+    }
+    return buffer;
+}
+
+void EventLog::SetTick(uint32_t tick) {
+    uint64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    m_tickTimestamp.store(now - m_epoch, std::memory_order_relaxed);
+    m_tick.store(tick, std::memory_order_relaxed);
+}
+
+void EventLog::Push(GameplayEventKind kind, int player, int creatureType, int value, uint32_t creatureId) {
+    GameplayEvent event;
+    event.timestamp = m_tickTimestamp.load(std::memory_order_relaxed);
+    event.tick = m_tick.load(std::memory_order_relaxed);
+    event.kind = kind;
+    event.player = player < 0 ? kNoPlayer : uint8_t(player);
+    event.creatureType = uint8_t(creatureType);
+    event.reserved = 0;
+    event.value = value;
+    event.creatureId = creatureId;
+    LocalBuffer()->Push(event);
+}
+
+uint64_t EventLog::GetDropped() const {
+    std::lock_guard<std::mutex> lock(m_registryMutex);
+    uint64_t dropped = 0;
+    for (const auto& buffer : m_buffers) {
+        dropped += buffer->GetDropped();
+    }
+    return dropped;
+}
+
+void EventLog::SetCreatureTypeNames(const std::vector<std::string>& names) {
+    EventLogFormat::EncodeTypeTable(names, m_typeTable);
+}
+
+bool EventLog::Start(const std::string& pathPrefix) {
+    if (m_writer.joinable()) return true;
+    m_pathPrefix = pathPrefix;
+    if (m_typeTable.empty()) {
+        EventLogFormat::EncodeTypeTable({}, m_typeTable); // no names, readers fall back to the rows
+    }
+    m_segmentIndex = 0;
+    m_stopping = false;
+    if (!this->NextSegment()) return false;
+    m_writer = std::thread([this]() { this->WriterLoop(); });
+    m_enabled.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void EventLog::Stop() {
+    if (!m_writer.joinable()) return;
+    m_enabled.store(false, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    m_writer.join();
+    m_segment.Close();
+}
+
+bool EventLog::NextSegment() {
+    char suffix[16];
+    std::snprintf(suffix, sizeof(suffix), "-%04d.bin", m_segmentIndex);
+    std::string path = m_pathPrefix + suffix;
+    if (!m_segment.Open(path, kSegmentBytes)) {
+        m_error = "could not map " + path;
+        return false;
+    }
+    if (!m_segment.Append(m_typeTable.data(), m_typeTable.size())) {
+        m_error = "type table does not fit in " + path;
+        return false;
+    }
+    m_segmentIndex += 1;
+    return true;
+}
+
+void EventLog::Drain(std::vector<GameplayEvent>& out) {
+    size_t first = out.size();
+    {
+        std::lock_guard<std::mutex> lock(m_registryMutex);
+        for (auto& buffer : m_buffers) {
+            buffer->Drain(out);
+        }
+    }
+    std::stable_sort(out.begin() + first, out.end(), [](const GameplayEvent& a, const GameplayEvent& b) {
+        return a.timestamp < b.timestamp;
+    });
+}
+
+// full blocks compress best, a partial one is only written when asked to
+void EventLog::WriteBlocks(std::vector<GameplayEvent>& pending, bool everything) {
+    size_t at = 0;
+    while (at < pending.size() && (everything || pending.size() - at >= kBlockEvents)) {
+        size_t count = std::min(kBlockEvents, pending.size() - at);
+        EventLogFormat::EncodeBlock(pending.data() + at, count, m_block);
+        if (!m_segment.Append(m_block.data(), m_block.size())) {
+            m_segment.Close();
+            if (!this->NextSegment() || !m_segment.Append(m_block.data(), m_block.size())) {
+                m_enabled.store(false, std::memory_order_relaxed); // out of disk, stop recording
+                pending.clear();
+                return;
+            }
+        }
+        m_written.fetch_add(count, std::memory_order_relaxed);
+        at += count;
+    }
+    pending.erase(pending.begin(), pending.begin() + at);
+}
+
+void EventLog::WriterLoop() {
+    std::vector<GameplayEvent> pending;
+    int roundsSinceFlush = 0;
+    for (;;) {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_wake.wait_for(lock, std::chrono::milliseconds(kFlushMillis), [this]() { return m_stopping; });
+            stopping = m_stopping;
+        }
+        this->Drain(pending);
+        // full blocks go out on every wake-up; the partial last block is forced out every
+        // 1000 / kFlushMillis wake-ups whatever the load, so nothing sits unwritten for more than a second
+        bool everything = stopping || ++roundsSinceFlush * kFlushMillis >= 1000;
+        if (everything) roundsSinceFlush = 0;
+        this->WriteBlocks(pending, everything);
+        if (stopping) return;
+    }
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Opt-in gameplay analytics. The game thread appends fixed width records into its own ring
+// (same scheme as the Tracer), a writer thread drains the rings every kFlushMillis and packs
+// them into columnar blocks inside memory mapped segment files:
+//   events-<name>-0000.bin, events-<name>-0001.bin, ... each at most kSegmentBytes
+// Standard library only, so tools/eventlog2csv can read the files without openFrameworks.
+enum class GameplayEventKind : uint8_t {
+    Collision, // value: creature value, or the other player for two players
+    Eat, // value: level score after the bite
+    LifeLost, // value: lives left
+    PowerUp, // value: new power
+    LevelChange // value: new level
+};
+
+std::string GameplayEventKindToString(GameplayEventKind kind);
+
+struct GameplayEvent {
+    uint64_t timestamp; // microseconds since the log was created, taken when the tick started
+    uint32_t tick; // world tick, goes back when the game is rewound
+    GameplayEventKind kind;
+    uint8_t player; // index in the scene, kNoPlayer when it is not about one player
+    uint8_t creatureType; // AquariumCreatureType
+    uint8_t reserved;
+    int32_t value;
+    uint32_t creatureId; // 0 when there is none
+};
+static_assert(sizeof(GameplayEvent) == 24, "records are fixed width");
+
+class GameplayEventBuffer {
+    public:
+        explicit GameplayEventBuffer(size_t capacity) : m_events(capacity) {}
+        // producer side, only called from the owning thread
+        void Push(const GameplayEvent& event);
+        // consumer side, appends everything recorded so far to out
+        void Drain(std::vector<GameplayEvent>& out);
+        uint64_t GetDropped() const { return m_dropped.load(std::memory_order_relaxed); }
+    private:
+        std::vector<GameplayEvent> m_events;
+        std::atomic<uint64_t> m_head{0}; // written by the producer
+        std::atomic<uint64_t> m_tail{0}; // written by the consumer
+        std::atomic<uint64_t> m_dropped{0};
+};
+
+// Block layout, every integer a LEB128 varint:
+//   byte count of the rest, event count,
+//   zigzag timestamp deltas, zigzag tick deltas, kind runs, player runs, type runs,
+//   zigzag values, zigzag creature id deltas
+// where a run is (byte, length). Deltas restart with every block, so each block decodes alone.
+// A segment is kMagic, the creature type table (name count, then length and bytes of every name,
+// in row order) and its blocks, so it reads back without the game's behaviors.xml.
+namespace EventLogFormat {
+    constexpr char kMagic[8] = {'A', 'Q', 'E', 'V', 'T', '0', '0', '2'};
+    void EncodeTypeTable(const std::vector<std::string>& names, std::vector<uint8_t>& out);
+    void EncodeBlock(const GameplayEvent* events, size_t count, std::vector<uint8_t>& out);
+    // reads one block starting at data, returns the bytes it used or 0 at the end / on garbage
+    size_t DecodeBlock(const uint8_t* data, size_t size, std::vector<GameplayEvent>& out);
+    // every event of one segment file and its type names, false when it is not a segment
+    bool ReadSegment(const std::string& path, std::vector<GameplayEvent>& out, std::vector<std::string>& typeNames);
+}
+
+// one segment file mapped into memory, grows a block at a time up to its capacity
+class EventSegment {
+    public:
+        EventSegment() = default;
+        ~EventSegment() { this->Close(); }
+        EventSegment(const EventSegment&) = delete;
+        EventSegment& operator=(const EventSegment&) = delete;
+        bool Open(const std::string& path, size_t capacity);
+        bool Append(const uint8_t* data, size_t size); // false when it does not fit
+        void Close(); // trims the file to what was written
+        bool IsOpen() const { return m_file >= 0; }
+    private:
+        int m_file = -1;
+        uint8_t* m_map = nullptr;
+        size_t m_capacity = 0;
+        size_t m_used = 0;
+        std::vector<uint8_t> m_fallback; // where there is no mmap the segment is written on close
+        std::string m_path;
+};
+
+class EventLog {
+    public:
+        static EventLog& Get();
+
+        // the creature type names by row, written at the start of every segment; before Start
+        void SetCreatureTypeNames(const std::vector<std::string>& names);
+        // starts the writer, files go to pathPrefix-0000.bin and on
+        bool Start(const std::string& pathPrefix);
+        // writes what is left and joins the writer
+        void Stop();
+        bool IsEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+        // once per tick from the game thread; events are stamped with its time, reading the
+        // clock for every event would cost about as much as the rest of Record
+        void SetTick(uint32_t tick);
+
+        void Record(GameplayEventKind kind, int player, int creatureType, int value, uint32_t creatureId = 0) {
+            if (IsEnabled()) Push(kind, player, creatureType, value, creatureId);
+        }
+
+        uint64_t GetWritten() const { return m_written.load(std::memory_order_relaxed); }
+        uint64_t GetDropped() const;
+        int GetSegmentCount() const { return m_segmentIndex; }
+        const std::string& GetLastError() const { return m_error; }
+
+        static constexpr uint8_t kNoPlayer = 0xFF;
+        static constexpr size_t kEventsPerThread = 1 << 15;
+        static constexpr size_t kBlockEvents = 4096;
+        static constexpr size_t kSegmentBytes = 4 << 20;
+        static constexpr int kFlushMillis = 250;
+    private:
+        EventLog();
+        ~EventLog() { this->Stop(); }
+        void Push(GameplayEventKind kind, int player, int creatureType, int value, uint32_t creatureId);
+        GameplayEventBuffer* LocalBuffer();
+        void WriterLoop();
+        void Drain(std::vector<GameplayEvent>& out);
+        void WriteBlocks(std::vector<GameplayEvent>& pending, bool everything);
+        bool NextSegment();
+
+        std::atomic<bool> m_enabled{false};
+        std::atomic<uint32_t> m_tick{0};
+        std::atomic<uint64_t> m_tickTimestamp{0};
+        std::atomic<uint64_t> m_written{0};
+        mutable std::mutex m_registryMutex; // guards m_buffers, never taken while recording
+        std::vector<std::unique_ptr<GameplayEventBuffer>> m_buffers;
+        uint64_t m_epoch;
+
+        // writer thread only, after Start
+        std::thread m_writer;
+        std::mutex m_wakeMutex;
+        std::condition_variable m_wake;
+        bool m_stopping = false;
+        std::string m_pathPrefix;
+        std::vector<uint8_t> m_typeTable; // encoded, fixed once the writer runs
+        EventSegment m_segment;
+        int m_segmentIndex = 0;
+        std::vector<uint8_t> m_block;
+        std::string m_error;
+};
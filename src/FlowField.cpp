@@ -0,0 +1,106 @@
+#include "FlowField.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+
+FlowField::FlowField(float width, float height, float cellSize)
+: m_cellSize(std::max(1.0f, cellSize)) {
+    m_columns = std::max(1, int(std::ceil(width / m_cellSize)));
+    m_rows = std::max(1, int(std::ceil(height / m_cellSize)));
+    size_t cells = size_t(m_columns) * m_rows;
+    m_distance.assign(cells, kUnreachable);
+    m_dirX.assign(cells, 0.0f);
+    m_dirY.assign(cells, 0.0f);
+}
+
+int FlowField::CellX(float x) const {
+    return std::clamp(int(std::floor(x / m_cellSize)), 0, m_columns - 1);
+}
+
+int FlowField::CellY(float y) const {
+    return std::clamp(int(std::floor(y / m_cellSize)), 0, m_rows - 1);
+}
+
+bool FlowField::Update(float targetX, float targetY) {
+    int target = this->Index(this->CellX(targetX), this->CellY(targetY));
+    if (target == m_targetCell) {
+        return false; // the target is still in the same cell, the field is still right
+    }
+    m_targetCell = target;
+    this->Integrate();
+    return true;
+}
+
+void FlowField::Integrate() {
+    static const int kStepX[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+    static const int kStepY[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+    static const float kStepCost[8] = {1, 1, 1, 1, 1.41421356f, 1.41421356f, 1.41421356f, 1.41421356f};
+
+    std::fill(m_distance.begin(), m_distance.end(), kUnreachable);
+    std::fill(m_dirX.begin(), m_dirX.end(), 0.0f);
+    std::fill(m_dirY.begin(), m_dirY.end(), 0.0f);
+
+    // Dijkstra from the target outwards, with lazy deletion instead of decrease-key
+    auto later = std::greater<std::pair<float, int>>();
+    m_heap.clear();
+    m_distance[m_targetCell] = 0.0f;
+    m_heap.emplace_back(0.0f, m_targetCell);
+    while (!m_heap.empty()) {
+        std::pop_heap(m_heap.begin(), m_heap.end(), later);
+        auto [distance, cell] = m_heap.back();
+        m_heap.pop_back();
+        if (distance > m_distance[cell]) continue; // stale entry
+        int cx = cell % m_columns;
+        int cy = cell / m_columns;
+        for (int k = 0; k < 8; ++k) {
+            int nx = cx + kStepX[k];
+            int ny = cy + kStepY[k];
+            if (nx < 0 || ny < 0 || nx >= m_columns || ny >= m_rows) continue;
+            int next = this->Index(nx, ny);
+            float candidate = distance + kStepCost[k];
+            if (candidate < m_distance[next]) {
+                m_distance[next] = candidate;
+                m_heap.emplace_back(candidate, next);
+                std::push_heap(m_heap.begin(), m_heap.end(), later);
+            }
+        }
+    }
+
+    // every cell points along the steepest descent of the distance
+    for (int cy = 0; cy < m_rows; ++cy) {
+        for (int cx = 0; cx < m_columns; ++cx) {
+            int cell = this->Index(cx, cy);
+            if (m_distance[cell] >= kUnreachable || cell == m_targetCell) continue;
+            float best = m_distance[cell];
+            int bestK = -1;
+            for (int k = 0; k < 8; ++k) {
+                int nx = cx + kStepX[k];
+                int ny = cy + kStepY[k];
+                if (nx < 0 || ny < 0 || nx >= m_columns || ny >= m_rows) continue;
+                float distance = m_distance[this->Index(nx, ny)];
+                if (distance < best) {
+                    best = distance;
+                    bestK = k;
+                }
+            }
+            if (bestK >= 0) {
+                float length = kStepCost[bestK];
+                m_dirX[cell] = kStepX[bestK] / length;
+                m_dirY[cell] = kStepY[bestK] / length;
+            }
+        }
+    }
+}
+
+void FlowField::Sample(float x, float y, float& dx, float& dy) const {
+    int cell = this->Index(this->CellX(x), this->CellY(y));
+    dx = m_dirX[cell];
+    dy = m_dirY[cell];
+}
+
+float FlowField::DistanceAt(float x, float y) const {
+    float distance = m_distance[this->Index(this->CellX(x), this->CellY(y))];
+    return distance >= kUnreachable ? kUnreachable : distance * m_cellSize;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Shared pursuit field over a coarse grid of the world. One Dijkstra pass from the target cell
+// gives every cell its path distance to the target, and every cell keeps the direction of its
+// cheapest neighbor, so any number of hunters sample it in O(1). The world edges are the only
+// walls, there are no obstacles inside the tank.
+// The field is only integrated again when the target enters another cell.
+class FlowField {
+    public:
+        FlowField(float width, float height, float cellSize);
+
+        // returns true when the field had to be integrated again
+        bool Update(float targetX, float targetY);
+
+        // unit direction towards the target from (x, y), (0, 0) in the target cell
+        void Sample(float x, float y, float& dx, float& dy) const;
+        // path length in world units from (x, y) to the target, kUnreachable if there is none
+        float DistanceAt(float x, float y) const;
+
+        int CellX(float x) const;
+        int CellY(float y) const;
+        int GetColumns() const { return m_columns; }
+        int GetRows() const { return m_rows; }
+        float GetCellSize() const { return m_cellSize; }
+
+        static constexpr float kUnreachable = 1e30f;
+    private:
+        int Index(int cx, int cy) const { return cy * m_columns + cx; }
+        void Integrate();
+
+        float m_cellSize;
+        int m_columns;
+        int m_rows;
+        int m_targetCell = -1;
+        std::vector<float> m_distance; // in cells
+        std::vector<float> m_dirX;
+        std::vector<float> m_dirY;
+        std::vector<std::pair<float, int>> m_heap; // open list, kept to reuse its memory
+};
@@ -0,0 +1,189 @@
+#include "FrameStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <new>
+#include <sstream>
+#include "ofMain.h"
+
+
+// Allocation counting
+// replacing the global operator new is the only portable way to see every allocation,
+// the counter is relaxed since we only need per-frame totals on the game thread
+namespace {
+    std::atomic<uint64_t> g_allocationCount{0};
+    thread_local uint64_t t_allocationCount = 0; // plain integer, so no TLS constructor runs inside operator new
+    std::atomic<int64_t> g_assetBytes{0};
+}
+
+void* operator new(std::size_t size) {
+    g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+    t_allocationCount += 1;
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+uint64_t GetAllocationCount() {
+    return g_allocationCount.load(std::memory_order_relaxed);
+}
+
+uint64_t GetThreadAllocationCount() {
+    return t_allocationCount;
+}
+
+void AddAssetBytes(int64_t bytes) {
+    g_assetBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+int64_t GetAssetBytes() {
+    return g_assetBytes.load(std::memory_order_relaxed);
+}
+
+
+// FrameTimeHistogram Implementation
+int FrameTimeHistogram::IndexOf(uint64_t value) {
+    value = std::min(value, kMaxValue);
+    int msb = 63;
+    while (msb > 0 && !(value >> msb)) --msb;
+    int shift = std::max(0, msb - kSubBucketBits);
+    return shift * kSubBuckets + int(value >> shift);
+}
+
+uint64_t FrameTimeHistogram::UpperBoundOf(int index) {
+    if (index < 2 * kSubBuckets) {
+        return uint64_t(index);
+    }
+    int shift = index / kSubBuckets - 1;
+    uint64_t mantissa = uint64_t(index - shift * kSubBuckets);
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void FrameTimeHistogram::Record(uint64_t micros) {
+    m_counts[IndexOf(micros)] += 1;
+    m_count += 1;
+    m_total += micros;
+    m_max = std::max(m_max, micros);
+}
+
+void FrameTimeHistogram::Reset() {
+    m_counts.fill(0);
+    m_count = 0;
+    m_total = 0;
+    m_max = 0;
+}
+
+uint64_t FrameTimeHistogram::Percentile(double p) const {
+    if (m_count == 0) return 0;
+    uint64_t target = uint64_t(std::ceil(m_count * std::clamp(p, 0.0, 100.0) / 100.0));
+    target = std::max<uint64_t>(target, 1);
+    uint64_t seen = 0;
+    for (int i = 0; i < kBucketCount; ++i) {
+        seen += m_counts[i];
+        if (seen >= target) {
+            return std::min(UpperBoundOf(i), m_max);
+        }
+    }
+    return m_max;
+}
+
+
+std::string FramePhaseToString(FramePhase phase) {
+    switch (phase) {
+        case FramePhase::Update: return "update";
+        case FramePhase::Draw: return "draw";
+        case FramePhase::Collisions: return "collisions";
+        case FramePhase::Repopulate: return "repopulate";
+        case FramePhase::LevelTransition: return "level_transition";
+        default: return "unknown";
+    }
+}
+
+
+// FrameMonitor Implementation
+FrameMonitor& FrameMonitor::Get() {
+    static FrameMonitor instance;
+    return instance;
+}
+
+void FrameMonitor::FrameBoundary(const FrameContext& context) {
+    Clock::time_point now = Clock::now();
+    uint64_t allocations = GetThreadAllocationCount(); // the frame's own, not the workers' or the metrics server's
+    if (m_started && !context.idle) {
+        uint64_t frameMicros = std::chrono::duration_cast<std::chrono::microseconds>(now - m_frameStart).count();
+        m_histogram.Record(frameMicros);
+        if (frameMicros > m_hitchThresholdMicros) {
+            m_hitchCount += 1;
+            if (m_hitches.size() < kMaxHitchRecords) {
+                HitchRecord hitch;
+                hitch.frameNumber = m_frameNumber;
+                hitch.frameMicros = frameMicros;
+                hitch.allocations = allocations - m_frameAllocations;
+                hitch.levelChanged = m_lastLevel != context.level;
+                hitch.context = context;
+                hitch.phaseMicros = m_phaseMicros;
+                m_hitches.push_back(hitch);
+            }
+        }
+    }
+    m_started = true;
+    m_frameStart = now;
+    m_frameAllocations = allocations;
+    m_frameNumber += 1;
+    m_lastLevel = context.level;
+    m_phaseMicros.fill(0);
+}
+
+std::string FrameMonitor::Report() const {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2);
+    out << "frames: " << m_histogram.GetCount()
+        << " mean: " << m_histogram.GetMean() / 1000.0 << " ms"
+        << " p50: " << m_histogram.Percentile(50) / 1000.0 << " ms"
+        << " p95: " << m_histogram.Percentile(95) / 1000.0 << " ms"
+        << " p99: " << m_histogram.Percentile(99) / 1000.0 << " ms"
+        << " max: " << m_histogram.GetMax() / 1000.0 << " ms\n";
+    out << "input to photon: " << m_inputLatency.GetCount() << " inputs"
+        << " p50: " << m_inputLatency.Percentile(50) / 1000.0 << " ms"
+        << " p95: " << m_inputLatency.Percentile(95) / 1000.0 << " ms"
+        << " p99: " << m_inputLatency.Percentile(99) / 1000.0 << " ms"
+        << " max: " << m_inputLatency.GetMax() / 1000.0 << " ms\n";
+    out << "hitches over " << GetHitchThreshold() << " ms: " << m_hitchCount
+        << " (SLO p99 " << (m_histogram.Percentile(99) <= m_hitchThresholdMicros ? "met" : "MISSED") << ")\n";
+    for (const HitchRecord& hitch : m_hitches) {
+        out << "  frame " << hitch.frameNumber << ": " << hitch.frameMicros / 1000.0 << " ms"
+            << " scene=" << hitch.context.scene
+            << " level=" << hitch.context.level << (hitch.levelChanged ? " (level changed)" : "")
+            << " creatures=" << hitch.context.creatureCount
+            << " drawn=" << hitch.context.drawnCount
+            << " allocations=" << hitch.allocations;
+        for (size_t i = 0; i < hitch.phaseMicros.size(); ++i) {
+            out << " " << FramePhaseToString(FramePhase(i)) << "=" << hitch.phaseMicros[i] / 1000.0;
+        }
+        out << "\n";
+    }
+    return out.str();
+}
+
+bool FrameMonitor::WriteSummary(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) {
+        ofLogError() << "FrameMonitor could not open " << path << std::endl;
+        return false;
+    }
+    out << this->Report();
+    return true;
+}
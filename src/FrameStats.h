@@ -0,0 +1,139 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Log-linear histogram in the spirit of HdrHistogram: 32 linear sub-buckets per power of
+// two, so any recorded value is reported with at most ~3% error. Values are microseconds.
+class FrameTimeHistogram {
+    public:
+        void Record(uint64_t micros);
+        void Reset();
+        uint64_t Percentile(double p) const; // p in [0, 100]
+        uint64_t GetMax() const { return m_max; }
+        uint64_t GetCount() const { return m_count; }
+        double GetMean() const { return m_count ? double(m_total) / m_count : 0.0; }
+
+        static constexpr int kSubBucketBits = 5;
+        static constexpr int kSubBuckets = 1 << kSubBucketBits;
+        static constexpr uint64_t kMaxValue = (uint64_t(1) << 30) - 1; // ~18 minutes
+        static constexpr int kBucketCount = (30 - kSubBucketBits) * kSubBuckets + 2 * kSubBuckets;
+    private:
+        static int IndexOf(uint64_t value);
+        static uint64_t UpperBoundOf(int index);
+        std::array<uint64_t, kBucketCount> m_counts{};
+        uint64_t m_count = 0;
+        uint64_t m_total = 0;
+        uint64_t m_max = 0;
+};
+
+// Every heap allocation made by the process, counted by the operator new replacement in FrameStats.cpp
+uint64_t GetAllocationCount();
+// Only the ones made by the calling thread, what a frame costs when called from the game thread
+uint64_t GetThreadAllocationCount();
+
+// Pixel memory held by loaded assets, any thread can read it
+void AddAssetBytes(int64_t bytes);
+int64_t GetAssetBytes();
+
+// keeps GetAssetBytes() in step with what its owner holds, a copy of the owner counts again
+class AssetCharge {
+    public:
+        AssetCharge() = default;
+        AssetCharge(const AssetCharge& other) : m_bytes(other.m_bytes) { AddAssetBytes(m_bytes); }
+        AssetCharge& operator=(const AssetCharge& other) { this->Set(other.m_bytes); return *this; }
+        ~AssetCharge() { AddAssetBytes(-m_bytes); }
+        void Set(int64_t bytes) { AddAssetBytes(bytes - m_bytes); m_bytes = bytes; }
+    private:
+        int64_t m_bytes = 0;
+};
+
+enum class FramePhase {
+    Update,
+    Draw,
+    Collisions,
+    Repopulate,
+    LevelTransition,
+    Count
+};
+
+std::string FramePhaseToString(FramePhase phase);
+
+// what the app knows about the world when a frame finishes, kept with every hitch
+struct FrameContext {
+    int creatureCount = 0;
+    int drawnCount = 0; // creatures that survived view culling last frame
+    int level = 0;
+    std::string scene;
+    bool idle = false; // running at the idle frame rate on purpose, not counted against the SLO
+};
+
+struct HitchRecord {
+    uint64_t frameNumber = 0;
+    uint64_t frameMicros = 0;
+    uint64_t allocations = 0;
+    bool levelChanged = false;
+    FrameContext context;
+    std::array<uint64_t, size_t(FramePhase::Count)> phaseMicros{};
+};
+
+// Measures frame-to-frame time against an SLO and keeps the context of every frame over the
+// hitch threshold. Only the game thread records phases.
+class FrameMonitor {
+    public:
+        static FrameMonitor& Get();
+
+        // called once at the start of every ofApp::update, closes the previous frame
+        void FrameBoundary(const FrameContext& context);
+        void AddPhaseTime(FramePhase phase, uint64_t micros) { m_phaseMicros[size_t(phase)] += micros; }
+
+        void SetHitchThreshold(double millis) { m_hitchThresholdMicros = uint64_t(millis * 1000.0); }
+        double GetHitchThreshold() const { return m_hitchThresholdMicros / 1000.0; }
+        const FrameTimeHistogram& GetHistogram() const { return m_histogram; }
+        const std::vector<HitchRecord>& GetHitches() const { return m_hitches; }
+        uint64_t GetHitchCount() const { return m_hitchCount; }
+        // key event to the first presented frame that shows its effect
+        void RecordInputLatency(uint64_t micros) { m_inputLatency.Record(micros); }
+        const FrameTimeHistogram& GetInputLatency() const { return m_inputLatency; }
+
+        std::string Report() const;
+        bool WriteSummary(const std::string& path) const;
+
+        static constexpr size_t kMaxHitchRecords = 256;
+    private:
+        FrameMonitor() = default;
+        using Clock = std::chrono::steady_clock;
+
+        FrameTimeHistogram m_histogram;
+        FrameTimeHistogram m_inputLatency;
+        std::vector<HitchRecord> m_hitches; // the first kMaxHitchRecords hitches of the session
+        uint64_t m_hitchCount = 0;
+        uint64_t m_hitchThresholdMicros = 16600;
+        uint64_t m_frameNumber = 0;
+        uint64_t m_frameAllocations = 0;
+        int m_lastLevel = -1;
+        bool m_started = false;
+        Clock::time_point m_frameStart;
+        std::array<uint64_t, size_t(FramePhase::Count)> m_phaseMicros{};
+};
+
+// RAII helper that adds the time spent in its scope to one of the frame phases
+class FramePhaseScope {
+    public:
+        explicit FramePhaseScope(FramePhase phase)
+        : m_phase(phase), m_start(std::chrono::steady_clock::now()) {}
+        ~FramePhaseScope() {
+            auto elapsed = std::chrono::steady_clock::now() - m_start;
+            FrameMonitor::Get().AddPhaseTime(m_phase,
+                std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+        }
+        FramePhaseScope(const FramePhaseScope&) = delete;
+        FramePhaseScope& operator=(const FramePhaseScope&) = delete;
+    private:
+        FramePhase m_phase;
+        std::chrono::steady_clock::time_point m_start;
+};
@@ -0,0 +1,75 @@
+#include "HudLayer.h"
+
+
+// a font that does not load is not tried again, the HUD falls back to the bitmap font and stays usable
+bool HudLayer::Setup(const std::string& fontPath, int fontSize, int width, int height) {
+    m_bitmapFont = !m_font.load(fontPath, fontSize, true, true);
+    if (m_bitmapFont) {
+        ofLogError() << "HudLayer could not load " << fontPath << ", using the bitmap font" << std::endl;
+    }
+    m_fbo.allocate(width, height, GL_RGBA);
+    m_ready = true;
+    m_dirty = true;
+    return !m_bitmapFont;
+}
+
+int HudLayer::AddCounter(const std::string& label, float x, float y) {
+    Element element{ElementKind::Counter, label + ": ", x, y};
+    m_elements.push_back(element);
+    m_dirty = true;
+    return int(m_elements.size()) - 1;
+}
+
+int HudLayer::AddPips(float x, float y, float spacing, float radius, const ofColor& color) {
+    Element element{ElementKind::Pips, "", x, y, spacing, radius, color};
+    m_elements.push_back(element);
+    m_dirty = true;
+    return int(m_elements.size()) - 1;
+}
+
+void HudLayer::SetValue(int slot, int value) {
+    Element& element = m_elements[slot];
+    if (element.value != value) {
+        element.value = value;
+        m_dirty = true;
+    }
+}
+
+void HudLayer::Repaint() {
+    m_fbo.begin();
+    ofClear(0, 0, 0, 0);
+    ofPushStyle();
+    for (const Element& element : m_elements) {
+        switch (element.kind) {
+            case ElementKind::Counter:
+                m_text.assign(element.label);
+                m_text.append(std::to_string(element.value));
+                ofSetColor(ofColor::white);
+                if (m_bitmapFont) {
+                    ofDrawBitmapString(m_text, element.x, element.y);
+                } else {
+                    m_font.drawString(m_text, element.x, element.y);
+                }
+                break;
+            case ElementKind::Pips:
+                ofSetColor(element.color);
+                for (int i = 0; i < element.value; ++i) {
+                    ofDrawCircle(element.x + i * element.spacing, element.y, element.radius);
+                }
+                break;
+        }
+    }
+    ofPopStyle();
+    m_fbo.end();
+    m_dirty = false;
+    m_repaints += 1;
+}
+
+void HudLayer::Draw(float x, float y) {
+    if (!m_ready) return;
+    if (m_dirty) {
+        this->Repaint();
+    }
+    ofSetColor(ofColor::white);
+    m_fbo.draw(x, y);
+}
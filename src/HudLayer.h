@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ofMain.h"
+
+// Retained HUD: the text and icons are rendered into an FBO and that FBO is all a frame draws.
+// Values are pushed every frame but only compared, the FBO is repainted when one of them changed.
+// The font is loaded once, ofTrueTypeFont builds its glyph atlas texture at load time, so
+// repainting is only quads out of that atlas.
+class HudLayer {
+    public:
+        // false when the font did not load, the layer is still ready and draws with the bitmap font
+        bool Setup(const std::string& fontPath, int fontSize, int width, int height);
+        bool IsReady() const { return m_ready; }
+        bool IsUsingBitmapFont() const { return m_bitmapFont; }
+
+        // "label: value" line, returns the slot to pass to SetValue
+        int AddCounter(const std::string& label, float x, float y);
+        // value circles in a row, for things like lives
+        int AddPips(float x, float y, float spacing, float radius, const ofColor& color);
+        void SetValue(int slot, int value);
+
+        void Draw(float x, float y);
+        void Invalidate() { m_dirty = true; }
+        int GetRepaintCount() const { return m_repaints; }
+    private:
+        enum class ElementKind { Counter, Pips };
+        struct Element {
+            ElementKind kind;
+            std::string label;
+            float x;
+            float y;
+            float spacing = 0.0f;
+            float radius = 0.0f;
+            ofColor color = ofColor::white;
+            int value = 0;
+        };
+        void Repaint();
+
+        ofTrueTypeFont m_font;
+        ofFbo m_fbo;
+        std::vector<Element> m_elements;
+        std::string m_text; // reused by Repaint so it does not allocate once it has grown
+        bool m_ready = false;
+        bool m_bitmapFont = false; // the font failed to load
+        bool m_dirty = true;
+        int m_repaints = 0;
+};
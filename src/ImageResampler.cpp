@@ -0,0 +1,302 @@
+#include "ImageResampler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include "Tracer.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RESAMPLER_X86 1
+#include <immintrin.h>
+#endif
+#if defined(RESAMPLER_X86) && (defined(__GNUC__) || defined(__clang__))
+#define RESAMPLER_AVX2 1 // compiled with a target attribute, so only used when the CPU says so
+#endif
+
+
+namespace {
+    const float kPi = 3.14159265358979f;
+
+    float FilterSupport(ResampleFilter filter) {
+        switch (filter) {
+            case ResampleFilter::Box: return 0.5f;
+            case ResampleFilter::Bilinear: return 1.0f;
+            case ResampleFilter::CatmullRom: return 2.0f;
+            case ResampleFilter::Lanczos3: return 3.0f;
+        }
+        return 1.0f;
+    }
+
+    float FilterWeight(ResampleFilter filter, float x) {
+        x = std::abs(x);
+        switch (filter) {
+            case ResampleFilter::Box:
+                return x <= 0.5f ? 1.0f : 0.0f;
+            case ResampleFilter::Bilinear:
+                return x < 1.0f ? 1.0f - x : 0.0f;
+            case ResampleFilter::CatmullRom:
+                if (x < 1.0f) return 1.5f * x * x * x - 2.5f * x * x + 1.0f;
+                if (x < 2.0f) return -0.5f * x * x * x + 2.5f * x * x - 4.0f * x + 2.0f;
+                return 0.0f;
+            case ResampleFilter::Lanczos3:
+                if (x < 1e-6f) return 1.0f;
+                if (x >= 3.0f) return 0.0f;
+                return 3.0f * std::sin(kPi * x) * std::sin(kPi * x / 3.0f) / (kPi * kPi * x * x);
+        }
+        return 0.0f;
+    }
+
+    // every output sample reads taps inputs starting at start[o], with weights[o * taps + t]
+    struct Contributors {
+        int taps = 0;
+        std::vector<int> start;
+        std::vector<float> weights;
+    };
+
+    Contributors BuildContributors(int inSize, int outSize, ResampleFilter filter) {
+        Contributors c;
+        float scale = float(outSize) / inSize;
+        float stretch = scale < 1.0f ? 1.0f / scale : 1.0f; // downscaling widens the filter
+        float support = FilterSupport(filter) * stretch;
+        c.taps = std::min(inSize, int(std::ceil(support * 2.0f)) + 1);
+        c.start.resize(outSize);
+        c.weights.assign(size_t(outSize) * c.taps, 0.0f);
+        for (int o = 0; o < outSize; ++o) {
+            float center = (o + 0.5f) / scale;
+            int lo = std::max(0, int(std::floor(center - support)));
+            int hi = std::min(inSize - 1, int(std::ceil(center + support)));
+            int start = std::max(0, std::min(lo, inSize - c.taps));
+            float total = 0.0f;
+            float* w = &c.weights[size_t(o) * c.taps];
+            for (int i = lo; i <= hi && i - start < c.taps; ++i) {
+                float weight = FilterWeight(filter, (i + 0.5f - center) / stretch);
+                w[i - start] = weight;
+                total += weight;
+            }
+            if (total != 0.0f) {
+                for (int t = 0; t < c.taps; ++t) w[t] /= total;
+            } else {
+                w[std::min(c.taps - 1, std::max(0, int(center) - start))] = 1.0f; // nearest, for tiny inputs
+            }
+            c.start[o] = start;
+        }
+        return c;
+    }
+
+    // one row, 8 bit in, float out
+    void HorizontalScalar(const uint8_t* in, float* out, int channels, int outWidth, const Contributors& c) {
+        for (int o = 0; o < outWidth; ++o) {
+            const float* w = &c.weights[size_t(o) * c.taps];
+            const uint8_t* px = in + size_t(c.start[o]) * channels;
+            for (int ch = 0; ch < channels; ++ch) {
+                float sum = 0.0f;
+                for (int t = 0; t < c.taps; ++t) sum += w[t] * px[t * channels + ch];
+                out[o * channels + ch] = sum;
+            }
+        }
+    }
+
+    // rows of floats, out = sum weights[t] * rows[t]
+    void VerticalScalar(const float* const* rows, const float* weights, int taps, float* out, int length) {
+        for (int i = 0; i < length; ++i) {
+            float sum = 0.0f;
+            for (int t = 0; t < taps; ++t) sum += weights[t] * rows[t][i];
+            out[i] = sum;
+        }
+    }
+
+#ifdef RESAMPLER_X86
+    // an RGBA pixel is exactly one SSE register
+    void HorizontalSSE4Channels(const uint8_t* in, float* out, int outWidth, const Contributors& c) {
+        const __m128i zero = _mm_setzero_si128();
+        for (int o = 0; o < outWidth; ++o) {
+            const float* w = &c.weights[size_t(o) * c.taps];
+            const uint8_t* px = in + size_t(c.start[o]) * 4;
+            __m128 sum = _mm_setzero_ps();
+            for (int t = 0; t < c.taps; ++t) {
+                int packed;
+                std::memcpy(&packed, px + t * 4, 4);
+                __m128i bytes = _mm_cvtsi32_si128(packed);
+                __m128i ints = _mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero);
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(ints), _mm_set1_ps(w[t])));
+            }
+            _mm_storeu_ps(out + o * 4, sum);
+        }
+    }
+
+    void VerticalSSE(const float* const* rows, const float* weights, int taps, float* out, int length) {
+        int i = 0;
+        for (; i + 4 <= length; i += 4) {
+            __m128 sum = _mm_setzero_ps();
+            for (int t = 0; t < taps; ++t) {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(rows[t] + i), _mm_set1_ps(weights[t])));
+            }
+            _mm_storeu_ps(out + i, sum);
+        }
+        for (; i < length; ++i) {
+            float sum = 0.0f;
+            for (int t = 0; t < taps; ++t) sum += weights[t] * rows[t][i];
+            out[i] = sum;
+        }
+    }
+#endif
+
+#ifdef RESAMPLER_AVX2
+    __attribute__((target("avx2,fma")))
+    void VerticalAVX2(const float* const* rows, const float* weights, int taps, float* out, int length) {
+        int i = 0;
+        for (; i + 8 <= length; i += 8) {
+            __m256 sum = _mm256_setzero_ps();
+            for (int t = 0; t < taps; ++t) {
+                sum = _mm256_fmadd_ps(_mm256_loadu_ps(rows[t] + i), _mm256_set1_ps(weights[t]), sum);
+            }
+            _mm256_storeu_ps(out + i, sum);
+        }
+        for (; i < length; ++i) {
+            float sum = 0.0f;
+            for (int t = 0; t < taps; ++t) sum += weights[t] * rows[t][i];
+            out[i] = sum;
+        }
+    }
+
+    bool HasAVX2() {
+        static const bool has = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        return has;
+    }
+#endif
+
+    using VerticalPass = void (*)(const float* const*, const float*, int, float*, int);
+
+    VerticalPass PickVerticalPass() {
+#ifdef RESAMPLER_AVX2
+        if (HasAVX2()) return VerticalAVX2;
+#endif
+#ifdef RESAMPLER_X86
+        return VerticalSSE;
+#else
+        return VerticalScalar;
+#endif
+    }
+}
+
+
+namespace ImageResampler {
+
+const char* GetInstructionSet() {
+#ifdef RESAMPLER_AVX2
+    if (HasAVX2()) return "avx2";
+#endif
+#ifdef RESAMPLER_X86
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+void Resample(const uint8_t* src, int srcWidth, int srcHeight, int channels,
+              uint8_t* dst, int dstWidth, int dstHeight, ResampleFilter filter) {
+    if (srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0) return;
+    Contributors horizontal = BuildContributors(srcWidth, dstWidth, filter);
+    Contributors vertical = BuildContributors(srcHeight, dstHeight, filter);
+
+    // horizontal pass, only the source rows the vertical pass will read: the starts only grow,
+    // so that is the span from the first output row's first tap to the last one's last tap
+    int firstRow = vertical.start[0];
+    int lastRow = vertical.start[dstHeight - 1] + vertical.taps; // exclusive
+    size_t rowLength = size_t(dstWidth) * channels;
+    std::vector<float> filtered(size_t(lastRow - firstRow) * rowLength);
+    for (int y = firstRow; y < lastRow; ++y) {
+        const uint8_t* in = src + size_t(y) * srcWidth * channels;
+        float* out = &filtered[size_t(y - firstRow) * rowLength];
+#ifdef RESAMPLER_X86
+        if (channels == 4) {
+            HorizontalSSE4Channels(in, out, dstWidth, horizontal);
+            continue;
+        }
+#endif
+        HorizontalScalar(in, out, channels, dstWidth, horizontal);
+    }
+
+    // vertical pass straight into 8 bit
+    VerticalPass pass = PickVerticalPass();
+    std::vector<const float*> rows(vertical.taps);
+    std::vector<float> row(rowLength);
+    for (int y = 0; y < dstHeight; ++y) {
+        for (int t = 0; t < vertical.taps; ++t) {
+            rows[t] = &filtered[size_t(vertical.start[y] + t - firstRow) * rowLength];
+        }
+        pass(rows.data(), &vertical.weights[size_t(y) * vertical.taps], vertical.taps, row.data(), int(rowLength));
+        uint8_t* out = dst + size_t(y) * rowLength;
+        for (size_t i = 0; i < rowLength; ++i) {
+            out[i] = uint8_t(std::min(255.0f, std::max(0.0f, row[i] + 0.5f))); // sharp filters overshoot
+        }
+    }
+}
+
+void Resample(const ofPixels& src, ofPixels& dst, int width, int height, ResampleFilter filter) {
+    int channels = int(src.getNumChannels());
+    dst.allocate(width, height, channels);
+    Resample(src.getData(), int(src.getWidth()), int(src.getHeight()), channels, dst.getData(), width, height, filter);
+}
+
+}
+
+
+// ResampleCache Implementation
+bool ResampleCache::AddSource(const std::string& asset) {
+    auto pixels = std::make_shared<ofPixels>();
+    if (!ofLoadImage(*pixels, asset)) {
+        ofLogError() << "ResampleCache could not load " << asset << std::endl;
+        return false;
+    }
+    m_sources[asset] = pixels;
+    return true;
+}
+
+std::shared_ptr<const ofPixels> ResampleCache::Touch(const Key& key) {
+    auto cached = m_cache.find(key);
+    if (cached == m_cache.end()) return nullptr;
+    m_recent.remove(key);
+    m_recent.push_front(key);
+    return cached->second;
+}
+
+std::shared_ptr<const ofPixels> ResampleCache::Request(const std::string& asset, int width, int height) {
+    Key key(asset, width, height);
+    if (auto pixels = this->Touch(key)) {
+        return pixels;
+    }
+    auto source = m_sources.find(asset);
+    if (source == m_sources.end() || m_jobs.count(key) > 0) {
+        return nullptr;
+    }
+    std::shared_ptr<const ofPixels> original = source->second;
+    ResampleFilter filter = m_filter;
+    m_jobs[key] = std::async(std::launch::async, [original, width, height, filter]() {
+        TraceScope trace("ResampleCache::Resample");
+        auto scaled = std::make_shared<ofPixels>();
+        ImageResampler::Resample(*original, *scaled, width, height, filter);
+        return std::shared_ptr<const ofPixels>(scaled);
+    });
+    return nullptr;
+}
+
+bool ResampleCache::Poll() {
+    bool finished = false;
+    for (auto it = m_jobs.begin(); it != m_jobs.end(); ) {
+        if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            ++it;
+            continue;
+        }
+        m_cache[it->first] = it->second.get();
+        m_recent.push_front(it->first);
+        while (m_recent.size() > kMaxCached) {
+            m_cache.erase(m_recent.back());
+            m_recent.pop_back();
+        }
+        it = m_jobs.erase(it);
+        finished = true;
+    }
+    return finished;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "ofMain.h"
+
+enum class ResampleFilter {
+    Box,
+    Bilinear,
+    CatmullRom,
+    Lanczos3
+};
+
+// Separable resampler: rows are filtered horizontally into a float buffer, then the buffer is
+// filtered vertically. The inner loops run on SSE2 (and AVX2 when the CPU has it, picked at
+// runtime) on x86, every other target takes the scalar loops.
+namespace ImageResampler {
+    // 8 bit pixels with 1 to 4 interleaved channels, dst must hold dstWidth * dstHeight * channels bytes
+    void Resample(const uint8_t* src, int srcWidth, int srcHeight, int channels,
+                  uint8_t* dst, int dstWidth, int dstHeight, ResampleFilter filter);
+    void Resample(const ofPixels& src, ofPixels& dst, int width, int height, ResampleFilter filter);
+    const char* GetInstructionSet(); // what Resample runs on this machine
+}
+
+// Full window images (background, banners) at the window size. Originals are kept so every
+// size is resampled from the full image, results are cached by (asset, size) so going back to
+// a size is free, and resampling runs on a worker so a live resize never blocks a frame.
+class ResampleCache {
+    public:
+        bool AddSource(const std::string& asset);
+        void SetFilter(ResampleFilter filter) { m_filter = filter; }
+
+        // the cached result, or nullptr after starting (once) a job that makes it
+        std::shared_ptr<const ofPixels> Request(const std::string& asset, int width, int height);
+        // moves finished jobs into the cache, returns true when one finished
+        bool Poll();
+        size_t GetCachedCount() const { return m_cache.size(); }
+
+        static constexpr size_t kMaxCached = 12; // full window RGBA images, so keep it small
+    private:
+        using Key = std::tuple<std::string, int, int>;
+        std::shared_ptr<const ofPixels> Touch(const Key& key);
+
+        ResampleFilter m_filter = ResampleFilter::CatmullRom;
+        std::map<std::string, std::shared_ptr<const ofPixels>> m_sources;
+        std::map<Key, std::shared_ptr<const ofPixels>> m_cache;
+        std::list<Key> m_recent; // most recently used first, the back is evicted
+        std::map<Key, std::future<std::shared_ptr<const ofPixels>>> m_jobs;
+};
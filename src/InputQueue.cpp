@@ -0,0 +1,31 @@
+#include "InputQueue.h"
+
+#include <chrono>
+#include "FrameStats.h"
+
+
+uint64_t InputQueue::NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void InputQueue::Push(int key, bool pressed) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_events.push_back(InputEvent{key, pressed, NowMicros()});
+}
+
+void InputQueue::Drain(std::vector<InputEvent>& out) {
+    out.clear();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    out.swap(m_events); // both vectors keep their capacity, so nothing allocates once warmed up
+}
+
+// Called at the top of ofApp::update. With vsync the buffer swap after the previous draw
+// blocks until it is presented, so by now the frame that showed the last tick is on screen.
+void InputQueue::MarkPresented() {
+    uint64_t now = NowMicros();
+    for (uint64_t micros : m_applied) {
+        FrameMonitor::Get().RecordInputLatency(now - micros);
+    }
+    m_applied.clear();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct InputEvent {
+    int key = 0;
+    bool pressed = false;
+    uint64_t micros = 0; // steady clock time the event arrived
+};
+
+// Key events are queued with their arrival time and only handed to the simulation at tick
+// boundaries, so game state never changes from inside an event callback and auto-repeat
+// does not affect how fast anything moves.
+// It also measures input-to-photon latency: events that changed something are held until the
+// frame drawn after their tick has been presented, their age then goes into the FrameMonitor.
+class InputQueue {
+    public:
+        void Push(int key, bool pressed); // any thread
+        void Drain(std::vector<InputEvent>& out); // game thread, at the start of a tick
+
+        // the event changed simulation state in this tick
+        void MarkApplied(const InputEvent& event) { m_applied.push_back(event.micros); }
+        // the frame drawn after the last tick is on screen now
+        void MarkPresented();
+
+        static uint64_t NowMicros();
+    private:
+        std::mutex m_mutex;
+        std::vector<InputEvent> m_events;
+        std::vector<uint64_t> m_applied; // arrival times, waiting for their frame to be presented
+};
@@ -0,0 +1,107 @@
+#include "LayerCompositor.h"
+
+#include <algorithm>
+
+
+void LayerCompositor::AddStaticLayer(const std::string& name, Paint paint, int order) {
+    this->AddLayer(name, std::move(paint), order, true);
+}
+
+void LayerCompositor::AddDynamicLayer(const std::string& name, Paint paint, int order) {
+    this->AddLayer(name, std::move(paint), order, false);
+}
+
+void LayerCompositor::AddLayer(const std::string& name, Paint paint, int order, bool isStatic) {
+    Layer layer{name, std::move(paint), order, isStatic};
+    // insert after every layer with the same or a lower order
+    auto position = std::upper_bound(m_layers.begin(), m_layers.end(), order, [](int value, const Layer& other) {
+        return value < other.order;
+    });
+    m_layers.insert(position, std::move(layer));
+    m_runsChanged = true;
+}
+
+void LayerCompositor::Invalidate(const std::string& name) {
+    for (Run& run : m_runs) {
+        for (int i = run.first; i < run.last; ++i) {
+            if (m_layers[i].name == name) {
+                run.dirty = true;
+                return;
+            }
+        }
+    }
+}
+
+void LayerCompositor::InvalidateAll() {
+    for (Run& run : m_runs) {
+        run.dirty = true;
+    }
+}
+
+void LayerCompositor::Resize(int width, int height) {
+    m_width = width;
+    m_height = height;
+    this->InvalidateAll();
+}
+
+bool LayerCompositor::IsIdle() const {
+    for (const Layer& layer : m_layers) {
+        if (!layer.isStatic) return false;
+    }
+    for (const Run& run : m_runs) {
+        if (run.dirty) return false;
+    }
+    return !m_runsChanged;
+}
+
+void LayerCompositor::BuildRuns() {
+    m_runs.clear();
+    for (int i = 0; i < int(m_layers.size()); ++i) {
+        if (m_runs.empty() || m_runs.back().isStatic != m_layers[i].isStatic) {
+            Run run;
+            run.first = i;
+            run.isStatic = m_layers[i].isStatic;
+            m_runs.push_back(std::move(run));
+        }
+        m_runs.back().last = i + 1;
+    }
+    m_runsChanged = false;
+}
+
+void LayerCompositor::Repaint(Run& run) {
+    int width = m_width > 0 ? m_width : ofGetWindowWidth();
+    int height = m_height > 0 ? m_height : ofGetWindowHeight();
+    if (!run.cache) {
+        run.cache = std::make_unique<ofFbo>();
+    }
+    if (!run.cache->isAllocated() || run.cache->getWidth() != width || run.cache->getHeight() != height) {
+        run.cache->allocate(width, height, GL_RGBA);
+    }
+    run.cache->begin();
+    ofClear(0, 0, 0, 0);
+    for (int i = run.first; i < run.last; ++i) {
+        m_layers[i].paint();
+    }
+    run.cache->end();
+    run.dirty = false;
+    m_repaints += 1;
+}
+
+void LayerCompositor::Draw() {
+    if (m_runsChanged) {
+        this->BuildRuns();
+    }
+    for (Run& run : m_runs) {
+        if (!run.isStatic) {
+            for (int i = run.first; i < run.last; ++i) {
+                m_layers[i].paint();
+            }
+            continue;
+        }
+        if (run.dirty) {
+            this->Repaint(run);
+        }
+        ofSetColor(ofColor::white);
+        run.cache->draw(0, 0);
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ofMain.h"
+
+// Scenes describe their frame as ordered layers. Static layers are painted once into an FBO and
+// only painted again after a resize or an Invalidate, dynamic layers are painted every frame.
+// Neighboring static layers share one FBO, so a scene made only of static layers presents its
+// whole frame with a single blit.
+class LayerCompositor {
+    public:
+        using Paint = std::function<void()>;
+
+        // lower order is drawn first, layers with the same order keep the order they were added in
+        void AddStaticLayer(const std::string& name, Paint paint, int order = 0);
+        void AddDynamicLayer(const std::string& name, Paint paint, int order = 0);
+        void Invalidate(const std::string& name); // the content of a static layer changed
+        void InvalidateAll();
+        void Resize(int width, int height);
+
+        void Draw();
+        // nothing to paint but cached frames, the app can slow down while a scene is idle
+        bool IsIdle() const;
+        int GetRepaintCount() const { return m_repaints; }
+    private:
+        struct Layer {
+            std::string name;
+            Paint paint;
+            int order;
+            bool isStatic;
+        };
+        // consecutive layers of the same kind
+        struct Run {
+            int first;
+            int last; // one past
+            bool isStatic;
+            bool dirty = true;
+            std::unique_ptr<ofFbo> cache;
+        };
+        void AddLayer(const std::string& name, Paint paint, int order, bool isStatic);
+        void BuildRuns();
+        void Repaint(Run& run);
+
+        std::vector<Layer> m_layers;
+        std::vector<Run> m_runs;
+        bool m_runsChanged = true;
+        int m_width = 0; // 0 follows the window
+        int m_height = 0;
+        int m_repaints = 0;
+};
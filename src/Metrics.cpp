@@ -0,0 +1,213 @@
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include "FrameStats.h"
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+
+// RuntimeMetrics Implementation
+RuntimeMetrics& RuntimeMetrics::Get() {
+    static RuntimeMetrics instance;
+    return instance;
+}
+
+void RuntimeMetrics::SetCreatureTypeNames(const std::vector<std::string>& names) {
+    m_typeNames.assign(names.begin(), names.begin() + std::min<size_t>(names.size(), kMaxCreatureTypes));
+}
+
+void RuntimeMetrics::RecordTick(uint64_t tickMicros) {
+    m_tickMicros.store(tickMicros, std::memory_order_relaxed);
+    m_ticks.store(m_ticks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); // only this thread writes
+}
+
+void RuntimeMetrics::SetCreatureCount(int type, int count) {
+    if (type < 0 || type >= kMaxCreatureTypes) return;
+    m_creatures[type].store(count, std::memory_order_relaxed);
+}
+
+void RuntimeMetrics::SetPopulation(int active, int dormant) {
+    m_active.store(active, std::memory_order_relaxed);
+    m_dormant.store(dormant, std::memory_order_relaxed);
+}
+
+void RuntimeMetrics::EndFrame(const FrameMonitor& monitor) {
+    uint64_t allocations = GetThreadAllocationCount(); // EndFrame runs on the game thread, scrapes don't count
+    m_allocationsPerFrame.store(allocations - m_lastAllocations, std::memory_order_relaxed);
+    m_lastAllocations = allocations;
+
+    uint64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    if (m_windowStart == 0) {
+        m_windowStart = now;
+    }
+    if (now - m_windowStart < kSummaryMicros) return;
+    const FrameTimeHistogram& frames = monitor.GetHistogram();
+    m_frameP50.store(frames.Percentile(50), std::memory_order_relaxed);
+    m_frameP95.store(frames.Percentile(95), std::memory_order_relaxed);
+    m_frameP99.store(frames.Percentile(99), std::memory_order_relaxed);
+    m_frameMax.store(frames.GetMax(), std::memory_order_relaxed);
+    m_frameSum.store(uint64_t(frames.GetMean() * frames.GetCount()), std::memory_order_relaxed);
+    m_frames.store(frames.GetCount(), std::memory_order_relaxed);
+    m_hitches.store(monitor.GetHitchCount(), std::memory_order_relaxed);
+    uint64_t collisions = m_collisions.load(std::memory_order_relaxed);
+    // a new game scene starts counting from zero again
+    uint64_t recent = collisions >= m_windowCollisions ? collisions - m_windowCollisions : collisions;
+    m_collisionsPerSecond.store(recent * 1e6 / double(now - m_windowStart), std::memory_order_relaxed);
+    m_windowCollisions = collisions;
+    m_windowStart = now;
+}
+
+std::string RuntimeMetrics::Render() const {
+    std::ostringstream out;
+    auto seconds = [](const std::atomic<uint64_t>& micros) { return micros.load(std::memory_order_relaxed) / 1e6; };
+    auto header = [&out](const char* name, const char* type, const char* help) {
+        out << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+    };
+
+    header("aquarium_frame_time_seconds", "summary", "Frame to frame time since start, refreshed every second.");
+    out << "aquarium_frame_time_seconds{quantile=\"0.5\"} " << seconds(m_frameP50) << "\n";
+    out << "aquarium_frame_time_seconds{quantile=\"0.95\"} " << seconds(m_frameP95) << "\n";
+    out << "aquarium_frame_time_seconds{quantile=\"0.99\"} " << seconds(m_frameP99) << "\n";
+    out << "aquarium_frame_time_seconds_sum " << seconds(m_frameSum) << "\n";
+    out << "aquarium_frame_time_seconds_count " << m_frames.load(std::memory_order_relaxed) << "\n";
+    header("aquarium_frame_time_max_seconds", "gauge", "Slowest frame since start.");
+    out << "aquarium_frame_time_max_seconds " << seconds(m_frameMax) << "\n";
+    header("aquarium_hitches_total", "counter", "Frames over the hitch threshold.");
+    out << "aquarium_hitches_total " << m_hitches.load(std::memory_order_relaxed) << "\n";
+
+    header("aquarium_tick_seconds", "gauge", "Time the last simulation tick took.");
+    out << "aquarium_tick_seconds " << seconds(m_tickMicros) << "\n";
+    header("aquarium_ticks_total", "counter", "Simulation ticks run.");
+    out << "aquarium_ticks_total " << m_ticks.load(std::memory_order_relaxed) << "\n";
+
+    header("aquarium_creatures", "gauge", "Creatures alive in the current level by type, dormant ones included.");
+    for (size_t t = 0; t < m_typeNames.size(); ++t) {
+        out << "aquarium_creatures{type=\"" << m_typeNames[t] << "\"} " << m_creatures[t].load(std::memory_order_relaxed) << "\n";
+    }
+    header("aquarium_creatures_active", "gauge", "Creatures simulated in the chunks around the camera.");
+    out << "aquarium_creatures_active " << m_active.load(std::memory_order_relaxed) << "\n";
+    header("aquarium_creatures_dormant", "gauge", "Creatures kept as counts in sleeping chunks.");
+    out << "aquarium_creatures_dormant " << m_dormant.load(std::memory_order_relaxed) << "\n";
+    header("aquarium_level", "gauge", "Current level, counting from 0.");
+    out << "aquarium_level " << m_level.load(std::memory_order_relaxed) << "\n";
+
+    header("aquarium_collisions_total", "counter", "Player collisions resolved.");
+    out << "aquarium_collisions_total " << m_collisions.load(std::memory_order_relaxed) << "\n";
+    header("aquarium_collisions_per_second", "gauge", "Player collisions over the last second.");
+    out << "aquarium_collisions_per_second " << m_collisionsPerSecond.load(std::memory_order_relaxed) << "\n";
+
+    header("aquarium_allocations_per_frame", "gauge", "Heap allocations of the game thread during the last frame.");
+    out << "aquarium_allocations_per_frame " << m_allocationsPerFrame.load(std::memory_order_relaxed) << "\n";
+    header("aquarium_allocations_total", "counter", "Heap allocations of the whole process since start.");
+    out << "aquarium_allocations_total " << GetAllocationCount() << "\n";
+    header("aquarium_asset_bytes", "gauge", "Pixel memory of the loaded sprites.");
+    out << "aquarium_asset_bytes " << GetAssetBytes() << "\n";
+    return out.str();
+}
+
+
+// MetricsServer Implementation
+#ifdef _WIN32
+bool MetricsServer::Start(int port) {
+    m_error = "the metrics endpoint needs POSIX sockets";
+    return false;
+}
+
+void MetricsServer::Stop() {}
+void MetricsServer::Serve() {}
+void MetricsServer::Answer(int client) {}
+#else
+bool MetricsServer::Start(int port) {
+    if (this->IsRunning()) return true;
+    m_socket = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (m_socket < 0) {
+        m_error = std::string("socket: ") + std::strerror(errno);
+        return false;
+    }
+    int reuse = 1;
+    ::setsockopt(m_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(uint16_t(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // never reachable from the network
+    if (::bind(m_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(m_socket, 8) != 0) {
+        m_error = "port " + std::to_string(port) + ": " + std::strerror(errno);
+        ::close(m_socket);
+        m_socket = -1;
+        return false;
+    }
+    m_running.store(true, std::memory_order_relaxed);
+    m_thread = std::thread([this]() { this->Serve(); });
+    return true;
+}
+
+void MetricsServer::Stop() {
+    if (!m_thread.joinable()) return;
+    m_running.store(false, std::memory_order_relaxed);
+    m_thread.join(); // it notices within one poll timeout
+    ::close(m_socket);
+    m_socket = -1;
+}
+
+void MetricsServer::Serve() {
+    while (m_running.load(std::memory_order_relaxed)) {
+        pollfd listening{m_socket, POLLIN, 0};
+        if (::poll(&listening, 1, 200) <= 0) continue;
+        int client = ::accept(m_socket, nullptr, nullptr);
+        if (client < 0) continue;
+        this->Answer(client);
+        ::close(client);
+    }
+}
+
+// one request per connection, anything but GET /metrics (or /) is a 404
+void MetricsServer::Answer(int client) {
+    timeval timeout{1, 0}; // a client that never finishes its request can't hold the thread
+    ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+    int noSigpipe = 1;
+    ::setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &noSigpipe, sizeof(noSigpipe));
+#endif
+    std::string request;
+    char chunk[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        ssize_t got = ::recv(client, chunk, sizeof(chunk), 0);
+        if (got <= 0) break;
+        request.append(chunk, size_t(got));
+    }
+
+    std::string status = "404 Not Found";
+    std::string body = "try /metrics\n";
+    std::string contentType = "text/plain";
+    if (request.rfind("GET /metrics ", 0) == 0 || request.rfind("GET / ", 0) == 0) {
+        status = "200 OK";
+        body = RuntimeMetrics::Get().Render();
+        contentType = "text/plain; version=0.0.4; charset=utf-8";
+        m_scrapes.fetch_add(1, std::memory_order_relaxed);
+    }
+    std::string response = "HTTP/1.1 " + status + "\r\nContent-Type: " + contentType
+        + "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+
+#ifdef MSG_NOSIGNAL
+    int flags = MSG_NOSIGNAL; // a scraper hanging up early must not kill the game
+#else
+    int flags = 0;
+#endif
+    for (size_t sent = 0; sent < response.size(); ) {
+        ssize_t wrote = ::send(client, response.data() + sent, response.size() - sent, flags);
+        if (wrote <= 0) break;
+        sent += size_t(wrote);
+    }
+}
+#endif
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+class FrameMonitor;
+
+// Live counters for the metrics endpoint. The game thread stores plain values with relaxed
+// atomics once per frame and the server thread only loads them, so a scrape never waits on
+// the game and never touches game state.
+class RuntimeMetrics {
+    public:
+        static RuntimeMetrics& Get();
+
+        // set up before the server starts, label values of the per type gauges
+        void SetCreatureTypeNames(const std::vector<std::string>& names);
+
+        // game thread, once per tank tick
+        void RecordTick(uint64_t tickMicros);
+        // game thread, once per frame
+        void SetCollisionCount(uint64_t total) { m_collisions.store(total, std::memory_order_relaxed); }
+        void SetCreatureCount(int type, int count);
+        void SetPopulation(int active, int dormant);
+        void SetLevel(int level) { m_level.store(level, std::memory_order_relaxed); }
+        // closes the frame, game thread only: its allocation delta, and about once a second the frame time summary
+        // and the collision rate, percentiles walk the whole histogram
+        void EndFrame(const FrameMonitor& monitor);
+
+        // Prometheus text exposition format 0.0.4, safe from any thread
+        std::string Render() const;
+
+        static constexpr int kMaxCreatureTypes = 32; // as many as the game can have
+        static constexpr uint64_t kSummaryMicros = 1000000;
+    private:
+        RuntimeMetrics() = default;
+
+        std::vector<std::string> m_typeNames; // fixed once the server runs
+        std::array<std::atomic<int>, kMaxCreatureTypes> m_creatures{};
+        std::atomic<int> m_active{0};
+        std::atomic<int> m_dormant{0};
+        std::atomic<int> m_level{0};
+        std::atomic<uint64_t> m_ticks{0};
+        std::atomic<uint64_t> m_tickMicros{0};
+        std::atomic<uint64_t> m_collisions{0};
+        std::atomic<double> m_collisionsPerSecond{0};
+        std::atomic<uint64_t> m_allocationsPerFrame{0};
+        std::atomic<uint64_t> m_frames{0};
+        std::atomic<uint64_t> m_frameP50{0};
+        std::atomic<uint64_t> m_frameP95{0};
+        std::atomic<uint64_t> m_frameP99{0};
+        std::atomic<uint64_t> m_frameMax{0};
+        std::atomic<uint64_t> m_frameSum{0};
+        std::atomic<uint64_t> m_hitches{0};
+
+        // game thread only
+        uint64_t m_lastAllocations = 0;
+        uint64_t m_windowStart = 0;
+        uint64_t m_windowCollisions = 0; // collision count when the window started
+};
+
+// Serves RuntimeMetrics::Render() on http://127.0.0.1:<port>/metrics from its own thread.
+// Loopback only, one short request at a time, which is all a scraper or curl needs.
+class MetricsServer {
+    public:
+        MetricsServer() = default;
+        ~MetricsServer() { this->Stop(); }
+        MetricsServer(const MetricsServer&) = delete;
+        MetricsServer& operator=(const MetricsServer&) = delete;
+
+        bool Start(int port);
+        void Stop();
+        bool IsRunning() const { return m_running.load(std::memory_order_relaxed); }
+        uint64_t GetScrapes() const { return m_scrapes.load(std::memory_order_relaxed); }
+        const std::string& GetLastError() const { return m_error; }
+    private:
+        void Serve();
+        void Answer(int client);
+
+        std::thread m_thread;
+        std::atomic<bool> m_running{false};
+        std::atomic<uint64_t> m_scrapes{0};
+        int m_socket = -1;
+        std::string m_error;
+};
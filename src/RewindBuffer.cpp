@@ -0,0 +1,336 @@
+#include "RewindBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+// varint encoding
+namespace {
+    void PutVarint(std::vector<uint8_t>& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(uint8_t(value) | 0x80);
+            value >>= 7;
+        }
+        out.push_back(uint8_t(value));
+    }
+
+    void PutSigned(std::vector<uint8_t>& out, int64_t value) {
+        PutVarint(out, (uint64_t(value) << 1) ^ uint64_t(value >> 63)); // zigzag
+    }
+
+    class Reader {
+        public:
+            explicit Reader(const std::vector<uint8_t>& bytes) : m_at(bytes.data()), m_end(bytes.data() + bytes.size()) {}
+            uint64_t Varint() {
+                uint64_t value = 0;
+                for (int shift = 0; m_at < m_end && shift < 64; shift += 7) {
+                    uint8_t byte = *m_at++;
+                    value |= uint64_t(byte & 0x7F) << shift;
+                    if (!(byte & 0x80)) return value;
+                }
+                m_failed = true;
+                return 0;
+            }
+            int64_t Signed() {
+                uint64_t value = this->Varint();
+                return int64_t(value >> 1) ^ -int64_t(value & 1);
+            }
+            bool Ok() const { return !m_failed; }
+        private:
+            const uint8_t* m_at;
+            const uint8_t* m_end;
+            bool m_failed = false;
+    };
+
+    int32_t QuantizePosition(float v) { return int32_t(std::lround(v * RewindBuffer::kPositionScale)); }
+    int32_t QuantizeDirection(float v) { return int32_t(std::lround(v * RewindBuffer::kDirectionScale)); }
+
+    enum CreatureField : uint8_t { kFieldX = 1, kFieldY = 2, kFieldDx = 4, kFieldDy = 8, kFieldSpeed = 16, kFieldType = 32 };
+}
+
+
+// RewindBuffer Implementation
+void RewindBuffer::Quantize(const WorldSnapshot& in, State& out) {
+    out.level = in.level;
+    out.levelScore = in.levelScore;
+    out.population.assign(in.population.begin(), in.population.end());
+    out.creatures.resize(in.creatures.size());
+    for (size_t i = 0; i < in.creatures.size(); ++i) {
+        const CreatureSnapshot& c = in.creatures[i];
+        out.creatures[i] = Creature{c.id, c.type, QuantizePosition(c.x), QuantizePosition(c.y),
+                                    QuantizeDirection(c.dx), QuantizeDirection(c.dy), c.speed, 0, 0};
+    }
+    out.players.resize(in.players.size());
+    for (size_t i = 0; i < in.players.size(); ++i) {
+        const PlayerSnapshot& p = in.players[i];
+        out.players[i] = Player{{QuantizePosition(p.x), QuantizePosition(p.y), QuantizeDirection(p.dx), QuantizeDirection(p.dy),
+                                 p.score, p.lives, p.power, p.debounce}};
+    }
+}
+
+void RewindBuffer::Dequantize(const State& in, uint64_t tick, WorldSnapshot& out) {
+    out.tick = tick;
+    out.level = in.level;
+    out.levelScore = in.levelScore;
+    out.population.assign(in.population.begin(), in.population.end());
+    out.creatures.resize(in.creatures.size());
+    for (size_t i = 0; i < in.creatures.size(); ++i) {
+        const Creature& c = in.creatures[i];
+        out.creatures[i] = CreatureSnapshot{c.id, c.type, c.x / kPositionScale, c.y / kPositionScale,
+                                            c.dx / kDirectionScale, c.dy / kDirectionScale, c.speed};
+    }
+    out.players.resize(in.players.size());
+    for (size_t i = 0; i < in.players.size(); ++i) {
+        const int32_t* f = in.players[i].fields;
+        out.players[i] = PlayerSnapshot{f[0] / kPositionScale, f[1] / kPositionScale, f[2] / kDirectionScale, f[3] / kDirectionScale,
+                                        f[4], f[5], f[6], f[7]};
+    }
+}
+
+void RewindBuffer::EncodeKeyframe(const State& state, std::vector<uint8_t>& out) {
+    PutSigned(out, state.level);
+    PutSigned(out, state.levelScore);
+    PutVarint(out, state.population.size());
+    for (int32_t count : state.population) PutSigned(out, count);
+    PutVarint(out, state.creatures.size());
+    uint32_t lastId = 0;
+    for (const Creature& c : state.creatures) {
+        PutVarint(out, c.id - lastId); // ids only grow, the gaps are small
+        lastId = c.id;
+        out.push_back(c.type);
+        PutSigned(out, c.x);
+        PutSigned(out, c.y);
+        PutSigned(out, c.dx);
+        PutSigned(out, c.dy);
+        PutSigned(out, c.speed);
+    }
+    PutVarint(out, state.players.size());
+    for (const Player& p : state.players) {
+        for (int32_t field : p.fields) PutSigned(out, field);
+    }
+}
+
+bool RewindBuffer::DecodeKeyframe(const std::vector<uint8_t>& in, State& out) {
+    Reader r(in);
+    out.level = int32_t(r.Signed());
+    out.levelScore = int32_t(r.Signed());
+    out.population.resize(r.Varint());
+    for (int32_t& count : out.population) count = int32_t(r.Signed());
+    out.creatures.resize(r.Varint());
+    uint32_t lastId = 0;
+    for (Creature& c : out.creatures) {
+        c.id = lastId + uint32_t(r.Varint());
+        lastId = c.id;
+        c.type = uint8_t(r.Varint()); // below 0x80, so the raw byte reads as a varint
+        c.x = int32_t(r.Signed());
+        c.y = int32_t(r.Signed());
+        c.dx = int32_t(r.Signed());
+        c.dy = int32_t(r.Signed());
+        c.speed = int32_t(r.Signed());
+        c.stepX = 0;
+        c.stepY = 0;
+    }
+    out.players.resize(r.Varint());
+    for (Player& p : out.players) {
+        for (int32_t& field : p.fields) field = int32_t(r.Signed());
+    }
+    return r.Ok();
+}
+
+// layout: level fields as differences, removed ids, changed or added creatures (id gap, field
+// mask, then the differences of the masked fields; a new creature differs from all zeros),
+// and the players the same way
+// after is updated with the steps the decoder will track, so the next delta predicts the same way
+void RewindBuffer::EncodeDelta(const State& before, State& after, std::vector<uint8_t>& out) {
+    PutSigned(out, int64_t(after.level) - before.level);
+    PutSigned(out, int64_t(after.levelScore) - before.levelScore);
+    PutVarint(out, after.population.size());
+    for (size_t t = 0; t < after.population.size(); ++t) {
+        PutSigned(out, int64_t(after.population[t]) - (t < before.population.size() ? before.population[t] : 0));
+    }
+
+    // both lists are sorted by id, one merge walk finds removals, changes and spawns
+    std::vector<uint8_t> removed;
+    std::vector<uint8_t> changed;
+    uint32_t removedCount = 0, changedCount = 0, lastRemoved = 0, lastChanged = 0;
+    size_t i = 0, j = 0;
+    static const Creature kEmpty{0, 0, 0, 0, 0, 0, 0, 0, 0};
+    while (i < before.creatures.size() || j < after.creatures.size()) {
+        const Creature* old = i < before.creatures.size() ? &before.creatures[i] : nullptr;
+        Creature* now = j < after.creatures.size() ? &after.creatures[j] : nullptr;
+        if (old && (!now || old->id < now->id)) {
+            PutVarint(removed, old->id - lastRemoved);
+            lastRemoved = old->id;
+            removedCount += 1;
+            ++i;
+            continue;
+        }
+        const Creature& base = (old && old->id == now->id) ? *old : kEmpty;
+        if (old && old->id == now->id) ++i;
+        ++j;
+        now->stepX = base.stepX;
+        now->stepY = base.stepY;
+        uint8_t mask = (now->x != base.x ? kFieldX : 0) | (now->y != base.y ? kFieldY : 0)
+                     | (now->dx != base.dx ? kFieldDx : 0) | (now->dy != base.dy ? kFieldDy : 0)
+                     | (now->speed != base.speed ? kFieldSpeed : 0) | (&base == &kEmpty ? kFieldType : 0);
+        if (mask == 0) continue;
+        PutVarint(changed, now->id - lastChanged);
+        lastChanged = now->id;
+        changed.push_back(mask);
+        if (mask & kFieldType) changed.push_back(now->type);
+        if (mask & kFieldX) {
+            now->stepX = now->x - base.x;
+            PutSigned(changed, int64_t(now->stepX) - base.stepX);
+        }
+        if (mask & kFieldY) {
+            now->stepY = now->y - base.y;
+            PutSigned(changed, int64_t(now->stepY) - base.stepY);
+        }
+        if (mask & kFieldDx) PutSigned(changed, int64_t(now->dx) - base.dx);
+        if (mask & kFieldDy) PutSigned(changed, int64_t(now->dy) - base.dy);
+        if (mask & kFieldSpeed) PutSigned(changed, int64_t(now->speed) - base.speed);
+        changedCount += 1;
+    }
+    PutVarint(out, removedCount);
+    out.insert(out.end(), removed.begin(), removed.end());
+    PutVarint(out, changedCount);
+    out.insert(out.end(), changed.begin(), changed.end());
+
+    PutVarint(out, after.players.size());
+    for (size_t p = 0; p < after.players.size(); ++p) {
+        for (int f = 0; f < 8; ++f) {
+            int32_t previous = p < before.players.size() ? before.players[p].fields[f] : 0;
+            PutSigned(out, int64_t(after.players[p].fields[f]) - previous);
+        }
+    }
+}
+
+bool RewindBuffer::DecodeDelta(const std::vector<uint8_t>& in, State& state, State& scratch) {
+    Reader r(in);
+    state.level += int32_t(r.Signed());
+    state.levelScore += int32_t(r.Signed());
+    state.population.resize(r.Varint(), 0);
+    for (int32_t& count : state.population) count += int32_t(r.Signed());
+
+    // removals first, then the merge of the survivors with the changed and new creatures
+    uint64_t removedCount = r.Varint();
+    scratch.creatures.clear();
+    size_t i = 0;
+    uint32_t id = 0;
+    for (uint64_t k = 0; k < removedCount && r.Ok(); ++k) {
+        id += uint32_t(r.Varint());
+        while (i < state.creatures.size() && state.creatures[i].id < id) scratch.creatures.push_back(state.creatures[i++]);
+        if (i < state.creatures.size() && state.creatures[i].id == id) ++i;
+    }
+    while (i < state.creatures.size()) scratch.creatures.push_back(state.creatures[i++]);
+
+    uint64_t changedCount = r.Varint();
+    state.creatures.clear();
+    i = 0;
+    id = 0;
+    for (uint64_t k = 0; k < changedCount && r.Ok(); ++k) {
+        id += uint32_t(r.Varint());
+        while (i < scratch.creatures.size() && scratch.creatures[i].id < id) state.creatures.push_back(scratch.creatures[i++]);
+        Creature c{id, 0, 0, 0, 0, 0, 0, 0, 0};
+        if (i < scratch.creatures.size() && scratch.creatures[i].id == id) c = scratch.creatures[i++];
+        uint8_t mask = uint8_t(r.Varint());
+        if (mask & kFieldType) c.type = uint8_t(r.Varint());
+        if (mask & kFieldX) {
+            c.stepX += int32_t(r.Signed());
+            c.x += c.stepX;
+        }
+        if (mask & kFieldY) {
+            c.stepY += int32_t(r.Signed());
+            c.y += c.stepY;
+        }
+        if (mask & kFieldDx) c.dx += int32_t(r.Signed());
+        if (mask & kFieldDy) c.dy += int32_t(r.Signed());
+        if (mask & kFieldSpeed) c.speed += int32_t(r.Signed());
+        state.creatures.push_back(c);
+    }
+    while (i < scratch.creatures.size()) state.creatures.push_back(scratch.creatures[i++]);
+
+    size_t players = r.Varint();
+    state.players.resize(players, Player{});
+    for (Player& p : state.players) {
+        for (int32_t& field : p.fields) field += int32_t(r.Signed());
+    }
+    return r.Ok();
+}
+
+void RewindBuffer::Record(const WorldSnapshot& state) {
+    if (!m_records.empty() && state.tick != m_records.back().tick + 1) {
+        this->Truncate(state.tick - 1); // went back in time or skipped ticks
+        if (!m_records.empty() && state.tick != m_records.back().tick + 1) this->Clear();
+    }
+    Quantize(state, m_current);
+
+    TickRecord record;
+    record.tick = state.tick;
+    record.keyframe = m_forceKeyframe || m_records.empty() || state.tick - m_keyframes.back() >= uint64_t(m_keyframeInterval);
+    std::vector<std::vector<uint8_t>>& spare = record.keyframe ? m_spareKeyframes : m_spareDeltas;
+    if (!spare.empty()) {
+        record.bytes = std::move(spare.back());
+        spare.pop_back();
+        record.bytes.clear();
+    }
+    if (record.keyframe) {
+        EncodeKeyframe(m_current, record.bytes);
+        m_keyframes.push_back(state.tick);
+        m_forceKeyframe = false;
+    } else {
+        EncodeDelta(m_last, m_current, record.bytes);
+    }
+    m_bytes += record.bytes.size();
+    m_records.push_back(std::move(record));
+    std::swap(m_last, m_current);
+    this->Trim();
+}
+
+// whole keyframe groups go, and only while the rest still covers the history
+void RewindBuffer::Trim() {
+    while (m_keyframes.size() >= 2 && m_records.back().tick - m_keyframes[1] >= uint64_t(m_history)) {
+        uint64_t next = m_keyframes[1];
+        while (!m_records.empty() && m_records.front().tick < next) this->DropFront();
+        m_keyframes.pop_front();
+    }
+}
+
+void RewindBuffer::Recycle(TickRecord& record) {
+    m_bytes -= record.bytes.size();
+    (record.keyframe ? m_spareKeyframes : m_spareDeltas).push_back(std::move(record.bytes));
+}
+
+void RewindBuffer::DropFront() {
+    this->Recycle(m_records.front());
+    m_records.pop_front();
+}
+
+bool RewindBuffer::Seek(uint64_t tick, WorldSnapshot& out) {
+    if (m_records.empty() || tick < m_records.front().tick || tick > m_records.back().tick) return false;
+    auto keyframe = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), tick) - 1; // the first record is always one
+    size_t first = size_t(*keyframe - m_records.front().tick);
+    size_t last = size_t(tick - m_records.front().tick);
+    if (!DecodeKeyframe(m_records[first].bytes, m_decoded)) return false;
+    for (size_t i = first + 1; i <= last; ++i) {
+        if (!DecodeDelta(m_records[i].bytes, m_decoded, m_scratch)) return false;
+    }
+    Dequantize(m_decoded, tick, out);
+    return true;
+}
+
+void RewindBuffer::Truncate(uint64_t tick) {
+    if (m_records.empty() || tick >= m_records.back().tick) return;
+    while (!m_records.empty() && m_records.back().tick > tick) {
+        this->Recycle(m_records.back());
+        m_records.pop_back();
+    }
+    while (!m_keyframes.empty() && m_keyframes.back() > tick) m_keyframes.pop_back();
+    m_forceKeyframe = true; // m_last no longer matches the newest record
+}
+
+void RewindBuffer::Clear() {
+    while (!m_records.empty()) this->DropFront();
+    m_keyframes.clear();
+    m_forceKeyframe = true;
+}
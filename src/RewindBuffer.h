@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// what one tick of the aquarium looks like, as far as rewinding is concerned
+struct CreatureSnapshot {
+    uint32_t id; // stable for the life of the creature, snapshots are sorted by it
+    uint8_t type; // AquariumCreatureType
+    float x;
+    float y;
+    float dx;
+    float dy;
+    int speed;
+};
+
+struct PlayerSnapshot {
+    float x;
+    float y;
+    float dx;
+    float dy;
+    int score;
+    int lives;
+    int power;
+    int debounce;
+};
+
+struct WorldSnapshot {
+    uint64_t tick = 0;
+    int level = 0;
+    int levelScore = 0;
+    std::vector<int> population; // live count the level keeps, indexed by AquariumCreatureType
+    std::vector<CreatureSnapshot> creatures;
+    std::vector<PlayerSnapshot> players;
+};
+
+// Ring of the last history ticks of play. Every keyframeInterval ticks the whole world is
+// stored, the ticks in between only keep the fields that changed since the tick before.
+// Positions are quantized to 1/8 px and directions to 1/4096, and a move is stored as its
+// difference from the creature's previous move. Every number is a zigzag varint, so a creature
+// that did not move costs nothing and one swimming straight costs a couple of bytes.
+// Seeking decodes the closest keyframe before the tick plus the deltas up to it.
+class RewindBuffer {
+    public:
+        void SetHistory(int ticks) { m_history = std::max(1, ticks); }
+        void SetKeyframeInterval(int ticks) { m_keyframeInterval = std::max(1, ticks); }
+
+        // ticks are expected one after the other, anything else starts a new keyframe
+        void Record(const WorldSnapshot& state);
+        // false when the tick is no longer (or not yet) in the buffer
+        bool Seek(uint64_t tick, WorldSnapshot& out);
+        // forget everything after tick, recording carries on from there
+        void Truncate(uint64_t tick);
+        void Clear();
+
+        bool IsEmpty() const { return m_records.empty(); }
+        uint64_t GetOldestTick() const { return m_records.empty() ? 0 : m_records.front().tick; }
+        uint64_t GetNewestTick() const { return m_records.empty() ? 0 : m_records.back().tick; }
+        size_t GetMemoryBytes() const { return m_bytes; } // encoded bytes held
+
+        static constexpr float kPositionScale = 8.0f;
+        static constexpr float kDirectionScale = 4096.0f;
+    private:
+        // the quantized values, deltas are taken between these so rounding never drifts
+        struct Creature {
+            uint32_t id;
+            uint8_t type;
+            int32_t x;
+            int32_t y;
+            int32_t dx;
+            int32_t dy;
+            int32_t speed;
+            int32_t stepX; // how far it moved the last time it moved, the guess for the next move
+            int32_t stepY;
+        };
+        struct Player {
+            int32_t fields[8];
+        };
+        struct State {
+            int32_t level = 0;
+            int32_t levelScore = 0;
+            std::vector<int32_t> population;
+            std::vector<Creature> creatures;
+            std::vector<Player> players;
+        };
+        struct TickRecord {
+            uint64_t tick;
+            bool keyframe;
+            std::vector<uint8_t> bytes;
+        };
+
+        static void Quantize(const WorldSnapshot& in, State& out);
+        static void Dequantize(const State& in, uint64_t tick, WorldSnapshot& out);
+        static void EncodeKeyframe(const State& state, std::vector<uint8_t>& out);
+        static void EncodeDelta(const State& before, State& after, std::vector<uint8_t>& out);
+        static bool DecodeKeyframe(const std::vector<uint8_t>& in, State& out);
+        static bool DecodeDelta(const std::vector<uint8_t>& in, State& state, State& scratch);
+        void Trim();
+        void DropFront();
+
+        int m_history = 30 * 60;
+        int m_keyframeInterval = 120;
+        std::deque<TickRecord> m_records; // one per tick, oldest first and always starting with a keyframe
+        std::deque<uint64_t> m_keyframes; // ticks of the keyframes in m_records
+        // buffers of dropped records, reused; kept apart so a small delta never holds on to a keyframe's capacity
+        std::vector<std::vector<uint8_t>> m_spareKeyframes;
+        std::vector<std::vector<uint8_t>> m_spareDeltas;
+        void Recycle(TickRecord& record);
+        size_t m_bytes = 0;
+        bool m_forceKeyframe = true;
+        State m_last; // what the newest record decodes to
+        State m_current;
+        State m_decoded;
+        State m_scratch;
+};
@@ -0,0 +1,224 @@
+#include "Schooling.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+SchoolingSystem::~SchoolingSystem() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void SchoolingSystem::Clear() {
+    m_x.clear();
+    m_y.clear();
+    m_vx.clear();
+    m_vy.clear();
+    m_group.clear();
+}
+
+int SchoolingSystem::Add(float x, float y, float vx, float vy, int group) {
+    m_x.push_back(x);
+    m_y.push_back(y);
+    m_vx.push_back(vx);
+    m_vy.push_back(vy);
+    m_group.push_back(group);
+    return int(m_x.size()) - 1;
+}
+
+void SchoolingSystem::Step(float originX, float originY, float width, float height) {
+    int count = this->size();
+    m_outVx.resize(count);
+    m_outVy.resize(count);
+    if (count == 0) return;
+    m_grid.Build(m_x, m_y, originX, originY, width, height, m_params.neighborRadius);
+    // the steering reads neighbors in grid order, so they sit next to each other in memory
+    // instead of all over the arrays. Padded by kLanes, a block is always read in whole lanes
+    m_slotX.resize(count + kLanes);
+    m_slotY.resize(count + kLanes);
+    m_slotVx.resize(count + kLanes);
+    m_slotVy.resize(count + kLanes);
+    m_slotGroup.resize(count + kLanes);
+    for (int slot = 0; slot < count; ++slot) {
+        int i = m_grid.ItemAt(slot);
+        m_slotX[slot] = m_grid.SlotX(slot);
+        m_slotY[slot] = m_grid.SlotY(slot);
+        m_slotVx[slot] = m_vx[i];
+        m_slotVy[slot] = m_vy[i];
+        m_slotGroup[slot] = m_group[i];
+    }
+
+    int threads = count < kParallelThreshold ? 1 : std::min(m_threadCount, count / (kParallelThreshold / 2));
+    if (threads <= 1) {
+        this->SteerRange(0, count);
+        return;
+    }
+    // workers are only started once, the thread count can grow later but the pool never shrinks
+    while (int(m_workers.size()) < threads - 1) {
+        m_workers.emplace_back(&SchoolingSystem::WorkerLoop, this, int(m_workers.size()), m_generation); // joins from the next step on
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stepThreads = threads;
+        m_pending = threads - 1;
+        m_generation += 1;
+    }
+    m_wake.notify_all();
+    this->SteerSlice(threads - 1);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_finished.wait(lock, [this]() { return m_pending == 0; });
+}
+
+void SchoolingSystem::SteerSlice(int slice) {
+    int count = this->size();
+    int length = (count + m_stepThreads - 1) / m_stepThreads;
+    int begin = std::min(count, slice * length);
+    this->SteerRange(begin, std::min(count, begin + length));
+}
+
+void SchoolingSystem::WorkerLoop(int worker, uint64_t seen) {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&]() { return m_stopping || m_generation != seen; });
+            if (m_stopping) return;
+            seen = m_generation;
+            if (worker >= m_stepThreads - 1) continue; // a smaller step than the pool
+        }
+        this->SteerSlice(worker);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending -= 1;
+        }
+        m_finished.notify_one();
+    }
+}
+
+// a run of slots is cut into blocks of fish that share a cell
+void SchoolingSystem::SteerRange(int begin, int end) {
+    for (int first = begin; first < end; ) {
+        int cell = m_grid.CellOf(m_slotX[first], m_slotY[first]);
+        int last = std::min({end, m_grid.CellEnd(cell), first + kBlock});
+        this->SteerBlock(cell, first, last);
+        first = last;
+    }
+}
+
+// Every fish of the block meets the same candidates in the same order (its own cell, then the
+// cells around it), so the candidates are the outer loop and the fish the inner one: each
+// candidate is tested against all fish of the block at once, lane by lane over contiguous
+// arrays, which the compiler turns into SIMD. A fish keeps the first cap candidates within the
+// neighbor radius, itself included, exactly like a capped query of its own would.
+void SchoolingSystem::SteerBlock(int cell, int first, int last) {
+    const SchoolingParams& p = m_params;
+    float cap = float(std::clamp(p.maxNeighbors, 1, kMaxNeighbors) + 1); // the fish finds itself too
+    float radius2 = p.neighborRadius * p.neighborRadius;
+    float separation2 = p.separationRadius * p.separationRadius;
+    int count = last - first;
+    int lanes = (count + kLanes - 1) / kLanes * kLanes;
+    const float* fishX = m_slotX.data() + first;
+    const float* fishY = m_slotY.data() + first;
+    const int* fishGroup = m_slotGroup.data() + first;
+
+    // per fish of the block, the padding lanes start out full so they never take a neighbor
+    float found[kBlock], sepX[kBlock], sepY[kBlock], sumVx[kBlock], sumVy[kBlock], sumX[kBlock], sumY[kBlock], mates[kBlock];
+    for (int k = 0; k < lanes; ++k) {
+        found[k] = k < count ? 0.0f : cap;
+        sepX[k] = sepY[k] = sumVx[k] = sumVy[k] = sumX[k] = sumY[k] = mates[k] = 0.0f;
+    }
+
+    // the grid's cells are one neighbor radius wide, so the runs around the cell hold every candidate
+    int runFirst[SpatialGrid::kMaxRuns], runLast[SpatialGrid::kMaxRuns];
+    int runs = m_grid.RunsAround(cell, runFirst, runLast);
+    bool open = true; // some fish of the block still takes neighbors
+    for (int r = 0; r < runs && open; ++r) {
+        for (int j = runFirst[r]; j < runLast[r] && open; ++j) {
+            float jx = m_slotX[j], jy = m_slotY[j];
+            float jvx = m_slotVx[j], jvy = m_slotVy[j];
+            int jgroup = m_slotGroup[j];
+            int self = j - first; // lane of the candidate when it is in the block
+            for (int base = 0; base < lanes; base += kLanes) {
+                // the tests are turned into 0/1 weights, no lane branches
+                for (int k = base; k < base + kLanes; ++k) {
+                    float dx = fishX[k] - jx, dy = fishY[k] - jy;
+                    float d2 = dx * dx + dy * dy;
+                    float hit = (d2 < radius2) & (found[k] < cap) ? 1.0f : 0.0f;
+                    found[k] += hit;
+                    float other = k != self ? hit : 0.0f;
+                    float push = ((d2 < separation2) & (d2 > 0.0f) ? other : 0.0f) / std::max(d2, 1e-6f);
+                    sepX[k] += dx * push;
+                    sepY[k] += dy * push;
+                    float mate = fishGroup[k] == jgroup ? other : 0.0f;
+                    sumVx[k] += jvx * mate;
+                    sumVy[k] += jvy * mate;
+                    sumX[k] += jx * mate;
+                    sumY[k] += jy * mate;
+                    mates[k] += mate;
+                }
+            }
+            if ((j - runFirst[r]) % kCheckEvery == kCheckEvery - 1 || j + 1 == runLast[r]) {
+                open = false;
+                for (int k = 0; k < count; ++k) {
+                    open = open || found[k] < cap;
+                }
+            }
+        }
+    }
+
+    // the new headings, again lane by lane with selects, then written back in fish order
+    const float* fishVx = m_slotVx.data() + first;
+    const float* fishVy = m_slotVy.data() + first;
+    float threatX = m_threatX, threatY = m_threatY;
+    float fleeRadius = m_hasThreat ? p.fleeRadius : 0.0f; // no threat, nobody flees
+    float outX[kBlock], outY[kBlock];
+    for (int base = 0; base < lanes; base += kLanes) {
+        for (int k = base; k < base + kLanes; ++k) {
+            float x = fishX[k], y = fishY[k];
+            float vx = fishVx[k], vy = fishVy[k];
+            // separation is scaled to about one unit when a neighbor sits at half the separation radius
+            float steerX = sepX[k] * p.separationRadius * 0.5f * p.separationWeight;
+            float steerY = sepY[k] * p.separationRadius * 0.5f * p.separationWeight;
+            bool schooling = mates[k] > 0.5f;
+            float inv = 1.0f / std::max(mates[k], 1.0f);
+            float alignX = (sumVx[k] * inv - vx) * p.alignmentWeight;
+            float alignY = (sumVy[k] * inv - vy) * p.alignmentWeight;
+            float cohereX = (sumX[k] * inv - x) / p.neighborRadius * p.cohesionWeight;
+            float cohereY = (sumY[k] * inv - y) / p.neighborRadius * p.cohesionWeight;
+            steerX += schooling ? alignX : 0.0f;
+            steerY += schooling ? alignY : 0.0f;
+            steerX += schooling ? cohereX : 0.0f;
+            steerY += schooling ? cohereY : 0.0f;
+
+            float dx = x - threatX, dy = y - threatY;
+            float d2 = dx * dx + dy * dy;
+            bool fleeing = (d2 < fleeRadius * fleeRadius) & (d2 > 0.0f);
+            float d = std::max(std::sqrt(d2), 1e-6f);
+            float urgency = 1.0f - d / p.fleeRadius;
+            float fleeX = dx / d * urgency * p.fleeWeight;
+            float fleeY = dy / d * urgency * p.fleeWeight;
+            steerX += fleeing ? fleeX : 0.0f;
+            steerY += fleeing ? fleeY : 0.0f;
+
+            float nx = vx + steerX * p.turnRate;
+            float ny = vy + steerY * p.turnRate;
+            float length = std::sqrt(nx * nx + ny * ny);
+            bool turned = length > 1e-4f;
+            length = std::max(length, 1e-4f);
+            float turnedX = nx / length;
+            float turnedY = ny / length;
+            outX[k] = turned ? turnedX : vx;
+            outY[k] = turned ? turnedY : vy;
+        }
+    }
+    for (int k = 0; k < count; ++k) {
+        int i = m_grid.ItemAt(first + k);
+        m_outVx[i] = outX[k];
+        m_outVy[i] = outY[k];
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "SpatialGrid.h"
+
+struct SchoolingParams {
+    float neighborRadius = 120.0f; // alignment and cohesion only look this far
+    float separationRadius = 45.0f;
+    float fleeRadius = 250.0f; // distance at which fish start running from the threat
+    float separationWeight = 1.5f;
+    float alignmentWeight = 0.6f;
+    float cohesionWeight = 0.4f;
+    float fleeWeight = 2.5f;
+    float turnRate = 0.25f; // how much of the steering is applied per step
+    int maxNeighbors = 7; // at most kMaxNeighbors, starlings track about seven neighbors
+};
+
+// Boids (separation, alignment, cohesion) plus fleeing from one threat, the player.
+// Fish are kept as structure of arrays and neighbors come from a SpatialGrid with a fixed cap,
+// so a step is O(n * maxNeighbors). Every fish only writes its own heading, which lets the
+// step be split over threads and still give the same result on any number of them.
+// The threads are a pool kept for the life of the system, started the first time a step is big enough.
+class SchoolingSystem {
+    public:
+        SchoolingSystem() = default;
+        ~SchoolingSystem();
+        SchoolingSystem(const SchoolingSystem&) = delete;
+        SchoolingSystem& operator=(const SchoolingSystem&) = delete;
+
+        void Clear();
+        // group: fish only align and school with their own group, but keep apart from every fish
+        int Add(float x, float y, float vx, float vy, int group);
+        void SetThreat(float x, float y) { m_threatX = x; m_threatY = y; m_hasThreat = true; }
+
+        // computes the new heading of every fish added since Clear, the area is where they live
+        void Step(float originX, float originY, float width, float height);
+        // unit heading after Step, (0, 0) for a fish that had no heading and nothing pushing it
+        float GetVx(int index) const { return m_outVx[index]; }
+        float GetVy(int index) const { return m_outVy[index]; }
+        int size() const { return int(m_x.size()); }
+
+        SchoolingParams& Params() { return m_params; }
+        void setThreadCount(int threads) { m_threadCount = threads < 1 ? 1 : threads; }
+        int getThreadCount() const { return m_threadCount; }
+
+        static constexpr int kMaxNeighbors = 32;
+        static constexpr int kParallelThreshold = 4096; // below this threads cost more than they save
+        static constexpr int kLanes = 8; // fish steered side by side, a multiple of the SIMD widths
+        static constexpr int kBlock = 16; // fish of one cell steered together, a multiple of kLanes
+        static constexpr int kCheckEvery = 4; // candidates between checks whether every fish of a block is full
+    private:
+        void SteerRange(int begin, int end); // slots of the grid, not fish indices
+        void SteerBlock(int cell, int first, int last); // slots of fish sharing cell, at most kBlock
+        void SteerSlice(int slice); // slice of the current step, the caller takes the last one
+        void WorkerLoop(int worker, uint64_t seen);
+
+        SchoolingParams m_params;
+        SpatialGrid m_grid;
+        std::vector<float> m_x;
+        std::vector<float> m_y;
+        std::vector<float> m_vx;
+        std::vector<float> m_vy;
+        std::vector<int> m_group;
+        std::vector<float> m_slotX; // fish in grid order, so a cell is one contiguous run of each
+        std::vector<float> m_slotY;
+        std::vector<float> m_slotVx;
+        std::vector<float> m_slotVy;
+        std::vector<int> m_slotGroup;
+        std::vector<float> m_outVx;
+        std::vector<float> m_outVy;
+        float m_threatX = 0.0f;
+        float m_threatY = 0.0f;
+        bool m_hasThreat = false;
+        int m_threadCount = 1;
+
+        // worker pool, every step hands each of the first m_stepThreads - 1 workers one slice
+        std::vector<std::thread> m_workers;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_finished;
+        uint64_t m_generation = 0;
+        int m_stepThreads = 1;
+        int m_pending = 0;
+        bool m_stopping = false;
+};
@@ -0,0 +1,111 @@
+#include "Script.h"
+
+#include <new>
+
+
+// ScriptFramePool Implementation
+std::array<ScriptFramePool::FreeBlock*, ScriptFramePool::kClasses> ScriptFramePool::s_free{};
+std::vector<void*> ScriptFramePool::s_chunks;
+
+void* ScriptFramePool::Allocate(size_t size) {
+    size_t sizeClass = (size + kGranularity - 1) / kGranularity - 1;
+    if (sizeClass >= kClasses) {
+        return ::operator new(size);
+    }
+    if (s_free[sizeClass] == nullptr) {
+        // one chunk holds kFramesPerChunk frames of this class, threaded onto the free list
+        size_t blockSize = (sizeClass + 1) * kGranularity;
+        char* chunk = static_cast<char*>(::operator new(blockSize * kFramesPerChunk));
+        s_chunks.push_back(chunk);
+        for (size_t i = kFramesPerChunk; i-- > 0; ) {
+            FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + i * blockSize);
+            block->next = s_free[sizeClass];
+            s_free[sizeClass] = block;
+        }
+    }
+    FreeBlock* block = s_free[sizeClass];
+    s_free[sizeClass] = block->next;
+    return block;
+}
+
+void ScriptFramePool::Free(void* frame, size_t size) {
+    size_t sizeClass = (size + kGranularity - 1) / kGranularity - 1;
+    if (sizeClass >= kClasses) {
+        ::operator delete(frame);
+        return;
+    }
+    FreeBlock* block = static_cast<FreeBlock*>(frame);
+    block->next = s_free[sizeClass];
+    s_free[sizeClass] = block;
+}
+
+
+void Script::promise_type::unhandled_exception() {
+    ofLogError() << "Script stopped by an exception" << std::endl;
+}
+
+
+// ScriptScheduler Implementation
+void ScriptScheduler::Start(Script script) {
+    Script::Handle handle = script.m_handle;
+    script.m_handle = nullptr;
+    if (!handle) return;
+    handle.promise().scheduler = this;
+    handle.promise().liveIndex = int(m_live.size());
+    m_live.push_back(handle);
+    this->Resume(handle);
+}
+
+void ScriptScheduler::WaitFrames(Script::Handle handle, uint64_t frames) {
+    // the handle and this fit in std::function's small buffer, waiting allocates nothing
+    handle.promise().timer = TimingWheel::Frames().Schedule(frames, [this, handle]() {
+        handle.promise().timer = TimingWheel::TimerId{};
+        this->m_ready.push_back(handle);
+    });
+}
+
+void ScriptScheduler::WaitEvent(Script::Handle handle, GameEventType type) {
+    m_waiting[int(type)].push_back(handle);
+}
+
+void ScriptScheduler::Emit(GameEventType type) {
+    std::vector<Script::Handle>& waiting = m_waiting[int(type)];
+    m_ready.insert(m_ready.end(), waiting.begin(), waiting.end());
+    waiting.clear();
+}
+
+// scripts made ready while these run wait for the next Run(), so none can spin within a frame
+void ScriptScheduler::Run() {
+    m_running.swap(m_ready);
+    for (Script::Handle handle : m_running) {
+        this->Resume(handle);
+    }
+    m_running.clear();
+}
+
+void ScriptScheduler::Resume(Script::Handle handle) {
+    handle.resume();
+    if (handle.done()) {
+        this->Finish(handle);
+    }
+}
+
+void ScriptScheduler::Finish(Script::Handle handle) {
+    int index = handle.promise().liveIndex;
+    m_live[index] = m_live.back();
+    m_live[index].promise().liveIndex = index;
+    m_live.pop_back();
+    handle.destroy();
+}
+
+void ScriptScheduler::StopAll() {
+    for (Script::Handle handle : m_live) {
+        TimingWheel::Frames().Cancel(handle.promise().timer);
+        handle.destroy();
+    }
+    m_live.clear();
+    m_ready.clear();
+    for (std::vector<Script::Handle>& waiting : m_waiting) {
+        waiting.clear();
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Core.h"
+
+// Fixed size blocks for coroutine frames, carved out of larger chunks and recycled through
+// free lists, so starting and finishing scripts never goes to the general heap once warm.
+// Frames bigger than the largest class fall back to operator new. Game thread only.
+class ScriptFramePool {
+    public:
+        static void* Allocate(size_t size);
+        static void Free(void* frame, size_t size);
+
+        static constexpr size_t kGranularity = 64;
+        static constexpr size_t kClasses = 16; // frames up to 1 KB
+        static constexpr size_t kFramesPerChunk = 64;
+    private:
+        struct FreeBlock { FreeBlock* next; };
+        static std::array<FreeBlock*, kClasses> s_free;
+        static std::vector<void*> s_chunks; // never given back, the pool only grows to the peak
+};
+
+class ScriptScheduler;
+
+// Return type of a script coroutine. It starts suspended and does nothing until it is handed
+// to a ScriptScheduler, which then owns it:
+//
+//     Script Blink(Creature* fish) {
+//         for (;;) {
+//             co_await frames(30);
+//             ...
+//             co_await event(GameEventType::NEW_LEVEL);
+//         }
+//     }
+//     scheduler.Start(Blink(fish));
+class Script {
+    public:
+        struct promise_type {
+            static void* operator new(size_t size) { return ScriptFramePool::Allocate(size); }
+            static void operator delete(void* frame, size_t size) { ScriptFramePool::Free(frame, size); }
+
+            Script get_return_object() { return Script(std::coroutine_handle<promise_type>::from_promise(*this)); }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; } // the scheduler destroys it
+            void return_void() {}
+            void unhandled_exception();
+
+            ScriptScheduler* scheduler = nullptr;
+            int liveIndex = -1; // position in the scheduler's list of live scripts
+            TimingWheel::TimerId timer; // pending while it waits for frames
+        };
+        using Handle = std::coroutine_handle<promise_type>;
+
+        Script(Script&& other) noexcept : m_handle(other.m_handle) { other.m_handle = nullptr; }
+        Script(const Script&) = delete;
+        Script& operator=(const Script&) = delete;
+        ~Script() { if (m_handle) m_handle.destroy(); } // never started
+    private:
+        friend class ScriptScheduler;
+        explicit Script(Handle handle) : m_handle(handle) {}
+        Handle m_handle;
+};
+
+// Runs scripts. A waiting script costs nothing per frame: frame waits sit in the frame timing
+// wheel and event waits in a list per event type, both only put the script on the ready list
+// when it is due. Run() resumes what is ready, the owner calls it at a point where scripts
+// may touch the game.
+class ScriptScheduler {
+    public:
+        ScriptScheduler() = default;
+        ~ScriptScheduler() { this->StopAll(); }
+        ScriptScheduler(const ScriptScheduler&) = delete;
+        ScriptScheduler& operator=(const ScriptScheduler&) = delete;
+
+        void Start(Script script); // runs it up to its first co_await right away
+        void Emit(GameEventType type); // scripts waiting for it run on the next Run()
+        void Run();
+        void StopAll();
+
+        int GetLiveCount() const { return int(m_live.size()); }
+
+        // used by the awaiters
+        void WaitFrames(Script::Handle handle, uint64_t frames);
+        void WaitEvent(Script::Handle handle, GameEventType type);
+    private:
+        static constexpr int kEventTypes = int(GameEventType::NEW_LEVEL) + 1;
+        void Resume(Script::Handle handle);
+        void Finish(Script::Handle handle);
+
+        std::vector<Script::Handle> m_live;
+        std::vector<Script::Handle> m_ready;
+        std::vector<Script::Handle> m_running; // m_ready while Run() works through it
+        std::array<std::vector<Script::Handle>, kEventTypes> m_waiting;
+};
+
+// co_await frames(n): resumes n frames from now
+struct FramesAwaiter {
+    uint64_t count;
+    bool await_ready() const noexcept { return count == 0; }
+    void await_suspend(Script::Handle handle) { handle.promise().scheduler->WaitFrames(handle, count); }
+    void await_resume() const noexcept {}
+};
+inline FramesAwaiter frames(uint64_t count) { return FramesAwaiter{count}; }
+
+// co_await event(type): resumes after the next Emit(type)
+struct EventAwaiter {
+    GameEventType type;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(Script::Handle handle) { handle.promise().scheduler->WaitEvent(handle, type); }
+    void await_resume() const noexcept {}
+};
+inline EventAwaiter event(GameEventType type) { return EventAwaiter{type}; }
@@ -0,0 +1,34 @@
+#include "SpatialGrid.h"
+
+
+void SpatialGrid::Build(const std::vector<float>& xs, const std::vector<float>& ys,
+                        float originX, float originY, float width, float height, float cellSize) {
+    m_originX = originX;
+    m_originY = originY;
+    m_cellSize = std::max(1.0f, cellSize);
+    m_columns = std::max(1, int(std::ceil(width / m_cellSize)));
+    m_rows = std::max(1, int(std::ceil(height / m_cellSize)));
+    m_xs = xs;
+    m_ys = ys;
+
+    int count = int(std::min(xs.size(), ys.size()));
+    m_cellStart.assign(size_t(m_columns) * m_rows + 1, 0);
+    m_cellOf.resize(count);
+    for (int i = 0; i < count; ++i) {
+        m_cellOf[i] = this->CellY(ys[i]) * m_columns + this->CellX(xs[i]);
+        m_cellStart[m_cellOf[i] + 1] += 1;
+    }
+    for (size_t c = 1; c < m_cellStart.size(); ++c) {
+        m_cellStart[c] += m_cellStart[c - 1];
+    }
+    m_items.resize(count);
+    m_fill.assign(m_cellStart.begin(), m_cellStart.end() - 1);
+    m_sortedX.resize(count);
+    m_sortedY.resize(count);
+    for (int i = 0; i < count; ++i) {
+        int slot = m_fill[m_cellOf[i]]++;
+        m_items[slot] = i;
+        m_sortedX[slot] = xs[i];
+        m_sortedY[slot] = ys[i];
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Uniform grid over a rectangle of the world, rebuilt from scratch when the points move.
+// Points are bucketed with a counting sort so every cell is one contiguous run of indices
+// and a query only touches the cells overlapping it.
+class SpatialGrid {
+    public:
+        // xs/ys are the point positions, the index of a point is its position in them
+        void Build(const std::vector<float>& xs, const std::vector<float>& ys,
+                   float originX, float originY, float width, float height, float cellSize);
+
+        // calls visit(index) for every point inside [minX, maxX) x [minY, maxY)
+        template<class Visit>
+        void ForEachInRect(float minX, float minY, float maxX, float maxY, Visit&& visit) const {
+            if (m_cellStart.empty()) return;
+            int x0 = this->CellX(minX), x1 = this->CellX(maxX);
+            int y0 = this->CellY(minY), y1 = this->CellY(maxY);
+            for (int cy = y0; cy <= y1; ++cy) {
+                for (int cx = x0; cx <= x1; ++cx) {
+                    int cell = cy * m_columns + cx;
+                    for (int i = m_cellStart[cell]; i < m_cellStart[cell + 1]; ++i) {
+                        float x = m_sortedX[i], y = m_sortedY[i];
+                        if (x >= minX && x < maxX && y >= minY && y < maxY) visit(m_items[i]);
+                    }
+                }
+            }
+        }
+
+        // calls visit(index) for every point closer than radius to (x, y)
+        template<class Visit>
+        void ForEachNear(float x, float y, float radius, Visit&& visit) const {
+            float r2 = radius * radius;
+            this->ForEachInRect(x - radius, y - radius, x + radius, y + radius, [&](int index) {
+                float dx = m_xs[index] - x, dy = m_ys[index] - y;
+                if (dx * dx + dy * dy < r2) visit(index);
+            });
+        }
+
+        // the cell a point falls in, its points are the slots [CellBegin(cell), CellEnd(cell))
+        int CellOf(float x, float y) const { return this->CellY(y) * m_columns + this->CellX(x); }
+        int CellBegin(int cell) const { return m_cellStart[cell]; }
+        int CellEnd(int cell) const { return m_cellStart[cell + 1]; }
+
+        // the slots of cell and the cells around it as runs [first[r], last[r]), returns how many:
+        // the cell itself first, then row by row. The cells of a row sit next to each other in slot
+        // order, so a row is one run (two around the cell itself). Covers every point closer than
+        // one cell size to a point of cell
+        static constexpr int kMaxRuns = 5;
+        int RunsAround(int cell, int* first, int* last) const {
+            int cx = cell % m_columns, cy = cell / m_columns;
+            int x0 = std::max(0, cx - 1), x1 = std::min(m_columns - 1, cx + 1);
+            int runs = 0;
+            auto add = [&](int begin, int end) {
+                first[runs] = begin;
+                last[runs] = end;
+                runs += 1;
+            };
+            add(m_cellStart[cell], m_cellStart[cell + 1]);
+            for (int y = std::max(0, cy - 1); y <= std::min(m_rows - 1, cy + 1); ++y) {
+                int row = y * m_columns;
+                if (y != cy) {
+                    add(m_cellStart[row + x0], m_cellStart[row + x1 + 1]);
+                    continue;
+                }
+                add(m_cellStart[row + x0], m_cellStart[cell]); // empty when cell is on the left edge
+                add(m_cellStart[cell + 1], m_cellStart[row + x1 + 1]);
+            }
+            return runs;
+        }
+
+        // the points in cell order, walking them like this keeps neighboring queries in cache
+        int ItemAt(int slot) const { return m_items[slot]; }
+        float SlotX(int slot) const { return m_sortedX[slot]; }
+        float SlotY(int slot) const { return m_sortedY[slot]; }
+        int size() const { return int(m_items.size()); }
+        float getCellSize() const { return m_cellSize; }
+    private:
+        int CellX(float x) const { return std::clamp(int(std::floor((x - m_originX) / m_cellSize)), 0, m_columns - 1); }
+        int CellY(float y) const { return std::clamp(int(std::floor((y - m_originY) / m_cellSize)), 0, m_rows - 1); }
+
+        float m_originX = 0.0f;
+        float m_originY = 0.0f;
+        float m_cellSize = 1.0f;
+        int m_columns = 0;
+        int m_rows = 0;
+        std::vector<int> m_cellStart; // m_columns * m_rows + 1 offsets into m_items
+        std::vector<int> m_items; // point indices sorted by cell
+        std::vector<int> m_cellOf; // scratch, cell of every point
+        std::vector<int> m_fill; // scratch, next free slot of every cell
+        std::vector<float> m_xs;
+        std::vector<float> m_ys;
+        std::vector<float> m_sortedX; // positions in m_items order, so a cell is scanned front to back
+        std::vector<float> m_sortedY;
+};
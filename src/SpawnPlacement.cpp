@@ -0,0 +1,144 @@
+#include "SpawnPlacement.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+// Philox4x32 Implementation
+namespace {
+    constexpr uint32_t kPhiloxM0 = 0xD2511F53;
+    constexpr uint32_t kPhiloxM1 = 0xCD9E8D57;
+    constexpr uint32_t kPhiloxW0 = 0x9E3779B9;
+    constexpr uint32_t kPhiloxW1 = 0xBB67AE85;
+}
+
+Philox4x32::Philox4x32(uint64_t seed, uint64_t stream)
+: m_key{uint32_t(seed), uint32_t(seed >> 32)}, m_stream(stream) {}
+
+std::array<uint32_t, 4> Philox4x32::Block(uint64_t index) const {
+    std::array<uint32_t, 4> c = {uint32_t(index), uint32_t(index >> 32), uint32_t(m_stream), uint32_t(m_stream >> 32)};
+    std::array<uint32_t, 2> k = m_key;
+    for (int round = 0; round < 10; ++round) {
+        uint64_t p0 = uint64_t(kPhiloxM0) * c[0];
+        uint64_t p1 = uint64_t(kPhiloxM1) * c[2];
+        c = {uint32_t(p1 >> 32) ^ c[1] ^ k[0], uint32_t(p1), uint32_t(p0 >> 32) ^ c[3] ^ k[1], uint32_t(p0)};
+        k[0] += kPhiloxW0;
+        k[1] += kPhiloxW1;
+    }
+    return c;
+}
+
+uint32_t Philox4x32::Next() {
+    if (m_position / 4 != m_blockIndex) {
+        m_blockIndex = m_position / 4;
+        m_block = this->Block(m_blockIndex);
+    }
+    uint32_t value = m_block[m_position % 4];
+    m_position += 1;
+    return value;
+}
+
+float Philox4x32::NextFloat() {
+    return (this->Next() >> 8) * (1.0f / 16777216.0f); // 24 bits is all a float holds
+}
+
+int Philox4x32::NextInt(int lo, int hi) {
+    if (hi <= lo) return lo;
+    return lo + int(this->Next() % uint32_t(hi - lo + 1));
+}
+
+
+// PoissonDiskSampler Implementation
+PoissonDiskSampler::PoissonDiskSampler(float width, float height, float spacing)
+: m_width(std::max(1.0f, width)), m_height(std::max(1.0f, height)), m_spacing(std::max(1.0f, spacing)) {
+    // a cell no wider than spacing/sqrt(2) holds at most one point at full spacing
+    m_cellSize = m_spacing / std::sqrt(2.0f);
+    m_columns = std::max(1, int(std::ceil(m_width / m_cellSize)));
+    m_rows = std::max(1, int(std::ceil(m_height / m_cellSize)));
+    m_cellHead.assign(size_t(m_columns) * m_rows, -1);
+}
+
+float PoissonDiskSampler::FitSpacing(float width, float height, int total, float preferred) {
+    if (total <= 0) return preferred;
+    // dart throwing saturates well below perfect packing, leave it some room
+    float fit = 0.75f * std::sqrt(std::max(1.0f, width * height) / total);
+    return std::max(1.0f, std::min(preferred, fit));
+}
+
+int PoissonDiskSampler::CellOf(float x, float y) const {
+    int cx = std::clamp(int(x / m_cellSize), 0, m_columns - 1);
+    int cy = std::clamp(int(y / m_cellSize), 0, m_rows - 1);
+    return cy * m_columns + cx;
+}
+
+void PoissonDiskSampler::Insert(float x, float y) {
+    int cell = this->CellOf(x, y);
+    m_points.push_back(SpawnPoint{x, y});
+    m_next.push_back(m_cellHead[cell]);
+    m_cellHead[cell] = int(m_points.size()) - 1;
+}
+
+void PoissonDiskSampler::AddExisting(float x, float y) {
+    this->Insert(std::clamp(x, 0.0f, m_width - 1), std::clamp(y, 0.0f, m_height - 1));
+}
+
+void PoissonDiskSampler::AddExclusion(float x, float y, float radius) {
+    m_exclusions.push_back(Exclusion{x, y, radius});
+}
+
+bool PoissonDiskSampler::IsExcluded(float x, float y) const {
+    for (const Exclusion& zone : m_exclusions) {
+        float dx = x - zone.x;
+        float dy = y - zone.y;
+        if (dx * dx + dy * dy < zone.radius * zone.radius) return true;
+    }
+    return false;
+}
+
+bool PoissonDiskSampler::IsFree(float x, float y, float spacing) const {
+    int reach = int(std::ceil(spacing / m_cellSize));
+    int cx = int(x / m_cellSize);
+    int cy = int(y / m_cellSize);
+    for (int gy = std::max(0, cy - reach); gy <= std::min(m_rows - 1, cy + reach); ++gy) {
+        for (int gx = std::max(0, cx - reach); gx <= std::min(m_columns - 1, cx + reach); ++gx) {
+            for (int i = m_cellHead[gy * m_columns + gx]; i != -1; i = m_next[i]) {
+                float dx = m_points[i].x - x;
+                float dy = m_points[i].y - y;
+                if (dx * dx + dy * dy < spacing * spacing) return false;
+            }
+        }
+    }
+    return true;
+}
+
+void PoissonDiskSampler::Sample(int count, Philox4x32& rng, std::vector<SpawnPoint>& out) {
+    out.reserve(out.size() + std::max(0, count));
+    float spacing = m_spacing;
+    for (int placed = 0; placed < count; ) {
+        bool accepted = false;
+        for (int attempt = 0; attempt < kAttempts && !accepted; ++attempt) {
+            float x = rng.NextFloat() * m_width;
+            float y = rng.NextFloat() * m_height;
+            if (this->IsExcluded(x, y) || !this->IsFree(x, y, spacing)) continue;
+            this->Insert(x, y);
+            out.push_back(SpawnPoint{x, y});
+            accepted = true;
+        }
+        if (accepted) {
+            ++placed;
+        } else if (spacing > 1.0f) {
+            spacing = std::max(1.0f, spacing * 0.75f); // too crowded, pack tighter from now on
+        } else {
+            // nothing fits anymore, overlap outside the exclusion zones rather than drop spawns
+            float x = rng.NextFloat() * m_width;
+            float y = rng.NextFloat() * m_height;
+            for (int attempt = 0; attempt < kAttempts && this->IsExcluded(x, y); ++attempt) {
+                x = rng.NextFloat() * m_width;
+                y = rng.NextFloat() * m_height;
+            }
+            this->Insert(x, y);
+            out.push_back(SpawnPoint{x, y});
+            ++placed;
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Philox4x32-10 counter based generator (Salmon et al., "Parallel random numbers: as easy as
+// 1, 2, 3"). Every block is a pure function of (seed, stream, index), so any thread can
+// produce any part of the sequence and the same seed always gives the same spawns.
+class Philox4x32 {
+    public:
+        explicit Philox4x32(uint64_t seed, uint64_t stream = 0);
+        std::array<uint32_t, 4> Block(uint64_t index) const;
+
+        // sequential helpers, they walk the blocks in order
+        uint32_t Next();
+        float NextFloat(); // [0, 1)
+        int NextInt(int lo, int hi); // [lo, hi]
+        void Seek(uint64_t position) { m_position = position; }
+        uint64_t GetPosition() const { return m_position; }
+    private:
+        std::array<uint32_t, 2> m_key;
+        uint64_t m_stream;
+        uint64_t m_position = 0; // in 32 bit outputs
+        std::array<uint32_t, 4> m_block{}; // last block Next() computed
+        uint64_t m_blockIndex = ~uint64_t(0);
+};
+
+struct SpawnPoint {
+    float x;
+    float y;
+};
+
+// Grid accelerated Poisson-disk placement by dart throwing: a candidate is accepted only if no
+// other point is closer than the spacing, and the grid keeps that check to a few cells.
+// When the area gets too crowded for the spacing it is relaxed instead of failing.
+class PoissonDiskSampler {
+    public:
+        PoissonDiskSampler(float width, float height, float spacing);
+        void AddExisting(float x, float y); // already occupied spots, like creatures in the tank
+        void AddExclusion(float x, float y, float radius); // nothing is ever placed in here
+        // appends count points to out
+        void Sample(int count, Philox4x32& rng, std::vector<SpawnPoint>& out);
+
+        // spacing that still fits total points into the area
+        static float FitSpacing(float width, float height, int total, float preferred);
+        static constexpr int kAttempts = 30;
+    private:
+        int CellOf(float x, float y) const;
+        bool IsFree(float x, float y, float spacing) const;
+        bool IsExcluded(float x, float y) const;
+        void Insert(float x, float y);
+
+        float m_width;
+        float m_height;
+        float m_spacing;
+        float m_cellSize;
+        int m_columns;
+        int m_rows;
+        std::vector<int> m_cellHead; // first point in every cell, -1 when empty
+        std::vector<int> m_next; // next point in the same cell
+        std::vector<SpawnPoint> m_points;
+        struct Exclusion { float x; float y; float radius; };
+        std::vector<Exclusion> m_exclusions;
+};
@@ -0,0 +1,127 @@
+#include "TimingWheel.h"
+
+#include <algorithm>
+#include <utility>
+
+
+// TimingWheel Implementation
+// never destroyed, objects owning timers may still cancel them while the app shuts down
+TimingWheel& TimingWheel::Frames() {
+    static TimingWheel* instance = new TimingWheel();
+    return *instance;
+}
+
+TimingWheel::TimerId TimingWheel::Schedule(uint64_t delay, Callback callback) {
+    uint32_t index;
+    if (!m_free.empty()) {
+        index = m_free.back();
+        m_free.pop_back();
+    } else {
+        index = uint32_t(m_nodes.size());
+        m_nodes.emplace_back();
+    }
+    Node& node = m_nodes[index];
+    node.expires = m_now + std::max<uint64_t>(1, delay);
+    node.callback = std::move(callback);
+    this->Insert(index);
+    m_pending += 1;
+    return TimerId{index, node.generation};
+}
+
+bool TimingWheel::IsPending(TimerId timer) const {
+    return timer.index < m_nodes.size() && m_nodes[timer.index].generation == timer.generation && m_nodes[timer.index].slot >= 0;
+}
+
+uint64_t TimingWheel::Remaining(TimerId timer) const {
+    return this->IsPending(timer) ? m_nodes[timer.index].expires - m_now : 0;
+}
+
+bool TimingWheel::Cancel(TimerId& timer) {
+    bool pending = this->IsPending(timer);
+    if (pending) {
+        this->Unlink(timer.index);
+        this->Release(timer.index);
+    }
+    timer = TimerId{};
+    return pending;
+}
+
+// the level is the first one whose span covers the delay, the slot comes from the expiry
+// itself so it lines up with the moment that slot gets cascaded
+void TimingWheel::Insert(uint32_t index) {
+    Node& node = m_nodes[index];
+    uint64_t delta = node.expires > m_now ? node.expires - m_now : 0;
+    int level = 0;
+    while (level < kLevels - 1 && delta >= (uint64_t(1) << (kSlotBits * (level + 1)))) ++level;
+    int slot = level * kSlots + int((node.expires >> (kSlotBits * level)) & (kSlots - 1));
+    node.slot = slot;
+    node.prev = kNone;
+    node.next = m_heads[slot];
+    if (node.next != kNone) m_nodes[node.next].prev = index;
+    m_heads[slot] = index;
+}
+
+void TimingWheel::Unlink(uint32_t index) {
+    Node& node = m_nodes[index];
+    if (node.prev != kNone) m_nodes[node.prev].next = node.next;
+    else m_heads[node.slot] = node.next;
+    if (node.next != kNone) m_nodes[node.next].prev = node.prev;
+    node.slot = -1;
+}
+
+uint32_t TimingWheel::Detach(int slot) {
+    uint32_t head = m_heads[slot];
+    m_heads[slot] = kNone;
+    return head;
+}
+
+void TimingWheel::Release(uint32_t index) {
+    Node& node = m_nodes[index];
+    node.slot = -1;
+    node.generation += 1; // ids handed out for this node are stale from now on
+    node.callback = nullptr;
+    m_free.push_back(index);
+    m_pending -= 1;
+}
+
+// every timer of the slot that just came round moves down to where its remaining delay fits
+void TimingWheel::Cascade(int level) {
+    int slot = level * kSlots + int((m_now >> (kSlotBits * level)) & (kSlots - 1));
+    for (uint32_t index = this->Detach(slot); index != kNone; ) {
+        uint32_t next = m_nodes[index].next;
+        this->Insert(index);
+        index = next;
+    }
+}
+
+void TimingWheel::Tick() {
+    m_now += 1;
+    // a level moves on when every level below it wrapped around, the coarsest one goes first
+    int level = 1;
+    while (level < kLevels && ((m_now >> (kSlotBits * (level - 1))) & (kSlots - 1)) == 0) ++level;
+    for (int cascade = level - 1; cascade >= 1; --cascade) {
+        this->Cascade(cascade);
+    }
+
+    // the due chain moves to the firing list before anything runs, so a callback can schedule
+    // into this very slot, and cancelling a timer due on the same tick just unlinks it there
+    uint32_t due = this->Detach(int(m_now & (kSlots - 1)));
+    for (uint32_t index = due; index != kNone; index = m_nodes[index].next) {
+        m_nodes[index].slot = kFiring;
+    }
+    m_heads[kFiring] = due;
+    while (m_heads[kFiring] != kNone) {
+        uint32_t index = m_heads[kFiring];
+        this->Unlink(index);
+        Callback callback = std::move(m_nodes[index].callback);
+        this->Release(index);
+        m_fired += 1;
+        if (callback) callback();
+    }
+}
+
+void TimingWheel::Advance(uint64_t ticks) {
+    for (uint64_t i = 0; i < ticks; ++i) {
+        this->Tick();
+    }
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Hierarchical timing wheel (Varghese & Lauck) in the layout the Linux kernel used: four
+// levels of 256 slots, each level 256 times coarser than the one below. A timer sits in the
+// slot of the level its delay fits in and moves down a level each time that slot comes round,
+// so scheduling and cancelling are O(1) and a tick only touches the timers that are due
+// (plus the occasional cascade of one slot). Pending timers cost nothing while they wait.
+class TimingWheel {
+    public:
+        using Callback = std::function<void()>;
+        // stays safe to use after the timer fired or was cancelled, the generation tells
+        struct TimerId {
+            uint32_t index = ~0u;
+            uint32_t generation = 0;
+        };
+
+        // the wheel ofApp advances once per frame, for everything counted in frames
+        static TimingWheel& Frames();
+
+        // fires after delay ticks (at least one), the callback may schedule or cancel timers
+        TimerId Schedule(uint64_t delay, Callback callback = nullptr);
+        bool Cancel(TimerId& timer); // false if it was not pending, timer is reset either way
+        bool IsPending(TimerId timer) const;
+        uint64_t Remaining(TimerId timer) const; // ticks until it fires, 0 if it is not pending
+        void Advance(uint64_t ticks = 1);
+
+        uint64_t Now() const { return m_now; }
+        size_t GetPendingCount() const { return m_pending; }
+        uint64_t GetFiredCount() const { return m_fired; }
+
+        static constexpr int kLevels = 4;
+        static constexpr int kSlotBits = 8;
+        static constexpr int kSlots = 1 << kSlotBits;
+    private:
+        static constexpr uint32_t kNone = ~0u;
+        static constexpr int kFiring = kLevels * kSlots; // list of the timers due this tick
+        struct Node {
+            uint64_t expires = 0;
+            uint32_t prev = kNone;
+            uint32_t next = kNone;
+            uint32_t generation = 0;
+            int slot = -1; // level * kSlots + index while pending, kFiring once it is due
+            Callback callback;
+        };
+        void Insert(uint32_t index);
+        void Unlink(uint32_t index);
+        uint32_t Detach(int slot); // empties the slot and returns its chain
+        void Release(uint32_t index);
+        void Cascade(int level);
+        void Tick();
+
+        uint64_t m_now = 0;
+        std::vector<Node> m_nodes; // pool, freed nodes are reused
+        std::vector<uint32_t> m_free;
+        std::vector<uint32_t> m_heads = std::vector<uint32_t>(kLevels * kSlots + 1, kNone);
+        size_t m_pending = 0;
+        uint64_t m_fired = 0;
+};
+
+// true on every frames+1-th call of tick(), counting only the frames it is polled on, like the
+// counter it replaces: the timer starts with the first tick() and the frames its owner skips
+// (another scene, a rewind) push it out instead of being counted. tick() is meant once a frame.
+class AwaitFrames {
+    public:
+        explicit AwaitFrames(int frames, TimingWheel& wheel = TimingWheel::Frames()) : m_wheel(wheel), m_frames(frames) {}
+        ~AwaitFrames() { m_wheel.Cancel(m_timer); }
+        AwaitFrames(const AwaitFrames&) = delete;
+        AwaitFrames& operator=(const AwaitFrames&) = delete;
+        bool tick() {
+            uint64_t now = m_wheel.Now();
+            if (!m_polled) {
+                m_polled = true;
+                this->Arm(now, m_frames);
+            } else if (now > m_lastPoll + 1) {
+                uint64_t left = m_expires - m_lastPoll - 1; // frames it still had to wait at the last poll
+                m_wheel.Cancel(m_timer);
+                m_due = false;
+                this->Arm(now, left);
+            }
+            m_lastPoll = now;
+            if (!m_due) {
+                return false;
+            }
+            m_due = false;
+            this->Arm(now, m_frames + 1);
+            return true;
+        }
+    private:
+        void Arm(uint64_t now, uint64_t delay) {
+            m_expires = now + delay;
+            if (delay == 0) {
+                m_due = true;
+                return;
+            }
+            m_timer = m_wheel.Schedule(delay, [this]() { m_due = true; });
+        }
+        TimingWheel& m_wheel;
+        int m_frames;
+        bool m_polled = false;
+        bool m_due = false;
+        uint64_t m_lastPoll = 0;
+        uint64_t m_expires = 0;
+        TimingWheel::TimerId m_timer;
+};
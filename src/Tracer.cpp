@@ -0,0 +1,146 @@
+#include "Tracer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include "ofMain.h"
+
+
+// TraceBuffer Implementation
+TraceBuffer::TraceBuffer(uint32_t threadId, size_t capacity)
+: m_threadId(threadId), m_events(capacity) {}
+
+void TraceBuffer::Push(const char* name, uint64_t timestamp, char phase) {
+    uint64_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) >= m_events.size()) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed); // over a frame's worth of events, nobody collected in time
+        return;
+    }
+    m_events[head % m_events.size()] = TraceEvent{name, timestamp, phase};
+    m_head.store(head + 1, std::memory_order_release);
+}
+
+void TraceBuffer::Drain(std::vector<TraceEvent>& out) {
+    uint64_t tail = m_tail.load(std::memory_order_relaxed);
+    uint64_t head = m_head.load(std::memory_order_acquire);
+    for (; tail < head; ++tail) {
+        out.push_back(m_events[tail % m_events.size()]);
+    }
+    m_tail.store(tail, std::memory_order_release);
+}
+
+
+// Tracer Implementation
+Tracer& Tracer::Get() {
+    static Tracer instance;
+    return instance;
+}
+
+Tracer::Tracer() {
+    m_epoch = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t Tracer::NowMicros() const {
+    uint64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    return now - m_epoch;
+}
+
+TraceBuffer* Tracer::LocalBuffer() {
+    // the ring is owned by the tracer so it outlives the thread and can still be flushed
+    thread_local LocalRing ring;
+    if (ring.buffer == nullptr) {
+        std::lock_guard<std::mutex> lock(m_registryMutex);
+        if (!m_freeBuffers.empty()) {
+            ring.buffer = m_freeBuffers.back();
+            m_freeBuffers.pop_back();
+        } else {
+            m_buffers.push_back(std::make_unique<TraceBuffer>(0, kEventsPerThread));
+            ring.buffer = m_buffers.back().get();
+        }
+        ring.buffer->SetThreadId(m_nextThreadId++); // a new track in the trace, even on a reused ring
+    }
+    return ring.buffer;
+}
+
+// short lived threads (ResampleCache jobs, ...) would otherwise leave a ring behind each
+Tracer::LocalRing::~LocalRing() {
+    if (buffer == nullptr) return;
+    Tracer& tracer = Tracer::Get();
+    std::lock_guard<std::mutex> lock(tracer.m_registryMutex);
+    tracer.CollectLocked(*buffer); // its events are kept under the thread's id
+    tracer.m_freeBuffers.push_back(buffer);
+}
+
+void Tracer::Record(const char* name, char phase) {
+    LocalBuffer()->Push(name, NowMicros(), phase);
+    m_pending.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::CollectLocked(TraceBuffer& buffer) {
+    m_drained.clear();
+    buffer.Drain(m_drained);
+    for (const TraceEvent& e : m_drained) {
+        ThreadEvent entry{buffer.GetThreadId(), e};
+        if (m_history.size() < kHistoryEvents) {
+            m_history.push_back(entry);
+            continue;
+        }
+        m_history[m_historyNext] = entry; // full, the oldest event makes room
+        m_historyNext = (m_historyNext + 1) % kHistoryEvents;
+        m_overwritten += 1;
+    }
+}
+
+void Tracer::Collect() {
+    if (!this->HasPendingEvents()) return;
+    std::lock_guard<std::mutex> lock(m_registryMutex);
+    for (auto& buffer : m_buffers) {
+        this->CollectLocked(*buffer);
+    }
+}
+
+size_t Tracer::GetBufferCount() {
+    std::lock_guard<std::mutex> lock(m_registryMutex);
+    return m_buffers.size();
+}
+
+bool Tracer::Flush(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        ofLogError() << "Tracer could not open " << path << std::endl;
+        return false;
+    }
+
+    std::vector<ThreadEvent> events;
+    uint64_t dropped = 0;
+    uint64_t overwritten = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_registryMutex);
+        for (auto& buffer : m_buffers) {
+            this->CollectLocked(*buffer);
+            dropped += buffer->GetDropped();
+        }
+        events.swap(m_history);
+        m_historyNext = 0;
+        overwritten = m_overwritten;
+    }
+    m_pending.store(false, std::memory_order_relaxed);
+    std::stable_sort(events.begin(), events.end(), [](const ThreadEvent& a, const ThreadEvent& b) {
+        return a.event.timestamp < b.event.timestamp;
+    });
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (size_t i = 0; i < events.size(); ++i) {
+        const TraceEvent& e = events[i].event;
+        out << "{\"name\":\"" << e.name << "\",\"cat\":\"aquarium\",\"ph\":\"" << e.phase
+            << "\",\"ts\":" << e.timestamp << ",\"pid\":1,\"tid\":" << events[i].threadId << "}"
+            << (i + 1 < events.size() ? ",\n" : "\n");
+    }
+    out << "]}\n";
+
+    ofLogNotice() << "Tracer wrote " << events.size() << " events to " << path << " (" << overwritten
+                  << " oldest overwritten and " << dropped << " dropped so far)" << std::endl;
+    return true;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Opt-in recorder for Chrome trace-event JSON (loads in chrome://tracing and Perfetto).
+// Every thread writes begin/end events into its own fixed size ring so recording never
+// takes a lock; the only lock is taken once per thread when it gets a ring. The game thread
+// moves the rings into a bounded history every frame (Collect), which keeps the newest events
+// and overwrites the oldest. A thread that ends gives its ring back for the next thread.
+struct TraceEvent {
+    const char* name; // must point to a string literal, we only keep the pointer
+    uint64_t timestamp; // microseconds since the tracer was created
+    char phase; // 'B' begin, 'E' end
+};
+
+class TraceBuffer {
+    public:
+        TraceBuffer(uint32_t threadId, size_t capacity);
+        // producer side, only called from the owning thread
+        void Push(const char* name, uint64_t timestamp, char phase);
+        // consumer side, moves everything recorded so far into out
+        void Drain(std::vector<TraceEvent>& out);
+        uint32_t GetThreadId() const { return m_threadId; }
+        void SetThreadId(uint32_t threadId) { m_threadId = threadId; } // only while nobody is recording into it
+        uint64_t GetDropped() const { return m_dropped.load(std::memory_order_relaxed); }
+    private:
+        uint32_t m_threadId;
+        std::vector<TraceEvent> m_events;
+        std::atomic<uint64_t> m_head{0}; // written by the producer
+        std::atomic<uint64_t> m_tail{0}; // written by the consumer
+        std::atomic<uint64_t> m_dropped{0};
+};
+
+class Tracer {
+    public:
+        static Tracer& Get();
+
+        void SetEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+        bool IsEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+        void Begin(const char* name) { if (IsEnabled()) Record(name, 'B'); }
+        void End(const char* name) { if (IsEnabled()) Record(name, 'E'); }
+
+        // moves what the threads recorded into the history, once per frame so no ring fills up
+        void Collect();
+        // writes everything captured since the last flush into a new JSON file at path
+        bool Flush(const std::string& path);
+        bool HasPendingEvents() const { return m_pending.load(std::memory_order_relaxed); }
+        size_t GetBufferCount();
+
+        static constexpr size_t kEventsPerThread = 1 << 16;
+        static constexpr size_t kHistoryEvents = 1 << 19; // newest events kept between flushes
+    private:
+        struct ThreadEvent {
+            uint32_t threadId;
+            TraceEvent event;
+        };
+        // hands the ring of a finished thread back when the thread's storage goes away
+        struct LocalRing {
+            TraceBuffer* buffer = nullptr;
+            ~LocalRing();
+        };
+
+        Tracer();
+        void Record(const char* name, char phase);
+        TraceBuffer* LocalBuffer();
+        uint64_t NowMicros() const;
+        void CollectLocked(TraceBuffer& buffer); // with m_registryMutex held
+
+        std::atomic<bool> m_enabled{false};
+        std::atomic<bool> m_pending{false};
+        std::mutex m_registryMutex; // guards the rings and the history, never taken while recording
+        std::vector<std::unique_ptr<TraceBuffer>> m_buffers;
+        std::vector<TraceBuffer*> m_freeBuffers; // rings of threads that ended, already collected
+        uint32_t m_nextThreadId = 1;
+        std::vector<ThreadEvent> m_history; // ring of kHistoryEvents once it has grown that far
+        size_t m_historyNext = 0; // where the next event goes once the history is full
+        uint64_t m_overwritten = 0;
+        std::vector<TraceEvent> m_drained; // reused by CollectLocked
+        uint64_t m_epoch;
+};
+
+// RAII helper, records a begin event now and the matching end event when it goes out of scope
+class TraceScope {
+    public:
+        explicit TraceScope(const char* name) : m_name(name) { Tracer::Get().Begin(m_name); }
+        ~TraceScope() { Tracer::Get().End(m_name); }
+        TraceScope(const TraceScope&) = delete;
+        TraceScope& operator=(const TraceScope&) = delete;
+    private:
+        const char* m_name;
+};
@@ -0,0 +1,44 @@
+#include "UpdateScheduler.h"
+
+
+UpdateScheduler::Tier UpdateScheduler::Classify(const Creature& creature) const {
+    if (creature.isStationary()) {
+        return Tier::Sleeping;
+    }
+    float dx = creature.getX() - m_focusX;
+    float dy = creature.getY() - m_focusY;
+    return dx * dx + dy * dy <= kNearRadius * kNearRadius ? Tier::Near : Tier::Far;
+}
+
+void UpdateScheduler::Plan(const std::vector<std::shared_ptr<Creature>>& creatures, std::vector<Move>& out) {
+    out.clear();
+    m_tick += 1;
+
+    for (size_t i = 0; i < creatures.size(); ++i) {
+        Creature& creature = *creatures[i];
+        Creature::UpdateSlot& slot = creature.getUpdateSlot();
+        if (slot.nextTick > m_tick) {
+            continue; // not its turn
+        }
+
+        // a creature seen for the first time moves one step like it always did
+        uint64_t elapsed = slot.lastTick == 0 ? 1 : m_tick - slot.lastTick;
+        if (!creature.isStationary()) {
+            out.push_back(Move{int(i), int(elapsed)});
+        }
+        slot.lastTick = m_tick;
+
+        switch (this->Classify(creature)) {
+            case Tier::Near:
+                slot.nextTick = m_tick + 1;
+                break;
+            case Tier::Far:
+                // the first far turn is offset so the far creatures spread over the interval
+                slot.nextTick = m_tick + (elapsed <= 1 ? 1 + (m_stagger++ % kFarInterval) : kFarInterval);
+                break;
+            default:
+                slot.nextTick = UINT64_MAX; // until setVelocity wakes it up
+                break;
+        }
+    }
+}
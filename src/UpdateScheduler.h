@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Core.h"
+
+// Decides how often every NPC moves so simulation cost follows activity instead of population.
+//   Near:       within kNearRadius of the focus (the player), moved every tick
+//   Far:        everything else that moves, moved every kFarInterval ticks and extrapolated
+//               over the ticks it skipped; the turns are staggered so they don't all land together
+//   Sleeping:   no velocity, skipped until Creature::setVelocity wakes it up
+class UpdateScheduler {
+    public:
+        enum class Tier { Near, Far, Sleeping };
+        // a creature whose turn it is, and how many ticks it has to cover
+        struct Move {
+            int index;
+            int ticks;
+        };
+
+        void setFocus(float x, float y) { m_focusX = x; m_focusY = y; }
+
+        // one simulation tick: lists who moves instead of moving them, so the caller can move
+        // them in batches. Tiers come from where the creatures are before they move.
+        void Plan(const std::vector<std::shared_ptr<Creature>>& creatures, std::vector<Move>& out);
+
+        uint64_t GetTick() const { return m_tick; }
+
+        static constexpr float kNearRadius = 300.0f;
+        static constexpr int kFarInterval = 4;
+    private:
+        Tier Classify(const Creature& creature) const;
+
+        float m_focusX = 0.0f;
+        float m_focusY = 0.0f;
+        uint64_t m_tick = 0;
+        uint64_t m_stagger = 0;
+};
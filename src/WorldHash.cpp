@@ -0,0 +1,77 @@
+#include "WorldHash.h"
+
+#include <algorithm>
+#include <fstream>
+
+
+// DeterminismLog Implementation
+// the file is the raw array of entries behind a small header, it is only read back by this class
+namespace {
+    constexpr char kMagic[8] = {'A', 'Q', 'H', 'A', 'S', 'H', '0', '1'};
+}
+
+bool DeterminismLog::Record(uint64_t tick, uint64_t hash) {
+    m_entries.push_back(Entry{tick, hash});
+    if (m_firstDivergence >= 0) return false;
+    // both runs count ticks the same way, so the reference is walked alongside
+    while (m_referenceCursor < m_reference.size() && m_reference[m_referenceCursor].tick < tick) {
+        ++m_referenceCursor;
+    }
+    if (m_referenceCursor == m_reference.size() || m_reference[m_referenceCursor].tick != tick) return false;
+    if (m_reference[m_referenceCursor].hash == hash) return false;
+    m_firstDivergence = int64_t(tick);
+    return true;
+}
+
+void DeterminismLog::Truncate(uint64_t tick) {
+    auto after = [](uint64_t t, const Entry& e) { return t < e.tick; };
+    m_entries.erase(std::upper_bound(m_entries.begin(), m_entries.end(), tick, after), m_entries.end());
+    // the reference is walked again from the first tick that will be recorded next
+    m_referenceCursor = size_t(std::upper_bound(m_reference.begin(), m_reference.end(), tick, after) - m_reference.begin());
+    if (m_firstDivergence > int64_t(tick)) {
+        m_firstDivergence = -1; // it happened in the future that was rewound over
+    }
+}
+
+bool DeterminismLog::LoadReference(const std::string& path) {
+    m_referenceCursor = 0;
+    m_firstDivergence = -1;
+    return Load(path, m_reference);
+}
+
+bool DeterminismLog::Save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) return false;
+    uint64_t count = m_entries.size();
+    out.write(kMagic, sizeof(kMagic));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    out.write(reinterpret_cast<const char*>(m_entries.data()), std::streamsize(count * sizeof(Entry)));
+    return bool(out);
+}
+
+bool DeterminismLog::Load(const std::string& path, std::vector<Entry>& out) {
+    out.clear();
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(kMagic)];
+    uint64_t count = 0;
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) return false;
+    if (!in.read(reinterpret_cast<char*>(&count), sizeof(count))) return false;
+    out.resize(count);
+    if (!in.read(reinterpret_cast<char*>(out.data()), std::streamsize(count * sizeof(Entry)))) {
+        out.clear();
+        return false;
+    }
+    return true;
+}
+
+int64_t DeterminismLog::FirstDivergence(const std::vector<Entry>& a, const std::vector<Entry>& b) {
+    size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i].tick < b[j].tick) { ++i; continue; }
+        if (b[j].tick < a[i].tick) { ++j; continue; }
+        if (a[i].hash != b[j].hash) return int64_t(a[i].tick);
+        ++i;
+        ++j;
+    }
+    return -1;
+}
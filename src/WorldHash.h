@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// splitmix64 finalizer, every input bit flips about half of the output bits
+inline uint64_t HashMix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+inline uint64_t HashCombine(uint64_t seed, uint64_t value) {
+    return HashMix(seed + 0x9E3779B97F4A7C15ULL + value);
+}
+
+// the exact bits, so -0.0f and 0.0f or two NaNs that print alike still count as different
+inline uint64_t HashCombine(uint64_t seed, float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return HashCombine(seed, uint64_t(bits));
+}
+
+// Multiset hash of the world: the sum (mod 2^64) of the hashes of every element. Addition is
+// commutative, so the order creatures are stored or updated in never matters, and adding,
+// removing or changing one element costs O(1) however big the world is.
+class WorldHash {
+    public:
+        void Add(uint64_t element) { m_sum += element; m_count += 1; }
+        void Remove(uint64_t element) { m_sum -= element; m_count -= 1; }
+        void Replace(uint64_t before, uint64_t after) { m_sum += after - before; }
+        uint64_t Get() const { return HashCombine(m_sum, m_count); }
+        uint64_t GetCount() const { return m_count; }
+    private:
+        uint64_t m_sum = 0;
+        uint64_t m_count = 0;
+};
+
+// The checksum of every tick of one run. Given the log of an earlier run (another thread count,
+// a replay, the scalar build) it reports the first tick where the two stopped agreeing.
+class DeterminismLog {
+    public:
+        struct Entry {
+            uint64_t tick;
+            uint64_t hash;
+        };
+
+        // true on the first tick that differs from the reference
+        bool Record(uint64_t tick, uint64_t hash);
+        // forgets every tick after this one, play goes on from it after a rewind
+        void Truncate(uint64_t tick);
+        bool LoadReference(const std::string& path);
+        bool Save(const std::string& path) const;
+        bool HasReference() const { return !m_reference.empty(); }
+        // -1 while the runs agree (or there is nothing to compare against)
+        int64_t GetFirstDivergence() const { return m_firstDivergence; }
+        const std::vector<Entry>& GetEntries() const { return m_entries; }
+
+        // first tick present in both logs whose hashes differ, -1 if there is none
+        static int64_t FirstDivergence(const std::vector<Entry>& a, const std::vector<Entry>& b);
+        static bool Load(const std::string& path, std::vector<Entry>& out);
+    private:
+        std::vector<Entry> m_entries;
+        std::vector<Entry> m_reference;
+        size_t m_referenceCursor = 0;
+        int64_t m_firstDivergence = -1;
+};
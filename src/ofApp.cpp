@@ -3,19 +3,78 @@
 //--------------------------------------------------------------
 void ofApp::setup(){
 
-    ofSetFrameRate(60);
+    ofSetFrameRate(kActiveFrameRate);
+
+    // fish types first, the levels and the metrics name them
+    creatureTypes = LoadCreatureTypes("behaviors.xml");
+
+    ofXml settings;
+    if(settings.load("settings.xml")){
+        if(auto threshold = settings.getChild("group").getChild("hitch_threshold_ms")){
+            FrameMonitor::Get().SetHitchThreshold(threshold.getFloatValue());
+        }
+        if(auto speed = settings.getChild("group").getChild("player_speed")){
+            DEFAULT_SPEED = speed.getIntValue();
+        }
+        if(auto seconds = settings.getChild("group").getChild("rewind_seconds")){
+            rewind.SetHistory(std::max(1, seconds.getIntValue()) * kActiveFrameRate);
+        }
+        rewind.SetKeyframeInterval(2 * kActiveFrameRate);
+        // per tick world checksums, compared against the log of an earlier run when one is given
+        hashLogEnabled = settings.getChild("group").getChild("determinism_log").getIntValue() != 0;
+        string reference = settings.getChild("group").getChild("determinism_reference").getValue();
+        if(hashLogEnabled && !reference.empty()){
+            if(hashLog.LoadReference(ofToDataPath(reference, true))){
+                ofLogNotice() << "Comparing every tick against " << reference << std::endl;
+            } else {
+                ofLogError() << "Could not read the determinism reference " << reference << std::endl;
+            }
+        }
+        std::vector<string> types;
+        for(int t = 0; t < creatureTypes->size(); ++t){
+            types.push_back(creatureTypes->at(AquariumCreatureType(t)).name);
+        }
+        // Prometheus text on http://127.0.0.1:<metrics_port>/metrics, 0 turns it off
+        int metricsPort = settings.getChild("group").getChild("metrics_port").getIntValue();
+        if(metricsPort > 0){
+            RuntimeMetrics::Get().SetCreatureTypeNames(types);
+            if(metrics.Start(metricsPort)){
+                ofLogNotice() << "Metrics on http://127.0.0.1:" << metricsPort << "/metrics" << std::endl;
+            } else {
+                ofLogError() << "Metrics endpoint: " << metrics.GetLastError() << std::endl;
+            }
+        }
+        // gameplay analytics, read back with tools/eventlog2csv
+        if(settings.getChild("group").getChild("event_log").getIntValue() != 0){
+            string prefix = ofToDataPath("events-" + ofGetTimestampString(), true);
+            EventLog::Get().SetCreatureTypeNames(types);
+            if(EventLog::Get().Start(prefix)){
+                ofLogNotice() << "Recording gameplay events to " << prefix << "-*.bin" << std::endl;
+            } else {
+                ofLogError() << "Event log: " << EventLog::Get().GetLastError() << std::endl;
+            }
+        }
+    }
     ofSetBackgroundColor(ofColor::blue);
     backgroundImage.load("background.png");
-    backgroundImage.resize(ofGetWindowWidth(), ofGetWindowHeight());
+    ofPixels background;
+    ImageResampler::Resample(backgroundImage.getPixels(), background, ofGetWindowWidth(), ofGetWindowHeight(), ResampleFilter::CatmullRom);
+    backgroundImage.setFromPixels(background);
 
     //Background Music
-    backgroundMusic.load("Aquarium Background Music.mp3");
+    backgroundMusic.load("Aquarium Background Music.mp3", true); // streamed, long tracks are never decoded whole
     backgroundMusic.setLoop(true);
     backgroundMusic.play();
 
     //Game Over Effect
     gameovereffect.load("Game Over.mp3");
 
+    // short effects are mixed by the audio engine, sfx/<name>.wav replaces the built in sound
+    for(const char* effect : {"eat", "hit", "powerup"}){
+        audio.LoadClip(effect, std::string("sfx/") + effect + ".wav");
+    }
+    audio.Start();
+
 
     std::shared_ptr<Aquarium> myAquarium;
     std::shared_ptr<PlayerCreature> player;
@@ -25,26 +84,51 @@ void ofApp::setup(){
 
 
     // first we make the intro scene 
+    titleBanner = std::make_shared<GameSprite>("title.png", ofGetWindowWidth(), ofGetWindowHeight());
     gameManager->AddScene(std::make_shared<GameIntroScene>(
-        GameSceneKindToString(GameSceneKind::GAME_INTRO),
-        std::make_shared<GameSprite>("title.png", ofGetWindowWidth(), ofGetWindowHeight())
+        GameSceneKindToString(GameSceneKind::GAME_INTRO), titleBanner
     ));
 
     //AquariumSpriteManager
-    spriteManager = std::make_shared<AquariumSpriteManager>();
-
-    // Lets setup the aquarium
-    myAquarium = std::make_shared<Aquarium>(ofGetWindowWidth(), ofGetWindowHeight(), spriteManager);
-    player = std::make_shared<PlayerCreature>(ofGetWindowWidth()/2 - 50, ofGetWindowHeight()/2 - 50, DEFAULT_SPEED, this->spriteManager->GetSprite(AquariumCreatureType::PlayerFish));
+    spriteManager = std::make_shared<AquariumSpriteManager>(creatureTypes);
+
+    // Lets setup the aquarium, the world can be bigger than the window (0 means window sized)
+    int worldWidth = settings.getChild("group").getChild("world_width").getIntValue();
+    int worldHeight = settings.getChild("group").getChild("world_height").getIntValue();
+    worldWidth = std::max(worldWidth, ofGetWindowWidth());
+    worldHeight = std::max(worldHeight, ofGetWindowHeight());
+    myAquarium = std::make_shared<Aquarium>(worldWidth, worldHeight, spriteManager);
+    myAquarium->setCreatureTypes(creatureTypes);
+    int chunkWidth = settings.getChild("group").getChild("chunk_width").getIntValue();
+    int chunkHeight = settings.getChild("group").getChild("chunk_height").getIntValue();
+    if(chunkWidth > 0 && chunkHeight > 0){
+        myAquarium->setChunkSize(chunkWidth, chunkHeight);
+    }
+    if(auto budget = settings.getChild("group").getChild("spawn_budget")){
+        myAquarium->setSpawnBudget(budget.getIntValue());
+    }
+    int schoolingThreads = settings.getChild("group").getChild("schooling_threads").getIntValue();
+    myAquarium->setSchoolingThreads(schoolingThreads > 0 ? schoolingThreads : std::thread::hardware_concurrency()); // 0 means every core
+    uint64_t spawnSeed = settings.getChild("group").getChild("spawn_seed").getIntValue();
+    myAquarium->setSpawnSeed(spawnSeed != 0 ? spawnSeed : ofGetSystemTimeMicros()); // 0 means a new game every run
+    player = std::make_shared<PlayerCreature>(worldWidth/2 - 50, worldHeight/2 - 50, DEFAULT_SPEED, this->spriteManager->GetSprite(AquariumCreatureType::PlayerFish));
     player->setDirection(0, 0); // Initially stationary
-    player->setBounds(ofGetWindowWidth() - 20, ofGetWindowHeight() - 20);
+    player->setBounds(worldWidth - AquariumRules::kWallMargin, worldHeight - AquariumRules::kWallMargin);
+    myAquarium->setExclusionZone(player->getX(), player->getY(), AquariumRules::kPlayerSpawnClearance);
+    AquariumCamera camera;
+    camera.setViewSize(ofGetWindowWidth(), ofGetWindowHeight());
+    camera.Follow(player->getX(), player->getY(), worldWidth, worldHeight);
+    myAquarium->setActiveView(camera.View()); // so the first level spawns around the player
 
 
-    myAquarium->addAquariumLevel(std::make_shared<Level_0>(0, 10));
-    myAquarium->addAquariumLevel(std::make_shared<Level_1>(1, 15));
-    myAquarium->addAquariumLevel(std::make_shared<Level_2>(2, 20));
-    myAquarium->addAquariumLevel(std::make_shared<Level_3>(3, 20));
-    myAquarium->addAquariumLevel(std::make_shared<Level_4>(4, 20));
+    int npcPopulation = 10;
+    if(auto population = settings.getChild("group").getChild("ncp_population")){
+        npcPopulation = population.getIntValue();
+    }
+    std::shared_ptr<const AquariumLevelTable> levels = LoadAquariumLevels("levels.xml", *creatureTypes, npcPopulation);
+    for(int i = 0; i < levels->size(); ++i){
+        myAquarium->addAquariumLevel(std::make_shared<AquariumLevel>(i, levels));
+    }
     myAquarium->Repopulate(); // initial population
 
     // now that we are mostly set, lets pass the player and the aquarium downstream
@@ -58,17 +142,67 @@ void ofApp::setup(){
     gameOverTitle.setLetterSpacing(1.035);
 
 
+    gameOverBanner = std::make_shared<GameSprite>("game-over.png", ofGetWindowWidth(), ofGetWindowHeight());
     gameManager->AddScene(std::make_shared<GameOverScene>(
-        GameSceneKindToString(GameSceneKind::GAME_OVER),
-        std::make_shared<GameSprite>("game-over.png", ofGetWindowWidth(), ofGetWindowHeight())
+        GameSceneKindToString(GameSceneKind::GAME_OVER), gameOverBanner
     ));
 
+    // full window images follow the window, resampled from the originals off the game thread
+    for(const char* asset : {"background.png", "title.png", "game-over.png"}){
+        windowImages.AddSource(asset);
+    }
+
+    // every scene sits on the background, it only changes when the window does
+    for(const auto& scene : gameManager->GetScenes()){
+        scene->Layers().AddStaticLayer("background", [this](){ backgroundImage.draw(0, 0, ofGetWindowWidth(), ofGetWindowHeight()); }, -100);
+    }
+
+    auto aquariumScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetScene(GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)));
+    // computer controlled players compete in the same tank, the scene places them
+    int bots = settings.getChild("group").getChild("bot_players").getIntValue();
+    for(int i = 0; i < bots; ++i){
+        auto bot = std::make_shared<PlayerCreature>(0, 0, DEFAULT_SPEED, this->spriteManager->GetSprite(AquariumCreatureType::PlayerFish));
+        bot->setBounds(worldWidth - AquariumRules::kWallMargin, worldHeight - AquariumRules::kWallMargin);
+        aquariumScene->AddPlayer(bot, true);
+    }
+    const Creature* localPlayer = aquariumScene->GetPlayer().get();
+    const AquariumCamera* sceneCamera = &aquariumScene->GetCamera(); // not the scene itself, it owns this listener
+    aquariumScene->SetCollisionListener([this, sceneCamera, localPlayer](CollisionOutcome outcome, const GameEvent& event){
+        if(event.creatureA.get() != localPlayer && event.creatureB.get() != localPlayer){return;} // only what happens to us is heard
+        // pan with where the fish is on screen
+        float pan = 0.0f;
+        if(event.creatureB != nullptr){
+            pan = (event.creatureB->getX() - sceneCamera->getX()) / ofGetWindowWidth() * 2.0f - 1.0f;
+        }
+        switch(outcome){
+            case CollisionOutcome::Eaten: audio.Trigger("eat", 0.8f, pan); break;
+            case CollisionOutcome::PoweredUp: audio.Trigger("powerup", 0.8f, pan); break;
+            case CollisionOutcome::Hurt: audio.Trigger("hit", 1.0f, pan); break;
+        }
+    });
+
     ofSetLogLevel(OF_LOG_NOTICE); // Set default log level
 }
 
 //--------------------------------------------------------------
 void ofApp::update(){
-    
+    FrameMonitor::Get().FrameBoundary(this->frameContext());
+    RuntimeMetrics::Get().EndFrame(FrameMonitor::Get());
+    TimingWheel::Frames().Advance(); // every frame counted timer (AwaitFrames, debounces) that is due runs here
+    Tracer::Get().Collect(); // the rings only have to hold one frame
+    input.MarkPresented();
+    TraceScope trace("ofApp::update");
+    FramePhaseScope phase(FramePhase::Update);
+
+    this->updateWindowImages();
+
+    // a scene that only shows cached layers does not need the full frame rate
+    bool idle = gameManager->IsActiveSceneIdle();
+    if(idle != idleFrameRate){
+        ofSetFrameRate(idle ? kIdleFrameRate : kActiveFrameRate);
+        idleFrameRate = idle;
+    }
+
     if(gameManager->GetActiveSceneName() == GameSceneKindToString(GameSceneKind::GAME_OVER)){
         return; // Stop updating if game is over or exiting
     }
@@ -87,7 +221,23 @@ void ofApp::update(){
         
     }
 
+    if(rewinding){
+        this->stepRewind();
+        return;
+    }
+
+    this->applyInput();
+    EventLog::Get().SetTick(uint32_t(worldTick));
     gameManager->UpdateActiveScene();
+    if(gameManager->GetActiveSceneName() == GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)){
+        this->publishMetrics();
+        this->recordWorldHash();
+        auto gameScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetActiveScene());
+        gameScene->CaptureState(rewindFrame);
+        rewindFrame.tick = worldTick;
+        rewind.Record(rewindFrame);
+        worldTick += 1;
+    }
     
 
 
@@ -95,45 +245,228 @@ void ofApp::update(){
 
 //--------------------------------------------------------------
 void ofApp::draw(){
-    backgroundImage.draw(0, 0);
+    TraceScope trace("ofApp::draw");
+    FramePhaseScope phase(FramePhase::Draw);
     gameManager->DrawActiveScene();
 }
 
 //--------------------------------------------------------------
 void ofApp::exit(){
-    
+    metrics.Stop();
+    audio.Stop();
+    ofLogNotice() << "Audio: worst trigger latency " << audio.GetMaxTriggerLatencyMicros() / 1000.0 << " ms, "
+                  << audio.GetStolenVoices() << " voices stolen, " << audio.GetDroppedTriggers() << " triggers dropped" << std::endl;
+    if(!audio.IsWithinLatencyBudget()){
+        ofLogError() << "Audio: worst trigger latency is over the " << AudioEngine::kLatencyBudgetMicros / 1000 << " ms budget,"
+                     << " the device is running bigger or more buffers than asked for" << std::endl;
+    }
+    if(Tracer::Get().HasPendingEvents()){
+        this->flushTrace();
+    }
+    FrameMonitor::Get().WriteSummary(ofToDataPath("frame-stats-" + ofGetTimestampString() + ".txt", true));
+    if(EventLog::Get().IsEnabled()){
+        EventLog::Get().Stop();
+        ofLogNotice() << "Event log: " << EventLog::Get().GetWritten() << " events in " << EventLog::Get().GetSegmentCount()
+                      << " segments, " << EventLog::Get().GetDropped() << " dropped" << std::endl;
+    }
+    if(hashLogEnabled){
+        string path = ofToDataPath("hashes-" + ofGetTimestampString() + ".bin", true);
+        if(hashLog.Save(path)){
+            ofLogNotice() << "World hashes of " << hashLog.GetEntries().size() << " ticks written to " << path << std::endl;
+        }
+        if(hashLog.HasReference() && hashLog.GetFirstDivergence() < 0){
+            ofLogNotice() << "No divergence from the reference run" << std::endl;
+        }
+    }
+}
+
+//--------------------------------------------------------------
+// plain stores into RuntimeMetrics, the endpoint thread renders them whenever it is scraped
+void ofApp::publishMetrics(){
+    if(!metrics.IsRunning()){
+        return;
+    }
+    auto gameScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetActiveScene());
+    std::shared_ptr<Aquarium> aquarium = gameScene->GetAquarium();
+    RuntimeMetrics& runtime = RuntimeMetrics::Get();
+    if(gameScene->TickedLastUpdate()){
+        runtime.RecordTick(gameScene->GetTickMicros()); // frames between tank ticks aren't ticks
+    }
+    runtime.SetCollisionCount(gameScene->GetCollisionCount());
+    const auto& population = aquarium->getPopulation();
+    for(int t = 0; t < creatureTypes->size(); ++t){
+        runtime.SetCreatureCount(t, population[t]);
+    }
+    runtime.SetPopulation(aquarium->getCreatureCount(), aquarium->getDormantCount());
+    runtime.SetLevel(aquarium->getCurrentLevel());
+}
+
+//--------------------------------------------------------------
+// one checksum per tick of the aquarium, the hash itself is kept up to date as things change
+void ofApp::recordWorldHash(){
+    if(!hashLogEnabled){
+        return;
+    }
+    auto gameScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetActiveScene());
+    uint64_t hash = gameScene->GetAquarium()->getStateHash();
+    if(hashLog.Record(worldTick, hash)){
+        ofLogError() << "World diverged from the reference run at tick " << worldTick
+                     << " (level " << gameScene->GetAquarium()->getCurrentLevel() << ")" << std::endl;
+    }
+}
+
+//--------------------------------------------------------------
+// plays the recorded ticks backwards, one per frame, until F6 is pressed again or the buffer runs out
+void ofApp::stepRewind(){
+    if(rewindTick > rewind.GetOldestTick()){
+        rewindTick -= 1;
+    }
+    auto gameScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetActiveScene());
+    if(rewind.Seek(rewindTick, rewindFrame)){
+        gameScene->RestoreState(rewindFrame);
+    }
+}
+
+//--------------------------------------------------------------
+FrameContext ofApp::frameContext(){
+    FrameContext context;
+    context.scene = gameManager->GetActiveSceneName();
+    context.idle = idleFrameRate;
+    auto aquariumScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetScene(GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)));
+    if(aquariumScene != nullptr){
+        context.creatureCount = aquariumScene->GetAquarium()->getCreatureCount();
+        context.drawnCount = aquariumScene->GetAquarium()->getLastDrawn();
+        context.level = aquariumScene->GetAquarium()->getCurrentLevel();
+    }
+    return context;
+}
+
+//--------------------------------------------------------------
+// a live resize sends an event every few pixels, the images are only asked for once the
+// window stopped changing for kResizeDebounceMs
+void ofApp::updateWindowImages(){
+    bool finished = windowImages.Poll();
+    if(!resizePending || ofGetElapsedTimeMillis() - resizeTime < kResizeDebounceMs){
+        return;
+    }
+    if(resizeRequested && !finished){
+        return; // still waiting for the workers
+    }
+    resizeRequested = true;
+    auto background = windowImages.Request("background.png", resizeWidth, resizeHeight);
+    auto title = windowImages.Request("title.png", resizeWidth, resizeHeight);
+    auto gameOver = windowImages.Request("game-over.png", resizeWidth, resizeHeight);
+    if(background == nullptr || title == nullptr || gameOver == nullptr){
+        return;
+    }
+    backgroundImage.setFromPixels(*background);
+    titleBanner->setPixels(*title);
+    gameOverBanner->setPixels(*gameOver);
+    gameManager->Resize(resizeWidth, resizeHeight);
+    resizePending = false;
+    resizeRequested = false;
+}
+
+//--------------------------------------------------------------
+// the player swims in the direction of the arrow keys held at the start of the tick,
+// repeated presses of a held key change nothing
+void ofApp::applyInput(){
+    input.Drain(pendingInput);
+    if(gameManager->GetActiveSceneName() != GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)){
+        return;
+    }
+    bool changed = false;
+    for(const InputEvent& event : pendingInput){
+        bool* held = nullptr;
+        switch(event.key){
+            case OF_KEY_UP: held = &heldKeys.up; break;
+            case OF_KEY_DOWN: held = &heldKeys.down; break;
+            case OF_KEY_LEFT: held = &heldKeys.left; break;
+            case OF_KEY_RIGHT: held = &heldKeys.right; break;
+            default: break;
+        }
+        if(held == nullptr || *held == event.pressed){continue;}
+        *held = event.pressed;
+        input.MarkApplied(event);
+        changed = true;
+    }
+    if(!changed){return;}
+
+    auto gameScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetActiveScene());
+    float dx = float(heldKeys.right) - float(heldKeys.left);
+    float dy = float(heldKeys.down) - float(heldKeys.up);
+    gameScene->GetPlayer()->setDirection(dx, dy);
+    if(dx != 0){
+        gameScene->GetPlayer()->setFlipped(dx < 0);
+    }
+}
+
+//--------------------------------------------------------------
+void ofApp::flushTrace(){
+    Tracer::Get().Flush(ofToDataPath("trace-" + ofGetTimestampString() + ".json", true));
+}
+
+//--------------------------------------------------------------
+// developer hotkeys, they work on every scene
+bool ofApp::handleDebugKey(int key){
+    switch(key){
+        case OF_KEY_F1:
+            Tracer::Get().SetEnabled(!Tracer::Get().IsEnabled());
+            ofLogNotice() << "Tracing " << (Tracer::Get().IsEnabled() ? "enabled" : "disabled") << std::endl;
+            return true;
+        case OF_KEY_F2:
+            this->flushTrace();
+            return true;
+        case OF_KEY_F3:
+            ofLogNotice() << "Frame time report\n" << FrameMonitor::Get().Report();
+            return true;
+        case OF_KEY_F4: {
+            auto aquariumScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetScene(GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)));
+            if(aquariumScene != nullptr){
+                aquariumScene->SetShowCulling(!aquariumScene->IsShowingCulling());
+            }
+            return true;
+        }
+        case OF_KEY_F5: {
+            auto aquariumScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetScene(GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)));
+            if(aquariumScene != nullptr){
+                aquariumScene->SetShowMinimap(!aquariumScene->IsShowingMinimap());
+            }
+            return true;
+        }
+        case OF_KEY_F6:
+            if(gameManager->GetActiveSceneName() != GameSceneKindToString(GameSceneKind::AQUARIUM_GAME) || rewind.IsEmpty()){
+                return true;
+            }
+            if(!rewinding){
+                rewinding = true;
+                rewindTick = rewind.GetNewestTick();
+                ofLogNotice() << "Rewinding, " << (rewind.GetNewestTick() - rewind.GetOldestTick()) << " ticks available ("
+                              << rewind.GetMemoryBytes() / 1024 << " KB)" << std::endl;
+            } else {
+                // the future that was rewound over is gone, play goes on from here
+                rewinding = false;
+                rewind.Truncate(rewindTick);
+                hashLog.Truncate(rewindTick); // the ticks after it are recorded again
+                worldTick = rewindTick + 1;
+                ofLogNotice() << "Playing on from tick " << rewindTick << std::endl;
+            }
+            return true;
+        default:
+            return false;
+    }
 }
 
 //--------------------------------------------------------------
 void ofApp::keyPressed(int key){
+    if(this->handleDebugKey(key)){return;}
     if (lastEvent.isGameExit()) { 
         ofLogNotice() << "Game has ended. Press ESC to exit." << std::endl;
         return; // Ignore other keys after game over
     }
     if(gameManager->GetActiveSceneName() == GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)){
-        auto gameScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetActiveScene());
-        switch(key){
-            case OF_KEY_UP:
-                gameScene->GetPlayer()->setDirection(gameScene->GetPlayer()->isXDirectionActive()?gameScene->GetPlayer()->getDx():0, -1);
-                break;
-                case OF_KEY_DOWN:
-                gameScene->GetPlayer()->setDirection(gameScene->GetPlayer()->isXDirectionActive()?gameScene->GetPlayer()->getDx():0, 1);
-                break;
-            case OF_KEY_LEFT:
-                gameScene->GetPlayer()->setDirection(-1, gameScene->GetPlayer()->isYDirectionActive()?gameScene->GetPlayer()->getDy():0);
-                gameScene->GetPlayer()->setFlipped(true);
-                break;
-                case OF_KEY_RIGHT:
-                gameScene->GetPlayer()->setDirection(1, gameScene->GetPlayer()->isYDirectionActive()?gameScene->GetPlayer()->getDy():0);
-                gameScene->GetPlayer()->setFlipped(false);
-                break;
-            default:
-                break;
-        }
-    
-        
-    
-        gameScene->GetPlayer()->move();
+        // the simulation picks it up at the start of the next tick, see applyInput
+        input.Push(key, true);
         return;
 
     }
@@ -158,19 +491,7 @@ void ofApp::keyPressed(int key){
 //--------------------------------------------------------------
 void ofApp::keyReleased(int key){
     if(gameManager->GetActiveSceneName() == GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)){
-        auto gameScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetActiveScene());
-    if( key == OF_KEY_UP || key == OF_KEY_DOWN){
-        gameScene->GetPlayer()->setDirection(gameScene->GetPlayer()->isXDirectionActive()?gameScene->GetPlayer()->getDx():0, 0);
-        gameScene->GetPlayer()->move();
-        return;
-    }
-    
-    if(key == OF_KEY_LEFT || key == OF_KEY_RIGHT){
-        gameScene->GetPlayer()->setDirection(0, gameScene->GetPlayer()->isYDirectionActive()?gameScene->GetPlayer()->getDy():0);
-        gameScene->GetPlayer()->move();
-        return;
-    }
-
+        input.Push(key, false);
     }
 }
 
@@ -211,10 +532,13 @@ void ofApp::mouseExited(int x, int y){
 
 //--------------------------------------------------------------
 void ofApp::windowResized(int w, int h){
-    backgroundImage.resize(w, h);
-    auto aquariumScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetScene(GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)));
-    aquariumScene->GetAquarium()->setBounds(w,h);
-    aquariumScene->GetPlayer()->setBounds(w - 20, h - 20);
+    // the old images are stretched until the resampled ones arrive, see updateWindowImages
+    resizeWidth = w;
+    resizeHeight = h;
+    resizeTime = ofGetElapsedTimeMillis();
+    resizePending = true;
+    resizeRequested = false;
+    gameManager->Resize(w, h); // cached layers are painted again, the world keeps its size and the window only shows more or less of it
 
 }
 
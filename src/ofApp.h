@@ -2,6 +2,9 @@
 
 #include "ofMain.h"
 #include "Aquarium.h"
+#include "AudioEngine.h"
+#include "InputQueue.h"
+#include "Metrics.h"
 
 
 class ofApp : public ofBaseApp{
@@ -24,21 +27,54 @@ class ofApp : public ofBaseApp{
 		void windowResized(int w, int h) override;
 		void dragEvent(ofDragInfo dragInfo) override;
 		void gotMessage(ofMessage msg) override;
+
+		bool handleDebugKey(int key);
+		void flushTrace();
+		void updateWindowImages();
+		void applyInput();
+		void recordWorldHash();
+		void publishMetrics();
+		void stepRewind();
+		FrameContext frameContext();
 	
 		
 		char moveDirection;
 		int DEFAULT_SPEED = 5;
 
 
-		AwaitFrames acuariumUpdate{5};
+		static constexpr int kActiveFrameRate = 60;
+		static constexpr int kIdleFrameRate = 15;
+		bool idleFrameRate = false;
 
 		ofTrueTypeFont gameOverTitle;
 		GameEvent lastEvent;
 
 		ofSoundPlayer backgroundMusic;
 		ofSoundPlayer gameovereffect;
+		AudioEngine audio;
+		InputQueue input;
+		DeterminismLog hashLog;
+		bool hashLogEnabled = false;
+		uint64_t worldTick = 0; // aquarium ticks played, rewinding moves it back
+		RewindBuffer rewind;
+		MetricsServer metrics;
+		WorldSnapshot rewindFrame;
+		bool rewinding = false;
+		uint64_t rewindTick = 0;
+		std::vector<InputEvent> pendingInput;
+		struct HeldKeys { bool up = false; bool down = false; bool left = false; bool right = false; } heldKeys;
 		ofImage backgroundImage;
+		std::shared_ptr<GameSprite> titleBanner;
+		std::shared_ptr<GameSprite> gameOverBanner;
+		ResampleCache windowImages;
+		int resizeWidth = 0;
+		int resizeHeight = 0;
+		uint64_t resizeTime = 0;
+		bool resizePending = false;
+		bool resizeRequested = false;
+		static constexpr uint64_t kResizeDebounceMs = 150;
 		std::unique_ptr<GameSceneManager> gameManager;
 		std::shared_ptr<AquariumSpriteManager>spriteManager;
+		std::shared_ptr<const CreatureTypeTable> creatureTypes; // from behaviors.xml
 		
 };
\ No newline at end of file
@@ -0,0 +1,209 @@
+// Standalone checks for src/BatchedEnv, no openFrameworks needed:
+//   g++ -std=c++20 -O2 -Isrc tests/BatchedAquariumTest.cpp src/BatchedEnv.cpp src/AquariumRules.cpp src/Behavior.cpp
+//       src/Schooling.cpp src/SpatialGrid.cpp src/FlowField.cpp src/SpawnPlacement.cpp -o batchedaquariumtest -pthread
+//   ./batchedaquariumtest
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "BatchedEnv.h"
+
+namespace {
+    int failures = 0;
+    const int kObs = BatchedAquarium::ObservationSize();
+
+    void Check(bool ok, const char* what) {
+        if (!ok) {
+            std::fprintf(stderr, "FAIL %s\n", what);
+            failures += 1;
+        }
+    }
+
+    // the action heading closest to the nearest creature in an observation, 0 when there is none
+    int Chase(const float* observation) {
+        const float* nearest = observation + BatchedAquarium::kPlayerFeatures;
+        float dx = nearest[0], dy = nearest[1];
+        if (dx == 0 && dy == 0) return 0;
+        const float kX[9] = {0, 0, 1, 1, 1, 0, -1, -1, -1};
+        const float kY[9] = {0, -1, -1, 0, 1, 1, 1, 0, -1};
+        int best = 0;
+        float bestDot = -2.0f;
+        for (int a = 1; a < 9; ++a) {
+            float dot = (kX[a] * dx + kY[a] * dy) / std::sqrt(kX[a] * kX[a] + kY[a] * kY[a]);
+            if (dot > bestDot) {
+                bestDot = dot;
+                best = a;
+            }
+        }
+        return best;
+    }
+
+    AquariumLevelDefinition Level(int target, AquariumCreatureType type, int count) {
+        AquariumLevelDefinition level;
+        level.targetScore = target;
+        level.population[int(type)] = count;
+        return level;
+    }
+
+    // after a step the observation shows the player where ofApp starts it and the first level's fish
+    void ObservesFirstLevel() {
+        BatchedAquarium::Config config;
+        config.environments = 4;
+        config.threads = 2;
+        BatchedAquarium env(config);
+        Check(env.GetCapacity() == 33, "capacity is the most crowded built in level");
+        std::vector<int> actions(4, 0);
+        std::vector<float> observations(4 * kObs);
+        std::vector<float> rewards(4);
+        std::vector<uint8_t> dones(4);
+        env.Step(actions.data(), observations.data(), rewards.data(), dones.data());
+        const float* o = observations.data();
+        Check(std::abs(o[0] - (config.width / 2 - 50) / config.width) < 1e-6f, "player x");
+        Check(std::abs(o[1] - (config.height / 2 - 50) / config.height) < 1e-6f, "player y");
+        Check(o[2] == 1 && o[3] == 3 && o[4] == 0 && o[5] == 0, "power, lives, score and level start at 1, 3, 0, 0");
+        Check(env.GetCreatureCount(0) == 10, "level 0 has its ten fish");
+        bool baseFish = true;
+        float last = 0.0f;
+        for (int k = 0; k < BatchedAquarium::kNearest; ++k) {
+            const float* c = o + BatchedAquarium::kPlayerFeatures + k * BatchedAquarium::kCreatureFeatures;
+            baseFish = baseFish && c[2] == 1 && c[3] == float(int(AquariumCreatureType::NPCreature));
+            float d = c[0] * c[0] * config.width * config.width + c[1] * c[1] * config.height * config.height;
+            Check(d >= last, "nearest creatures are sorted by distance");
+            last = d;
+        }
+        Check(baseFish, "level 0 only has base fish worth 1");
+        Check(dones[0] == 0 && rewards[0] == 0, "standing still earns nothing on the first tick");
+    }
+
+    // chasing the nearest fish eats them, the score is the reward and the level turns over at its target
+    void EatsAndLevelsUp() {
+        BatchedAquarium::Config config;
+        config.environments = 8;
+        config.threads = 3;
+        BatchedAquarium env(config);
+        std::vector<int> actions(8, 0);
+        std::vector<float> observations(8 * kObs);
+        std::vector<float> rewards(8);
+        std::vector<float> earned(8, 0.0f);
+        env.Step(actions.data(), observations.data(), rewards.data());
+        for (int step = 0; step < 3000 && env.GetLevel(0) == 0; ++step) {
+            for (int e = 0; e < 8; ++e) actions[e] = Chase(observations.data() + e * kObs);
+            env.Step(actions.data(), observations.data(), rewards.data());
+            for (int e = 0; e < 8; ++e) earned[e] += rewards[e];
+        }
+        Check(env.GetLevel(0) == 1, "eating ten base fish completes level 0");
+        Check(observations[5] == 1, "the observation shows the new level");
+        Check(observations[4] >= 10, "the score counts what was eaten");
+        Check(earned[0] == observations[4], "rewards add up to the score when nothing hurt");
+        Check(env.GetCreatureCount(0) == 21, "level 1 starts with its whole population");
+    }
+
+    // fish worth more than the player's power take lives, the tank starts over when player 0 has none left
+    void HurtsAndEnds() {
+        auto levels = std::make_shared<AquariumLevelTable>();
+        levels->add(Level(100, AquariumCreatureType::BiggerFish, 20));
+        BatchedAquarium::Config config;
+        config.environments = 2;
+        config.threads = 1;
+        config.levels = levels;
+        BatchedAquarium env(config);
+        std::vector<int> actions(2, 0);
+        std::vector<float> observations(2 * kObs);
+        std::vector<float> rewards(2);
+        std::vector<uint8_t> dones(2);
+        env.Step(actions.data(), observations.data(), rewards.data(), dones.data());
+        float lost = 0.0f;
+        bool ended = false;
+        int lastLives = 3;
+        for (int step = 0; step < 5000 && !ended; ++step) {
+            actions[0] = Chase(observations.data());
+            env.Step(actions.data(), observations.data(), rewards.data(), dones.data());
+            lost -= rewards[0];
+            ended = dones[0] == 1;
+            if (!ended) {
+                Check(observations[3] <= lastLives, "lives only go down");
+                lastLives = int(observations[3]);
+            }
+        }
+        Check(ended, "running into bigger fish ends the game");
+        Check(lost == 3, "each lost life is a reward of -1");
+        Check(observations[3] == 3 && observations[4] == 0, "a finished tank is reset before it is observed");
+    }
+
+    // types declared like behaviors.xml does show up with their own row and value
+    void UsesLoadedTypes() {
+        auto types = CreatureTypeTable::BuiltIn();
+        CreatureTypeInfo minnow = types->at(AquariumCreatureType::NPCreature);
+        minnow.name = "Minnow";
+        minnow.value = 2;
+        AquariumCreatureType row;
+        Check(types->add(minnow, row), "room for a new type");
+        auto levels = std::make_shared<AquariumLevelTable>();
+        levels->add(Level(10, row, 5));
+        BatchedAquarium::Config config;
+        config.environments = 1;
+        config.threads = 1;
+        config.types = types;
+        config.levels = levels;
+        BatchedAquarium env(config);
+        std::vector<int> actions(1, 0);
+        std::vector<float> observations(kObs);
+        env.Step(actions.data(), observations.data());
+        const float* c = observations.data() + BatchedAquarium::kPlayerFeatures;
+        Check(c[3] == float(int(row)) && c[2] == 2, "a new type is observed with its row and value");
+        Check(env.GetCreatureCount(0) == 5 && env.GetCapacity() == 5, "population and capacity come from the level table");
+    }
+
+    // other players are observed as type 0 with their power
+    void SeesOtherPlayers() {
+        auto levels = std::make_shared<AquariumLevelTable>();
+        levels->add(Level(10, AquariumCreatureType::NPCreature, 0));
+        BatchedAquarium::Config config;
+        config.environments = 3;
+        config.players = 2;
+        config.threads = 2;
+        config.levels = levels;
+        BatchedAquarium env(config);
+        std::vector<int> actions(6, 0);
+        std::vector<float> observations(6 * kObs);
+        env.Step(actions.data(), observations.data());
+        const float* first = observations.data();
+        const float* second = observations.data() + kObs;
+        const float* seen = first + BatchedAquarium::kPlayerFeatures;
+        Check(seen[3] == 0 && seen[2] == 1, "the other player is type 0 with power 1");
+        Check(std::abs(seen[0] - (second[0] - first[0])) < 1e-5f, "and sits where it says it is");
+        const float* back = second + BatchedAquarium::kPlayerFeatures;
+        Check(std::abs(back[0] + seen[0]) < 1e-5f, "both players see each other");
+    }
+
+    // tanks draw from their own streams, so the worker count changes nothing
+    void SameForAnyThreadCount() {
+        BatchedAquarium::Config config;
+        config.environments = 64;
+        config.players = 2;
+        config.seed = 42;
+        std::vector<float> observations[2];
+        for (int run = 0; run < 2; ++run) {
+            config.threads = run == 0 ? 1 : 5;
+            BatchedAquarium env(config);
+            std::vector<int> actions(128);
+            observations[run].resize(128 * kObs);
+            for (int step = 0; step < 200; ++step) {
+                for (int i = 0; i < 128; ++i) actions[i] = (step / 7 + i) % 9;
+                env.Step(actions.data(), observations[run].data());
+            }
+        }
+        Check(observations[0] == observations[1], "one and five workers step the same tanks");
+    }
+}
+
+int main() {
+    ObservesFirstLevel();
+    EatsAndLevelsUp();
+    HurtsAndEnds();
+    UsesLoadedTypes();
+    SeesOtherPlayers();
+    SameForAnyThreadCount();
+    if (failures == 0) std::printf("BatchedAquarium: all checks passed\n");
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,122 @@
+// Standalone checks for src/TimingWheel, no openFrameworks needed:
+//   g++ -std=c++20 -O2 -Isrc tests/TimingWheelTest.cpp src/TimingWheel.cpp -o timingwheeltest
+//   ./timingwheeltest
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "TimingWheel.h"
+
+namespace {
+    int failures = 0;
+
+    void Check(bool ok, const char* what) {
+        if (!ok) {
+            std::fprintf(stderr, "FAIL %s\n", what);
+            failures += 1;
+        }
+    }
+
+    // every timer fires exactly on its tick, across all four levels, with some cancelled
+    void FiresOnTime() {
+        TimingWheel wheel;
+        std::mt19937_64 random(7);
+        const int count = 20000;
+        std::vector<uint64_t> due(count);
+        std::vector<uint64_t> firedAt(count, 0);
+        std::vector<TimingWheel::TimerId> ids(count);
+        for (int i = 0; i < count; ++i) {
+            // mostly short delays, some far enough out to start on the top level
+            uint64_t delay = i % 10 == 0 ? 1 + random() % 20000000 : 1 + random() % 70000;
+            due[i] = delay;
+            ids[i] = wheel.Schedule(delay, [&wheel, &firedAt, i]() { firedAt[i] = wheel.Now(); });
+        }
+        int cancelled = 0;
+        for (int i = 0; i < count; i += 7) {
+            Check(wheel.Cancel(ids[i]), "cancel a pending timer");
+            Check(!wheel.IsPending(ids[i]), "a cancelled id is no longer pending");
+            cancelled += 1;
+        }
+        Check(wheel.GetPendingCount() == size_t(count - cancelled), "pending count after cancels");
+        wheel.Advance(20000001);
+        bool onTime = true;
+        for (int i = 0; i < count; ++i) {
+            uint64_t expected = i % 7 == 0 ? 0 : due[i];
+            onTime = onTime && firedAt[i] == expected;
+        }
+        Check(onTime, "every timer fires on its own tick, cancelled ones never");
+        Check(wheel.GetPendingCount() == 0, "nothing pending at the end");
+        Check(wheel.GetFiredCount() == uint64_t(count - cancelled), "fired count");
+    }
+
+    // a callback cancels the timer that is due right after it on the same tick
+    void CancelFromCallback() {
+        TimingWheel wheel;
+        TimingWheel::TimerId first;
+        TimingWheel::TimerId second;
+        int fired = 0;
+        first = wheel.Schedule(5, [&]() { fired += 1; wheel.Cancel(second); });
+        second = wheel.Schedule(5, [&]() { fired += 1; wheel.Cancel(first); });
+        TimingWheel::TimerId bystander = wheel.Schedule(5, [&]() { fired += 1; });
+        wheel.Advance(5);
+        Check(fired == 2, "the timer cancelled from a callback does not fire, the others do");
+        Check(wheel.GetPendingCount() == 0, "pending count stays sane after a cancel from a callback");
+        Check(!wheel.IsPending(bystander), "fired timers are not pending");
+
+        TimingWheel::TimerId a = wheel.Schedule(3);
+        TimingWheel::TimerId b = wheel.Schedule(3);
+        Check(a.index != b.index, "released nodes are handed out once");
+        Check(wheel.GetPendingCount() == 2, "pending count after reuse");
+        wheel.Advance(3);
+        Check(wheel.GetPendingCount() == 0, "reused nodes fire");
+    }
+
+    // a callback cancels itself and reschedules into the slot that is firing
+    void ScheduleFromCallback() {
+        TimingWheel wheel;
+        int fired = 0;
+        TimingWheel::TimerId self;
+        self = wheel.Schedule(2, [&]() {
+            fired += 1;
+            Check(!wheel.Cancel(self), "a timer is no longer pending inside its own callback");
+            self = wheel.Schedule(256, [&]() { fired += 1; }); // same level 0 slot index
+        });
+        wheel.Advance(2);
+        Check(fired == 1, "fires once on its tick");
+        wheel.Advance(256);
+        Check(fired == 2, "a timer scheduled from a callback fires a full turn later");
+        Check(wheel.GetPendingCount() == 0, "pending count after rescheduling");
+    }
+
+    // AwaitFrames fires on the same calls as a counter of tick() calls, whenever polling starts
+    // and however long it pauses
+    void AwaitFramesCountsPolls() {
+        TimingWheel wheel;
+        wheel.Advance(37); // frames before the owner starts polling do not count
+        AwaitFrames every6(5, wheel);
+        AwaitFrames always(0, wheel);
+        int counter = 0;
+        bool same = true;
+        bool alwaysTrue = true;
+        for (int frame = 0; frame < 200; ++frame) {
+            wheel.Advance();
+            if (frame >= 50 && frame < 83) continue; // paused, like the game while it rewinds
+            bool expected = counter == 5;
+            counter = expected ? 0 : counter + 1;
+            same = same && every6.tick() == expected;
+            alwaysTrue = alwaysTrue && always.tick();
+        }
+        Check(same, "AwaitFrames(5) is true on every sixth poll");
+        Check(alwaysTrue, "AwaitFrames(0) is true on every poll");
+        Check(wheel.GetPendingCount() == 2, "each AwaitFrames keeps one timer");
+    }
+}
+
+int main() {
+    FiresOnTime();
+    CancelFromCallback();
+    ScheduleFromCallback();
+    AwaitFramesCountsPolls();
+    if (failures == 0) std::printf("TimingWheel: all checks passed\n");
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,42 @@
+// Converts the gameplay event log (bin/data/events-<timestamp>-NNNN.bin) to CSV on stdout.
+// Only needs the standard library:
+//   g++ -std=c++17 -O2 -Isrc tools/eventlog2csv.cpp src/EventLog.cpp -o eventlog2csv -pthread
+//   ./eventlog2csv bin/data/events-*.bin > events.csv
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "EventLog.h"
+
+namespace {
+    // names come from the segment's type table, a row it doesn't name is written as its number
+    std::string CreatureTypeName(const std::vector<std::string>& names, int type) {
+        if (type >= 0 && type < int(names.size())) return names[type];
+        return std::to_string(type);
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s events-0000.bin [events-0001.bin ...]\n", argv[0]);
+        return 1;
+    }
+    std::printf("timestamp_us,tick,event,player,creature_type,value,creature_id\n");
+    std::vector<GameplayEvent> events;
+    std::vector<std::string> typeNames;
+    int failed = 0;
+    for (int i = 1; i < argc; ++i) {
+        events.clear();
+        if (!EventLogFormat::ReadSegment(argv[i], events, typeNames)) {
+            std::fprintf(stderr, "%s is not an event log segment\n", argv[i]);
+            failed += 1;
+            continue;
+        }
+        for (const GameplayEvent& e : events) {
+            std::string player = e.player == EventLog::kNoPlayer ? "" : std::to_string(e.player);
+            std::printf("%llu,%u,%s,%s,%s,%d,%u\n", (unsigned long long)e.timestamp, e.tick,
+                        GameplayEventKindToString(e.kind).c_str(), player.c_str(),
+                        CreatureTypeName(typeNames, e.creatureType).c_str(), e.value, e.creatureId);
+        }
+    }
+    return failed == 0 ? 0 : 2;
+}
@@ -0,0 +1,60 @@
+// Times SchoolingSystem::Step on a full tank for a few thread counts, the target is 2 ms for 20k fish.
+// Only needs the standard library, built with -O3 like a release build:
+//   g++ -std=c++17 -O3 -Isrc tools/schoolingbench.cpp src/Schooling.cpp src/SpatialGrid.cpp -o schoolingbench -pthread
+//   ./schoolingbench [fish] [steps]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+#include "Schooling.h"
+
+int main(int argc, char** argv) {
+    int fish = argc > 1 ? std::atoi(argv[1]) : 20000;
+    int steps = argc > 2 ? std::atoi(argv[2]) : 200;
+    const float width = 4096.0f, height = 3072.0f; // the default world
+    int cores = int(std::max(1u, std::thread::hardware_concurrency()));
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<float> x(fish), y(fish), vx(fish), vy(fish);
+    for (int i = 0; i < fish; ++i) {
+        x[i] = unit(random) * width;
+        y[i] = unit(random) * height;
+        vx[i] = unit(random) * 2 - 1;
+        vy[i] = unit(random) * 2 - 1;
+    }
+
+    std::printf("%d fish, %d steps, %d cores\nthreads  mean_ms  p99_ms\n", fish, steps, cores);
+    std::vector<int> counts = {1, 2, 4, 8};
+    if (std::find(counts.begin(), counts.end(), cores) == counts.end()) counts.push_back(cores);
+    for (int threads : counts) {
+        SchoolingSystem schooling;
+        schooling.setThreadCount(threads);
+        schooling.SetThreat(width / 2, height / 2);
+        std::vector<double> times;
+        for (int step = 0; step < steps + 10; ++step) {
+            schooling.Clear();
+            for (int i = 0; i < fish; ++i) {
+                schooling.Add(x[i], y[i], vx[i], vy[i], i % 2);
+            }
+            auto start = std::chrono::steady_clock::now();
+            schooling.Step(0, 0, width, height);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (step >= 10) times.push_back(ms); // the first steps start the pool and warm the caches
+            for (int i = 0; i < fish; ++i) {
+                vx[i] = schooling.GetVx(i);
+                vy[i] = schooling.GetVy(i);
+            }
+        }
+        std::sort(times.begin(), times.end());
+        double mean = 0;
+        for (double t : times) mean += t;
+        mean /= times.size();
+        std::printf("%7d  %7.3f  %6.3f%s\n", threads, mean, times[times.size() * 99 / 100],
+                    mean <= 2.0 ? "" : "  over the 2 ms target");
+    }
+    return 0;
+}